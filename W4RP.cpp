@@ -6,6 +6,7 @@
  */
 
 #include "W4RP.h"
+#include <algorithm>
 #include <esp_mac.h>
 #include <esp_system.h>
 #include <freertos/FreeRTOS.h>
@@ -71,11 +72,19 @@ void Controller::begin() {
   // Initialize components
   storage_->begin();
   canBus_->begin();
+  if (auxCanBus_) {
+    auxCanBus_->begin();
+  }
 
   // Load boot count
   bootCount_ = storage_->readString("boot_count").toInt() + 1;
   storage_->writeString("boot_count", String(bootCount_));
 
+  if (historyStorage_ && historyStorage_ != storage_)
+    historyStorage_->begin();
+  history_.begin(historyStorage_ ? historyStorage_ : storage_,
+                 historySegments_);
+
   // Derive module ID only if not already set by user
   if (moduleId_.isEmpty()) {
     moduleId_ = deriveModuleId();
@@ -107,12 +116,54 @@ void Controller::loop() {
     return;
   }
 
+  // Driver alerts and bus-off recovery
+  canBus_->loop();
+  if (auxCanBus_) {
+    auxCanBus_->loop();
+  }
+
+  // Gateway forwarding runs ahead of rule evaluation
+  CAN *buses[GATEWAY_MAX_BUSES] = {canBus_, auxCanBus_};
+  bool routing = gateway_.hasRoutes();
+
+  bool monitoring = busMonitor_.isEnabled();
+  bool capturing = capture_.isRecording();
+
   CanFrame frame;
   while (canBus_->receive(frame)) {
+    if (monitoring || capturing) {
+      uint32_t nowUs = micros();
+      if (monitoring)
+        busMonitor_.record(frame, nowUs);
+      if (capturing)
+        capture_.record(frame, nowUs);
+    }
+    if (routing)
+      gateway_.route(0, frame, buses, GATEWAY_MAX_BUSES);
     engine_.processCanFrame(frame);
   }
 
+  if (auxCanBus_) {
+    while (auxCanBus_->receive(frame)) {
+      if (routing)
+        gateway_.route(1, frame, buses, GATEWAY_MAX_BUSES);
+    }
+  }
+
+  busMonitor_.tick(micros());
+  if (capture_.tick(micros())) {
+    char msg[40];
+    snprintf(msg, sizeof(msg), "CAPTURE:READY:%u",
+             (unsigned)capture_.getExportSize());
+    transport_->send(msg);
+  }
+
+  engine_.serviceDiagnostics(*canBus_);
   engine_.evaluateRules();
+  history_.configure(engine_.getLogTracks(), engine_.getSignals(),
+                     engine_.getRulesetCRC());
+  history_.service(engine_.getSignals(), millis());
+  engine_.serviceTransmit(*canBus_);
 
   if (engine_.isDebugMode()) {
     sendDebugUpdates();
@@ -142,6 +193,30 @@ void Controller::registerCapability(const String &id, CapabilityHandler handler,
   engine_.registerCapability(id, handler, meta);
 }
 
+void Controller::setAuxCanBus(CAN *bus) { auxCanBus_ = bus; }
+
+bool Controller::enableCapture(size_t bytes, uint32_t preMs, uint32_t postMs) {
+  capture_.setWindow(preMs, postMs);
+  if (!capture_.begin(bytes))
+    return false;
+
+  // Only advertised (and accepted in rulesets) once there is a ring
+  CapabilityMeta captureMeta;
+  captureMeta.id = "capture_trigger";
+  captureMeta.label = "Trigger CAN Capture";
+  captureMeta.description = "Freeze raw frame capture around this moment";
+  captureMeta.category = "diagnostics";
+  engine_.registerCapability(
+      "capture_trigger",
+      [this](const ParamMap &) { capture_.trigger(micros()); }, captureMeta);
+  return true;
+}
+
+void Controller::enableHistory(Storage *storage, size_t segments) {
+  historyStorage_ = storage;
+  historySegments_ = segments;
+}
+
 bool Controller::isConnected() const { return transport_->isConnected(); }
 
 void Controller::handleCommand(const uint8_t *data, size_t len) {
@@ -162,6 +237,60 @@ void Controller::handleCommand(const uint8_t *data, size_t len) {
     return;
   }
 
+  // GET:BUSSTATS
+  if (packet == "GET:BUSSTATS") {
+    sendBusStats();
+    return;
+  }
+
+  // GET:STALE
+  if (packet == "GET:STALE") {
+    sendStaleSignals();
+    return;
+  }
+
+  // GET:HISTORY:<sig>:<from>:<to>
+  if (packet.startsWith("GET:HISTORY:")) {
+    int colon1 = packet.indexOf(':', 12);
+    int colon2 = packet.indexOf(':', colon1 + 1);
+    if (colon1 > 12 && colon2 > colon1) {
+      long sig = packet.substring(12, colon1).toInt();
+      uint32_t from =
+          strtoul(packet.substring(colon1 + 1, colon2).c_str(), nullptr, 10);
+      uint32_t to = strtoul(packet.substring(colon2 + 1).c_str(), nullptr, 10);
+      if (sig >= 0 && (size_t)sig < engine_.getSignalCount()) {
+        sendHistory(sig, from, to);
+      } else {
+        transport_->send("ERR:NO_SIGNAL");
+      }
+    }
+    return;
+  }
+
+  // GET:CAPTURE
+  if (packet == "GET:CAPTURE") {
+    sendCapture();
+    return;
+  }
+
+  // CAPTURE:ARM
+  if (packet == "CAPTURE:ARM") {
+    transport_->send(capture_.arm() ? "CAPTURE:ARMED" : "ERR:NO_CAPTURE");
+    return;
+  }
+
+  // CAPTURE:TRIGGER
+  if (packet == "CAPTURE:TRIGGER") {
+    capture_.trigger(micros());
+    return;
+  }
+
+  // CAPTURE:STOP
+  if (packet == "CAPTURE:STOP") {
+    capture_.stop();
+    return;
+  }
+
   // DEBUG:START
   if (packet == "DEBUG:START") {
     engine_.setDebugMode(true);
@@ -393,57 +522,161 @@ void Controller::sendProfile() {
     caps.push_back({entry.first, entry.second});
   }
 
+  // Profile counts are 8-bit; WBP v3 rulesets can exceed them
+  auto count8 = [](size_t n) { return (uint8_t)std::min<size_t>(n, 255); };
+
   size_t len = Protocol::serializeProfile(
       buffer, sizeof(buffer), moduleId_.c_str(), hwVersion_.c_str(),
       fwVersion_.c_str(), serialNumber_.c_str(), millis(), bootCount_,
-      rulesMode_, engine_.getRulesetCRC(), engine_.getSignalCount(),
-      engine_.getConditionCount(), engine_.getActionCount(),
-      engine_.getRuleCount(), caps);
+      rulesMode_, engine_.getRulesetCRC(), count8(engine_.getSignalCount()),
+      count8(engine_.getConditionCount()), count8(engine_.getActionCount()),
+      count8(engine_.getRuleCount()), caps);
 
   if (len == 0) {
     transport_->send("ERR:PROFILE_TOO_LARGE");
     return;
   }
 
-  // Send chunked
+  sendChunked(buffer, len, Protocol::calculateCRC32(buffer, len));
+}
+
+void Controller::sendRules() {
+  const auto &rules = engine_.getRulesetBinary();
+
+  if (rules.empty()) {
+    transport_->send("ERR:NO_RULES");
+    return;
+  }
+
+  sendChunked(rules.data(), rules.size(), engine_.getRulesetCRC());
+}
+
+void Controller::sendBusStats() {
+  String body;
+  char line[80];
+
+  snprintf(line, sizeof(line), "L:%u:%u:%u:%u\n",
+           busMonitor_.getLoadPermille(), busMonitor_.getFramesPerWindow(),
+           (unsigned)busMonitor_.getIdCount(),
+           busMonitor_.getUntrackedFrames());
+  body += line;
+
+  const BusIdStats *table = busMonitor_.getTable();
+  for (size_t i = 0; i < BusMonitor::getCapacity(); i++) {
+    const BusIdStats &e = table[i];
+    if (e.count == 0)
+      continue;
+    snprintf(line, sizeof(line), "%X:%d:%u:%u:%u:%u\n", e.id,
+             e.extended ? 1 : 0, e.count, e.meanGapUs, e.jitterUs,
+             e.maxGapUs);
+    body += line;
+  }
+
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(body.c_str());
+  sendChunked(data, body.length(),
+              Protocol::calculateCRC32(data, body.length()));
+}
+
+void Controller::sendStaleSignals() {
+  String body;
+  char line[32];
+  uint32_t now = millis();
+  const std::vector<RuntimeSignal> &signals = engine_.getSignals();
+
+  for (uint16_t idx : engine_.getStaleSignals()) {
+    const RuntimeSignal &sig = signals[idx];
+    long age = sig.everSet ? (long)(now - sig.lastUpdateMs) : -1;
+    snprintf(line, sizeof(line), "%u:%ld\n", idx, age);
+    body += line;
+  }
+
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(body.c_str());
+  sendChunked(data, body.length(),
+              Protocol::calculateCRC32(data, body.length()));
+}
+
+void Controller::sendCapture() {
+  if (capture_.getState() != FrameCapture::State::FROZEN) {
+    transport_->send("ERR:CAPTURE_NOT_READY");
+    return;
+  }
+
+  // Streamed straight from the ring; no linear copy of a PSRAM-sized buffer
   transport_->send("BEGIN");
   delay(10);
 
+  uint8_t chunk[256];
   size_t mtu = transport_->getMTU();
-  for (size_t offset = 0; offset < len; offset += mtu) {
-    size_t chunkLen = (len - offset > mtu) ? mtu : (len - offset);
-    transport_->send(buffer + offset, chunkLen);
+  size_t step = mtu < sizeof(chunk) ? mtu : sizeof(chunk);
+  size_t total = capture_.getExportSize();
+  uint32_t crc = 0;
+
+  for (size_t offset = 0; offset < total; offset += step) {
+    size_t chunkLen = capture_.readExport(offset, chunk, step);
+    crc = Protocol::calculateCRC32(chunk, chunkLen, crc);
+    transport_->send(chunk, chunkLen);
     delay(5);
   }
 
   char endMsg[64];
-  snprintf(endMsg, sizeof(endMsg), "END:%d:%u", (int)len,
-           Protocol::calculateCRC32(buffer, len));
+  snprintf(endMsg, sizeof(endMsg), "END:%d:%u", (int)total, crc);
   transport_->send(endMsg);
 }
 
-void Controller::sendRules() {
-  const auto &rules = engine_.getRulesetBinary();
+void Controller::sendHistory(uint16_t signalIdx, uint32_t fromMs,
+                             uint32_t toMs) {
+  uint32_t key = SignalHistory::signalKey(engine_.getSignals()[signalIdx]);
 
-  if (rules.empty()) {
-    transport_->send("ERR:NO_RULES");
-    return;
-  }
+  transport_->send("BEGIN");
+  delay(10);
 
+  // Whole samples per chunk, bounded by MTU
+  uint8_t chunk[256];
+  size_t mtu = transport_->getMTU();
+  size_t cap = (mtu < sizeof(chunk) ? mtu : sizeof(chunk)) & ~(size_t)7;
+  size_t used = 0;
+  size_t total = 0;
+  uint32_t crc = 0;
+
+  auto emit = [&]() {
+    crc = Protocol::calculateCRC32(chunk, used, crc);
+    transport_->send(chunk, used);
+    total += used;
+    used = 0;
+    delay(5);
+  };
+
+  uint32_t nowLog = history_.getLogTime(millis());
+  memcpy(chunk, &nowLog, 4);
+  used = 4;
+
+  history_.query(key, fromMs, toMs, [&](uint32_t timeMs, float value) {
+    if (used + 8 > cap)
+      emit();
+    memcpy(chunk + used, &timeMs, 4);
+    memcpy(chunk + used + 4, &value, 4);
+    used += 8;
+  });
+  emit();
+
+  char endMsg[64];
+  snprintf(endMsg, sizeof(endMsg), "END:%d:%u", (int)total, crc);
+  transport_->send(endMsg);
+}
+
+void Controller::sendChunked(const uint8_t *data, size_t len, uint32_t crc) {
   transport_->send("BEGIN");
   delay(10);
 
   size_t mtu = transport_->getMTU();
-  for (size_t offset = 0; offset < rules.size(); offset += mtu) {
-    size_t chunkLen =
-        (rules.size() - offset > mtu) ? mtu : (rules.size() - offset);
-    transport_->send(rules.data() + offset, chunkLen);
+  for (size_t offset = 0; offset < len; offset += mtu) {
+    size_t chunkLen = (len - offset > mtu) ? mtu : (len - offset);
+    transport_->send(data + offset, chunkLen);
     delay(5);
   }
 
   char endMsg[64];
-  snprintf(endMsg, sizeof(endMsg), "END:%d:%u", (int)rules.size(),
-           engine_.getRulesetCRC());
+  snprintf(endMsg, sizeof(endMsg), "END:%d:%u", (int)len, crc);
   transport_->send(endMsg);
 }
 
@@ -451,11 +684,15 @@ void Controller::sendStatus() {
   if (!transport_->isConnected())
     return;
 
+  CanBusStats can = canBus_->getStats();
+
   char status[128];
-  snprintf(status, sizeof(status), "S:%d:%d:%d:%d:%lu:%d", rulesMode_,
-           (int)engine_.getSignalCount(), (int)engine_.getRuleCount(),
+  snprintf(status, sizeof(status), "S:%d:%d:%d:%d:%lu:%d:%u:%u:%u:%u",
+           rulesMode_, (int)engine_.getSignalCount(),
+           (int)engine_.getRuleCount(),
            (int)engine_.getSignalCount(), // Unique CAN IDs (simplified)
-           millis(), bootCount_);
+           millis(), bootCount_, can.rxDropped, can.errorPassive, can.busOff,
+           can.recoveries);
 
   transport_->sendStatus((uint8_t *)status, strlen(status));
 }
@@ -37,8 +37,14 @@
 #include "src/interfaces/Storage.h"
 
 // Core
+#include "src/core/BusMonitor.h"
+#include "src/core/DiagPoller.h"
 #include "src/core/Engine.h"
+#include "src/core/FrameCapture.h"
+#include "src/core/Gateway.h"
 #include "src/core/Protocol.h"
+#include "src/core/SignalHistory.h"
+#include "src/core/TxScheduler.h"
 #include "src/core/Types.h"
 
 // ESP32 Drivers (optional - user can provide their own)
@@ -92,12 +98,98 @@ public:
   /**
    * @brief Register a capability handler
    * @warning Handlers are called with internal mutex held - don't call
-   * controller methods inside!
+   * controller methods inside! Slow handlers should set
+   * CapabilityMeta::async to run on the capability worker task.
    */
   void registerCapability(const String &id, CapabilityHandler handler);
   void registerCapability(const String &id, CapabilityHandler handler,
                           const CapabilityMeta &meta);
 
+  /**
+   * @brief Register a capability with a typed handler
+   * e.g. registerCapability<int, float>("fan", [](int ch, float duty) {});
+   * Parameter types are checked when a ruleset loads.
+   */
+  template <typename Arg, typename... Args, typename F>
+  void registerCapability(const String &id, F handler,
+                          const CapabilityMeta &meta = CapabilityMeta()) {
+    engine_.registerCapability<Arg, Args...>(id, handler, meta);
+  }
+
+  /**
+   * @brief Attach a second CAN interface for gateway routing
+   * Frames from this bus (index 1) are routed only, not decoded by rules.
+   * @param bus Second CAN driver (not owned)
+   */
+  void setAuxCanBus(CAN *bus);
+
+  /**
+   * @brief Add a gateway route (bus 0 = primary, 1 = aux)
+   * @return false if route invalid
+   */
+  bool addRoute(const GatewayRoute &route) { return gateway_.addRoute(route); }
+  Gateway &getGateway() { return gateway_; }
+
+  /// @brief Bus load / per-ID statistics for the primary bus
+  BusMonitor &getBusMonitor() { return busMonitor_; }
+
+  /**
+   * @brief Allocate raw frame capture ring (PSRAM when available)
+   * Armed with CAPTURE:ARM, triggered by CAPTURE:TRIGGER or the
+   * capture_trigger capability (registered here, on success), downloaded
+   * with GET:CAPTURE.
+   * @param bytes Ring size
+   * @param preMs History kept before trigger
+   * @param postMs Recording time after trigger
+   * @return false if allocation failed
+   */
+  bool enableCapture(size_t bytes, uint32_t preMs = 5000,
+                     uint32_t postMs = 1000);
+  FrameCapture &getCapture() { return capture_; }
+
+  /**
+   * @brief Let rules drive GPIO pins through built-in native outputs
+   * (gpio_set, gpio_pulse, pwm_duty). Call before loading rules.
+   * @param pinMask Bit n set = rules may drive GPIO n
+   */
+  void enableNativeOutputs(uint64_t pinMask) {
+    engine_.enableNativeOutputs(pinMask);
+  }
+
+  /**
+   * @brief Run factory rules compiled into firmware (see StaticRuleset.h)
+   * Call after enableNativeOutputs(); the ruleset must outlive the Controller.
+   */
+  template <size_t S, size_t C, size_t A, size_t R>
+  bool attachStaticRuleset(StaticRuleset<S, C, A, R> &ruleset) {
+    return engine_.attachStaticRuleset(ruleset);
+  }
+
+  /**
+   * @brief Run the WBP ruleset it was generated from through generated code
+   * (tools/wbp2cpp.py). Other rulesets stay interpreted.
+   */
+  void setCompiledRuleset(CompiledRuleset *compiled) {
+    engine_.setCompiledRuleset(compiled);
+  }
+
+  /**
+   * @brief Size the on-device signal history (call before begin())
+   * The default is HISTORY_DEFAULT_SEGMENTS in the config storage, minutes
+   * of retention; hours need a dedicated partition, e.g.
+   * NVSStorage("hist", "history"). See docs/core/history.md for sizing.
+   * @param storage Segment storage (nullptr = config storage), begun by
+   * the Controller
+   * @param segments Segment slots, 276 bytes each
+   */
+  void enableHistory(Storage *storage, size_t segments);
+
+  /// @brief On-device signal history (tracks come from the ruleset)
+  SignalHistory &getHistory() { return history_; }
+
+  /// @brief Primary CAN driver health counters
+  CanBusStats getCanStats() const { return canBus_->getStats(); }
+
   bool isConnected() const;
   uint32_t getUptime() const { return millis(); }
   uint16_t getBootCount() const { return bootCount_; }
@@ -109,7 +201,14 @@ private:
   Storage *storage_;
   Communication *transport_;
   OTA *otaService_;
+  CAN *auxCanBus_ = nullptr;
   Engine engine_;
+  Gateway gateway_;
+  BusMonitor busMonitor_;
+  FrameCapture capture_;
+  SignalHistory history_;
+  Storage *historyStorage_ = nullptr; // nullptr = storage_
+  size_t historySegments_ = HISTORY_DEFAULT_SEGMENTS;
 
   // Module info
   String moduleId_;
@@ -165,10 +264,44 @@ private:
    */
   void sendRules();
 
+  /**
+   * @brief Send bus statistics as chunked text
+   * Body: L:<loadPermille>:<framesPerSec>:<ids>:<untracked>\n then one
+   * <id>:<ext>:<count>:<meanGapUs>:<jitterUs>:<maxGapUs>\n line per ID
+   * Format: BEGIN → chunks → END:<len>:<crc>
+   */
+  void sendBusStats();
+
+  /**
+   * @brief Send stale signals as chunked text
+   * Body: one <signalIdx>:<ageMs>\n line per stale signal (age -1 if never
+   * received)
+   * Format: BEGIN → chunks → END:<len>:<crc>
+   */
+  void sendStaleSignals();
+
+  /**
+   * @brief Stream frozen frame capture to client
+   * Format: BEGIN → CaptureHeader + records → END:<len>:<crc>
+   * Returns ERR:CAPTURE_NOT_READY unless frozen
+   */
+  void sendCapture();
+
+  /**
+   * @brief Stream logged samples of one signal
+   * Body: uint32 current log time, then (uint32 timeMs, float value) pairs
+   * Format: BEGIN → chunks → END:<len>:<crc>
+   */
+  void sendHistory(uint16_t signalIdx, uint32_t fromMs, uint32_t toMs);
+
+  /** @brief Send buffer as BEGIN → MTU chunks → END:<len>:<crc> */
+  void sendChunked(const uint8_t *data, size_t len, uint32_t crc);
+
   /**
    * @brief Send status via status characteristic (every 5s when connected)
    * Format:
    * S:<rulesMode>:<signalCount>:<ruleCount>:<canIds>:<uptimeMs>:<bootCount>
+   *   :<rxDropped>:<errorPassive>:<busOff>:<recoveries>
    */
   void sendStatus();
 
@@ -0,0 +1,111 @@
+/**
+ * @file ActionScheduler.cpp
+ * @brief CORE:ActionScheduler - Timed action sequence implementation
+ */
+
+#include "ActionScheduler.h"
+#include <algorithm>
+
+namespace W4RP {
+
+bool ActionScheduler::later(const Pending &a, const Pending &b) {
+  return (int32_t)(a.dueMs - b.dueMs) > 0;
+}
+
+void ActionScheduler::load(std::vector<RuntimeActionStep> &&steps,
+                           size_t actionCount) {
+  steps_ = std::move(steps);
+  ownerStart_.assign(actionCount + 1, 0);
+  remaining_.assign(actionCount, 0);
+  size_ = 0;
+  stats_ = ActionSequenceStats();
+
+  // Steps arrive grouped by owner: count, then prefix-sum
+  for (const RuntimeActionStep &step : steps_) {
+    ownerStart_[step.ownerAction + 1]++;
+  }
+  for (size_t i = 1; i < ownerStart_.size(); i++) {
+    ownerStart_[i] += ownerStart_[i - 1];
+  }
+}
+
+void ActionScheduler::clear() {
+  steps_.clear();
+  ownerStart_.clear();
+  remaining_.clear();
+  size_ = 0;
+  stats_ = ActionSequenceStats();
+}
+
+void ActionScheduler::push(const Pending &entry) {
+  heap_[size_++] = entry;
+  std::push_heap(heap_, heap_ + size_, later);
+}
+
+void ActionScheduler::cancel(uint16_t ownerAction) {
+  size_t kept = 0;
+  for (size_t i = 0; i < size_; i++) {
+    if (steps_[heap_[i].stepIdx].ownerAction != ownerAction)
+      heap_[kept++] = heap_[i];
+  }
+  size_ = kept;
+  std::make_heap(heap_, heap_ + size_, later);
+  remaining_[ownerAction] = 0;
+}
+
+bool ActionScheduler::start(uint16_t ownerAction, uint32_t nowMs) {
+  uint16_t first = ownerStart_[ownerAction];
+  uint16_t count = ownerStart_[ownerAction + 1] - first;
+  if (count == 0)
+    return false;
+
+  if (remaining_[ownerAction] > 0) {
+    cancel(ownerAction);
+    stats_.cancelled++;
+  }
+
+  if (size_ + count > ACTION_SCHEDULER_CAPACITY) {
+    stats_.dropped++;
+    return false;
+  }
+
+  for (uint16_t s = first; s < first + count; s++) {
+    push({nowMs + steps_[s].delayMs, s, 0});
+  }
+  remaining_[ownerAction] = count;
+  stats_.started++;
+  return true;
+}
+
+bool ActionScheduler::popDue(uint32_t nowMs, DueStep &out) {
+  if (size_ == 0 || (int32_t)(nowMs - heap_[0].dueMs) < 0)
+    return false;
+
+  std::pop_heap(heap_, heap_ + size_, later);
+  Pending entry = heap_[--size_];
+  const RuntimeActionStep &step = steps_[entry.stepIdx];
+
+  out.actionIdx = step.stepAction;
+  out.paramIdx = -1;
+  out.value = 0.0f;
+
+  if (step.kind == ActionStepKind::RAMP) {
+    uint16_t ticks = step.durationMs / step.intervalMs;
+    out.paramIdx = step.paramIdx;
+    out.value = step.from + (step.to - step.from) * entry.tick / ticks;
+
+    // Re-queue from the previous due time so the ramp doesn't drift
+    if (entry.tick < ticks) {
+      entry.tick++;
+      entry.dueMs += step.intervalMs;
+      push(entry);
+      return true;
+    }
+  }
+
+  if (--remaining_[step.ownerAction] == 0)
+    stats_.completed++;
+  return true;
+}
+
+} // namespace W4RP
@@ -0,0 +1,97 @@
+/**
+ * @file ActionScheduler.h
+ * @brief CORE:ActionScheduler - Timed action sequences (delay, pulse, ramp)
+ * @version 1.0.0
+ *
+ * Actions with WBP action steps start a sequence when they run. Pending
+ * steps sit in a fixed-size min-heap keyed by due time; the Engine pops due
+ * steps each loop, so multi-step outputs ("open, 300 ms later close") never
+ * block. A ramp step holds one heap entry and re-queues itself per call.
+ */
+#pragma once
+#include "Types.h"
+#include <vector>
+
+namespace W4RP {
+
+#define ACTION_SCHEDULER_CAPACITY 32
+
+/**
+ * @struct ActionSequenceStats
+ * @brief Sequence counters since ruleset load
+ */
+struct ActionSequenceStats {
+  uint32_t started = 0;
+  uint32_t completed = 0;
+  uint32_t cancelled = 0; // Restarted by their owner before finishing
+  uint32_t dropped = 0;   // Not enough free heap entries
+};
+
+/**
+ * @class ActionScheduler
+ * @brief Fixed-capacity scheduler of action steps
+ */
+class ActionScheduler {
+public:
+  /// @brief Step due for execution
+  struct DueStep {
+    uint16_t actionIdx;
+    int16_t paramIdx; // Parameter overridden with value (-1 = none)
+    float value;
+  };
+
+  /**
+   * @brief Install steps of a ruleset (cancels everything pending)
+   * @param steps Steps grouped by owner action
+   * @param actionCount Actions in the ruleset
+   */
+  void load(std::vector<RuntimeActionStep> &&steps, size_t actionCount);
+
+  /// @brief Drop all steps and pending entries
+  void clear();
+
+  /// @brief Check if an action owns a sequence
+  bool hasSteps(uint16_t actionIdx) const {
+    return (size_t)actionIdx + 1 < ownerStart_.size() &&
+           ownerStart_[actionIdx + 1] > ownerStart_[actionIdx];
+  }
+
+  /**
+   * @brief Start the sequence of an action (restarts a running one)
+   * @param ownerAction Action that just ran
+   * @param nowMs Current millis()
+   * @return false if the heap has no room (counted as dropped)
+   */
+  bool start(uint16_t ownerAction, uint32_t nowMs);
+
+  /**
+   * @brief Pop next due step
+   * @param nowMs Current millis()
+   * @param out Step to execute
+   * @return false if nothing is due
+   */
+  bool popDue(uint32_t nowMs, DueStep &out);
+
+  size_t getPendingCount() const { return size_; }
+  const ActionSequenceStats &getStats() const { return stats_; }
+
+private:
+  struct Pending {
+    uint32_t dueMs;
+    uint16_t stepIdx;
+    uint16_t tick; // RAMP: calls made so far
+  };
+
+  std::vector<RuntimeActionStep> steps_;
+  std::vector<uint16_t> ownerStart_; // Action -> first step (CSR)
+  std::vector<uint8_t> remaining_;   // Action -> unfinished steps
+  Pending heap_[ACTION_SCHEDULER_CAPACITY];
+  size_t size_ = 0;
+  ActionSequenceStats stats_;
+
+  void push(const Pending &entry);
+  void cancel(uint16_t ownerAction);
+  static bool later(const Pending &a, const Pending &b);
+};
+
+} // namespace W4RP
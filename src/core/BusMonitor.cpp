@@ -0,0 +1,104 @@
+/**
+ * @file BusMonitor.cpp
+ * @brief CORE:BusMonitor - Bus statistics implementation
+ */
+
+#include "BusMonitor.h"
+#include <cstring>
+
+namespace W4RP {
+
+namespace {
+constexpr uint32_t HASH_MULTIPLIER = 2654435761u; // Knuth
+constexpr uint8_t EWMA_SHIFT = 4;                 // 1/16 smoothing
+} // namespace
+
+BusMonitor::BusMonitor() { reset(); }
+
+void BusMonitor::reset() {
+  memset(table_, 0, sizeof(table_));
+  idCount_ = 0;
+  totalFrames_ = 0;
+  untrackedFrames_ = 0;
+  windowBits_ = 0;
+  windowFrames_ = 0;
+  lastWindowFrames_ = 0;
+  loadPermille_ = 0;
+  windowStartUs_ = micros();
+}
+
+uint32_t BusMonitor::frameBits(uint8_t dlc, bool extended) {
+  if (dlc > 8)
+    dlc = 8;
+  // SOF..EOF + 3 bit interframe space
+  return (extended ? 67 : 47) + 8 * dlc;
+}
+
+void BusMonitor::record(const CanFrame &frame, uint32_t nowUs) {
+  if (!enabled_)
+    return;
+
+  totalFrames_++;
+  windowFrames_++;
+  windowBits_ += frameBits(frame.dlc, frame.extended);
+
+  size_t mask = BUS_MONITOR_CAPACITY - 1;
+  uint32_t hash = frame.id * HASH_MULTIPLIER;
+  size_t idx = hash >> (32 - BUS_MONITOR_CAPACITY_BITS);
+
+  for (size_t probe = 0; probe < BUS_MONITOR_MAX_PROBE; probe++) {
+    BusIdStats &e = table_[idx];
+
+    if (e.count == 0) {
+      e.id = frame.id;
+      e.extended = frame.extended;
+      e.count = 1;
+      e.lastUs = nowUs;
+      idCount_++;
+      return;
+    }
+
+    if (e.id == frame.id && e.extended == frame.extended) {
+      uint32_t gap = nowUs - e.lastUs;
+      e.lastUs = nowUs;
+      e.count++;
+
+      if (e.count == 2) {
+        e.meanGapUs = gap;
+      } else {
+        int32_t diff = (int32_t)(gap - e.meanGapUs);
+        e.meanGapUs += diff >> EWMA_SHIFT;
+        uint32_t absDiff = diff < 0 ? -diff : diff;
+        e.jitterUs += ((int32_t)(absDiff - e.jitterUs)) >> EWMA_SHIFT;
+      }
+      if (gap > e.maxGapUs)
+        e.maxGapUs = gap;
+      return;
+    }
+
+    idx = (idx + 1) & mask;
+  }
+
+  untrackedFrames_++;
+}
+
+void BusMonitor::tick(uint32_t nowUs) {
+  if (!enabled_)
+    return;
+
+  uint32_t elapsed = nowUs - windowStartUs_;
+  if (elapsed < BUS_MONITOR_WINDOW_US)
+    return;
+
+  uint64_t capacityBits = (uint64_t)bitrate_ * elapsed / 1000000;
+  uint64_t load =
+      capacityBits ? (uint64_t)windowBits_ * 1000 / capacityBits : 0;
+  loadPermille_ = load > 1000 ? 1000 : load;
+  lastWindowFrames_ = windowFrames_;
+
+  windowBits_ = 0;
+  windowFrames_ = 0;
+  windowStartUs_ = nowUs;
+}
+
+} // namespace W4RP
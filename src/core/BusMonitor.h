@@ -0,0 +1,110 @@
+/**
+ * @file BusMonitor.h
+ * @brief CORE:BusMonitor - Bus load and per-ID frequency statistics
+ * @version 1.0.0
+ *
+ * Counts every received frame in a fixed-size open-addressed table and
+ * estimates bus load from DLC and bit rate. Cost per frame is one hash
+ * probe and a few integer updates; no allocation after construction.
+ */
+#pragma once
+#include "../interfaces/CAN.h"
+
+namespace W4RP {
+
+#define BUS_MONITOR_CAPACITY_BITS 7
+#define BUS_MONITOR_CAPACITY (1 << BUS_MONITOR_CAPACITY_BITS)
+#define BUS_MONITOR_MAX_PROBE 8 // Bounds per-frame cost once the table fills
+#define BUS_MONITOR_WINDOW_US 1000000
+
+/**
+ * @struct BusIdStats
+ * @brief Per-ID counters. Gaps are measured at dequeue time.
+ */
+struct BusIdStats {
+  uint32_t id;
+  bool extended;
+  uint32_t count;
+  uint32_t lastUs;
+  uint32_t meanGapUs; // EWMA of inter-arrival time
+  uint32_t jitterUs;  // EWMA of |gap - mean|
+  uint32_t maxGapUs;
+};
+
+/**
+ * @class BusMonitor
+ * @brief Low-overhead RX statistics stage
+ */
+class BusMonitor {
+public:
+  BusMonitor();
+
+  /// @brief Enable/disable collection (default: enabled)
+  void setEnabled(bool enabled) { enabled_ = enabled; }
+  bool isEnabled() const { return enabled_; }
+
+  /**
+   * @brief Set nominal bit rate for load estimation
+   * @param bitsPerSecond Bus bit rate (default 500000)
+   */
+  void setBitrate(uint32_t bitsPerSecond) { bitrate_ = bitsPerSecond; }
+
+  /**
+   * @brief Record a received frame
+   * @param frame CAN frame
+   * @param nowUs Current time in microseconds
+   */
+  void record(const CanFrame &frame, uint32_t nowUs);
+
+  /**
+   * @brief Close the load window if elapsed (call once per loop)
+   * @param nowUs Current time in microseconds
+   */
+  void tick(uint32_t nowUs);
+
+  /// @brief Clear all counters
+  void reset();
+
+  /// @brief Bus load over the last window, in 0.1 % units
+  uint16_t getLoadPermille() const { return loadPermille_; }
+
+  /// @brief Frames over the last window
+  uint32_t getFramesPerWindow() const { return lastWindowFrames_; }
+
+  /// @brief Total frames recorded
+  uint32_t getTotalFrames() const { return totalFrames_; }
+
+  /// @brief Frames whose ID found no slot within BUS_MONITOR_MAX_PROBE
+  uint32_t getUntrackedFrames() const { return untrackedFrames_; }
+
+  /// @brief Number of distinct IDs tracked
+  size_t getIdCount() const { return idCount_; }
+
+  /// @brief Raw table (entries with count == 0 are empty)
+  const BusIdStats *getTable() const { return table_; }
+  static constexpr size_t getCapacity() { return BUS_MONITOR_CAPACITY; }
+
+  /**
+   * @brief Nominal frame length on the wire (no stuff bits)
+   * @param dlc Data length code
+   * @param extended 29-bit identifier
+   * @return Bits including interframe space
+   */
+  static uint32_t frameBits(uint8_t dlc, bool extended);
+
+private:
+  BusIdStats table_[BUS_MONITOR_CAPACITY];
+  size_t idCount_ = 0;
+  bool enabled_ = true;
+  uint32_t bitrate_ = 500000;
+
+  uint32_t totalFrames_ = 0;
+  uint32_t untrackedFrames_ = 0;
+  uint32_t windowStartUs_ = 0;
+  uint32_t windowBits_ = 0;
+  uint32_t windowFrames_ = 0;
+  uint32_t lastWindowFrames_ = 0;
+  uint16_t loadPermille_ = 0;
+};
+
+} // namespace W4RP
@@ -0,0 +1,137 @@
+/**
+ * @file CapabilityWorker.cpp
+ * @brief CORE:CapabilityWorker - Async capability execution implementation
+ */
+
+#include "CapabilityWorker.h"
+
+namespace W4RP {
+
+CapabilityWorker::~CapabilityWorker() {
+  if (task_)
+    vTaskDelete(task_);
+  if (freeJobs_)
+    vQueueDelete(freeJobs_);
+  if (readyJobs_)
+    vQueueDelete(readyJobs_);
+}
+
+bool CapabilityWorker::start() {
+  if (task_)
+    return true;
+
+  freeJobs_ = xQueueCreate(CAPABILITY_WORKER_QUEUE, sizeof(uint8_t));
+  readyJobs_ = xQueueCreate(CAPABILITY_WORKER_QUEUE, sizeof(uint8_t));
+  if (!freeJobs_ || !readyJobs_) {
+    Serial.println("[W4RP] Capability worker: queue allocation failed");
+    return false;
+  }
+
+  for (uint8_t i = 0; i < CAPABILITY_WORKER_QUEUE; i++) {
+    xQueueSend(freeJobs_, &i, 0);
+  }
+
+  if (xTaskCreate(taskEntry, "W4RP_Caps", CAPABILITY_WORKER_STACK, this,
+                  tskIDLE_PRIORITY + 1, &task_) != pdPASS) {
+    Serial.println("[W4RP] Capability worker: task creation failed");
+    task_ = nullptr;
+    return false;
+  }
+
+  return true;
+}
+
+int8_t CapabilityWorker::addHandler(const String &id, uint32_t budgetMs) {
+  if (budgetMs == 0)
+    budgetMs = CAPABILITY_WORKER_DEFAULT_BUDGET_MS;
+
+  for (size_t i = 0; i < handlerCount_; i++) {
+    if (ids_[i] == id) {
+      budgetMs_[i] = budgetMs;
+      return i;
+    }
+  }
+
+  if (handlerCount_ >= CAPABILITY_WORKER_MAX_HANDLERS || !start())
+    return -1;
+
+  ids_[handlerCount_] = id;
+  budgetMs_[handlerCount_] = budgetMs;
+  return handlerCount_++;
+}
+
+bool CapabilityWorker::submit(uint8_t slot, const CapabilityHandler &handler,
+                              ParamMap &&params) {
+  AsyncCapabilityStats &stats = stats_[slot];
+
+  uint8_t idx;
+  if (xQueueReceive(freeJobs_, &idx, 0) != pdTRUE) {
+    stats.dropped++;
+    return false;
+  }
+
+  Job &job = jobs_[idx];
+  job.slot = slot;
+  job.handler = handler;
+  job.params = std::move(params);
+
+  // Cannot fail: both queues together hold each index exactly once
+  xQueueSend(readyJobs_, &idx, 0);
+  stats.queued++;
+  return true;
+}
+
+bool CapabilityWorker::processJob(TickType_t wait) {
+  uint8_t idx;
+  if (xQueueReceive(readyJobs_, &idx, wait) != pdTRUE)
+    return false;
+
+  Job &job = jobs_[idx];
+  AsyncCapabilityStats &stats = stats_[job.slot];
+
+  runStartMs_ = millis();
+  stallReported_ = false;
+  runningSlot_ = job.slot;
+
+  uint32_t startUs = micros();
+  job.handler(job.params);
+  uint32_t runUs = micros() - startUs;
+
+  runningSlot_ = -1;
+  stats.lastRunUs = runUs;
+  if (runUs > stats.maxRunUs)
+    stats.maxRunUs = runUs;
+  if (runUs > budgetMs_[job.slot] * 1000)
+    stats.overruns++;
+  stats.completed++;
+
+  // Release captured state before the slot is reused
+  job.handler = nullptr;
+  job.params.clear();
+  xQueueSend(freeJobs_, &idx, 0);
+  return true;
+}
+
+void CapabilityWorker::checkWatchdog(uint32_t nowMs) {
+  int8_t slot = runningSlot_;
+  if (slot < 0 || stallReported_)
+    return;
+
+  uint32_t elapsedMs = nowMs - runStartMs_;
+  if (elapsedMs <= budgetMs_[slot])
+    return;
+
+  stallReported_ = true;
+  stats_[slot].stalls++;
+  Serial.printf("[W4RP] Async capability '%s' running for %lu ms\n",
+                ids_[slot].c_str(), (unsigned long)elapsedMs);
+}
+
+void CapabilityWorker::taskEntry(void *arg) {
+  CapabilityWorker *self = static_cast<CapabilityWorker *>(arg);
+  for (;;) {
+    self->processJob(portMAX_DELAY);
+  }
+}
+
+} // namespace W4RP
@@ -0,0 +1,104 @@
+/**
+ * @file CapabilityWorker.h
+ * @brief CORE:CapabilityWorker - Async capability execution task
+ * @version 1.0.0
+ *
+ * Runs handlers of capabilities registered as async on a FreeRTOS worker
+ * task, so slow handlers (I2C, Serial, delay() pulses) don't stall CAN
+ * processing. Jobs live in a fixed table; a free-list queue and a ready
+ * queue carry job indices, so a full table drops the call instead of
+ * blocking the engine.
+ */
+#pragma once
+#include "Types.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+namespace W4RP {
+
+#define CAPABILITY_WORKER_QUEUE 8        // Pending + running jobs
+#define CAPABILITY_WORKER_MAX_HANDLERS 8 // Distinct async capabilities
+#define CAPABILITY_WORKER_STACK 4096
+#define CAPABILITY_WORKER_DEFAULT_BUDGET_MS 50
+
+/**
+ * @struct AsyncCapabilityStats
+ * @brief Per-capability execution counters since boot
+ */
+struct AsyncCapabilityStats {
+  uint32_t queued = 0;
+  uint32_t dropped = 0;   // Job table full
+  uint32_t completed = 0;
+  uint32_t overruns = 0;  // Finished after the budget
+  uint32_t stalls = 0;    // Still running past the budget (watchdog)
+  uint32_t lastRunUs = 0;
+  uint32_t maxRunUs = 0;
+};
+
+/**
+ * @class CapabilityWorker
+ * @brief Bounded job queue serviced by one worker task
+ */
+class CapabilityWorker {
+public:
+  ~CapabilityWorker();
+
+  /**
+   * @brief Add async capability (starts the task on first use)
+   * @param id Capability ID (re-adding returns the existing slot)
+   * @param budgetMs Execution-time budget (0 = default)
+   * @return Handler slot or -1 if the task could not start / table full
+   */
+  int8_t addHandler(const String &id, uint32_t budgetMs);
+
+  /**
+   * @brief Queue a call (non-blocking)
+   * @param slot Handler slot from addHandler()
+   * @param handler Handler to run (copied)
+   * @param params Parameters (moved)
+   * @return false if the job table is full (counted as dropped)
+   */
+  bool submit(uint8_t slot, const CapabilityHandler &handler,
+              ParamMap &&params);
+
+  /**
+   * @brief Report a handler running past its budget (call from loop)
+   * @param nowMs Current millis()
+   */
+  void checkWatchdog(uint32_t nowMs);
+
+  size_t getHandlerCount() const { return handlerCount_; }
+  const String &getHandlerId(uint8_t slot) const { return ids_[slot]; }
+  const AsyncCapabilityStats &getStats(uint8_t slot) const {
+    return stats_[slot];
+  }
+
+private:
+  struct Job {
+    uint8_t slot = 0;
+    CapabilityHandler handler;
+    ParamMap params;
+  };
+
+  Job jobs_[CAPABILITY_WORKER_QUEUE];
+  QueueHandle_t freeJobs_ = nullptr;  // Indices the engine may fill
+  QueueHandle_t readyJobs_ = nullptr; // Indices waiting for the task
+  TaskHandle_t task_ = nullptr;
+
+  String ids_[CAPABILITY_WORKER_MAX_HANDLERS];
+  uint32_t budgetMs_[CAPABILITY_WORKER_MAX_HANDLERS] = {};
+  AsyncCapabilityStats stats_[CAPABILITY_WORKER_MAX_HANDLERS];
+  size_t handlerCount_ = 0;
+
+  // Job in progress, read by checkWatchdog() on the loop task
+  volatile int8_t runningSlot_ = -1;
+  volatile uint32_t runStartMs_ = 0;
+  volatile bool stallReported_ = false;
+
+  bool start();
+  bool processJob(TickType_t wait);
+  static void taskEntry(void *arg);
+};
+
+} // namespace W4RP
@@ -0,0 +1,62 @@
+/**
+ * @file CompiledRuleset.h
+ * @brief CORE:CompiledRuleset - Generated decode/condition backend
+ * @version 1.0.0
+ *
+ * tools/wbp2cpp.py turns a WBP ruleset into a translation unit with one
+ * switch case per CAN ID: shift/mask decodes specialized per signal, then
+ * the conditions reading those signals as inline comparisons. When the
+ * loaded ruleset has the CRC the code was generated from, the Engine calls
+ * it instead of the signal index and the condition interpreter. Rules,
+ * action dispatch, sequences and history are unchanged.
+ *
+ * @code
+ * W4RP::CompiledRuleset &fleetRules(); // Generated fleet_rules.cpp
+ * w4rp.setCompiledRuleset(&fleetRules());
+ * @endcode
+ */
+#pragma once
+#include "Types.h"
+
+namespace W4RP {
+
+/**
+ * @class CompiledRuleset
+ * @brief Ruleset-specific replacement for signal decoding and conditions
+ */
+class CompiledRuleset {
+public:
+  virtual ~CompiledRuleset() = default;
+
+  /// @brief CRC32 of the WBP binary the code was generated from
+  virtual uint32_t sourceCRC() const = 0;
+
+  /**
+   * @brief Decode a frame and re-evaluate conditions reading its signals
+   * @param id CAN ID
+   * @param data Frame payload (8 bytes)
+   * @param signals Engine signal table, in WBP order
+   * @param results Condition result bitmap (bit n = condition n)
+   * @param nowMs Receive time
+   * @return false if no signal of the ruleset uses this ID
+   */
+  virtual bool processFrame(uint32_t id, const uint8_t *data,
+                            RuntimeSignal *signals, uint32_t &results,
+                            uint32_t nowMs) = 0;
+
+protected:
+  /// @brief Store a decoded value the way Engine::setSignalValue() does
+  static void store(RuntimeSignal &sig, float value, uint32_t nowMs) {
+    sig.lastValue = sig.value;
+    sig.value = value;
+    sig.lastUpdateMs = nowMs;
+    sig.everSet = true;
+  }
+
+  /// @brief Set or clear one condition result
+  static void set(uint32_t &results, uint32_t bit, bool met) {
+    results = met ? (results | bit) : (results & ~bit);
+  }
+};
+
+} // namespace W4RP
@@ -0,0 +1,264 @@
+/**
+ * @file DiagPoller.cpp
+ * @brief CORE:DiagPoller - OBD-II/UDS polling implementation
+ */
+
+#include "DiagPoller.h"
+#include <cstring>
+
+namespace W4RP {
+
+namespace {
+constexpr uint32_t RESPONSE_TIMEOUT_MS = 150;           // P2 + margin
+constexpr uint32_t RESPONSE_PENDING_TIMEOUT_MS = 5000;  // P2*
+constexpr uint32_t CONSECUTIVE_FRAME_TIMEOUT_MS = 1000; // N_Cr
+constexpr uint32_t OBD_FUNCTIONAL_ID = 0x7DF;
+constexpr uint8_t PAD_BYTE = 0xCC;
+
+constexpr uint8_t PCI_SINGLE = 0x0;
+constexpr uint8_t PCI_FIRST = 0x1;
+constexpr uint8_t PCI_CONSECUTIVE = 0x2;
+constexpr uint8_t FC_CONTINUE = 0x30;
+constexpr uint8_t FC_OVERFLOW = 0x32;
+
+constexpr uint8_t SID_NEGATIVE_RESPONSE = 0x7F;
+constexpr uint8_t SID_READ_DATA_BY_ID = 0x22;
+constexpr uint8_t NRC_RESPONSE_PENDING = 0x78;
+} // namespace
+
+void DiagPoller::load(std::vector<RuntimeDiagPoll> polls) {
+  polls_ = std::move(polls);
+  stats_ = DiagPollerStats();
+  reset();
+}
+
+void DiagPoller::clear() {
+  polls_.clear();
+  reset();
+}
+
+void DiagPoller::reset() {
+  state_ = State::IDLE;
+  rxLen_ = 0;
+  rxExpected_ = 0;
+  rxNextSeq_ = 0;
+  flowControlPending_ = false;
+}
+
+size_t DiagPoller::responseHeaderLen() const {
+  if (polls_.empty())
+    return 0;
+  // Positive response SID + echoed PID (1 byte) or DID (2 bytes)
+  return (polls_[activeIdx_].service == SID_READ_DATA_BY_ID) ? 3 : 2;
+}
+
+void DiagPoller::service(CAN &bus, uint32_t nowMs) {
+  if (polls_.empty())
+    return;
+
+  // Flow control answers a first frame and takes priority
+  if (flowControlPending_) {
+    flowControlPending_ = false;
+    if (!sendFlowControl(bus)) {
+      stats_.txFailures++;
+    }
+    if (flowStatus_ != FC_CONTINUE) {
+      reset();
+    }
+    return;
+  }
+
+  if (state_ != State::IDLE) {
+    if ((int32_t)(nowMs - deadlineMs_) < 0)
+      return;
+    stats_.timeouts++;
+    reset();
+  }
+
+  // Bus-load limit
+  if (nowMs - lastRequestMs_ < minRequestGapMs_)
+    return;
+
+  // Pick the most overdue poll; never-requested polls go first
+  int best = -1;
+  uint32_t bestLateness = 0;
+  for (size_t i = 0; i < polls_.size(); i++) {
+    const RuntimeDiagPoll &poll = polls_[i];
+    uint32_t lateness = UINT32_MAX;
+    if (poll.everRequested) {
+      uint32_t elapsed = nowMs - poll.lastRequestMs;
+      if (elapsed < poll.periodMs)
+        continue;
+      lateness = elapsed - poll.periodMs;
+    }
+    if (best < 0 || lateness > bestLateness) {
+      best = i;
+      bestLateness = lateness;
+    }
+  }
+
+  if (best >= 0) {
+    activeIdx_ = best;
+    sendRequest(bus, polls_[best], nowMs);
+  }
+}
+
+bool DiagPoller::sendRequest(CAN &bus, RuntimeDiagPoll &poll,
+                             uint32_t nowMs) {
+  CanFrame frame = {};
+  frame.id = poll.requestId;
+  frame.extended = poll.extended;
+  frame.dlc = 8;
+  memset(frame.data, PAD_BYTE, sizeof(frame.data));
+
+  if (poll.service == SID_READ_DATA_BY_ID) {
+    frame.data[0] = 3;
+    frame.data[1] = poll.service;
+    frame.data[2] = poll.identifier >> 8;
+    frame.data[3] = poll.identifier & 0xFF;
+  } else {
+    frame.data[0] = 2;
+    frame.data[1] = poll.service;
+    frame.data[2] = poll.identifier & 0xFF;
+  }
+
+  // Reschedule even on failure so a dead bus isn't hammered
+  poll.lastRequestMs = nowMs;
+  poll.everRequested = true;
+  lastRequestMs_ = nowMs;
+
+  if (!bus.tryTransmit(frame)) {
+    stats_.txFailures++;
+    return false;
+  }
+
+  stats_.requests++;
+  state_ = State::AWAIT_RESPONSE;
+  deadlineMs_ = nowMs + RESPONSE_TIMEOUT_MS;
+  rxLen_ = 0;
+  return true;
+}
+
+bool DiagPoller::sendFlowControl(CAN &bus) {
+  const RuntimeDiagPoll &poll = polls_[activeIdx_];
+
+  CanFrame frame = {};
+  // Functional requests get flow control on the physical request ID
+  frame.id = (poll.requestId == OBD_FUNCTIONAL_ID) ? poll.responseId - 8
+                                                    : poll.requestId;
+  frame.extended = poll.extended;
+  frame.dlc = 8;
+  memset(frame.data, PAD_BYTE, sizeof(frame.data));
+  frame.data[0] = flowStatus_;
+  frame.data[1] = 0; // Block size: send all
+  frame.data[2] = 0; // STmin: no delay
+
+  return bus.tryTransmit(frame);
+}
+
+bool DiagPoller::processFrame(const CanFrame &frame, uint32_t nowMs) {
+  if (state_ == State::IDLE || polls_.empty())
+    return false;
+
+  const RuntimeDiagPoll &poll = polls_[activeIdx_];
+  if (frame.id != poll.responseId || frame.extended != poll.extended ||
+      frame.dlc < 2)
+    return false;
+
+  switch (frame.data[0] >> 4) {
+  case PCI_SINGLE: {
+    if (state_ != State::AWAIT_RESPONSE)
+      return false;
+    size_t len = frame.data[0] & 0x0F;
+    if (len == 0 || len > (size_t)(frame.dlc - 1))
+      return false;
+    memcpy(rxBuf_, frame.data + 1, len);
+    rxLen_ = len;
+    return completeResponse(nowMs);
+  }
+
+  case PCI_FIRST: {
+    if (state_ != State::AWAIT_RESPONSE || frame.dlc < 8)
+      return false;
+    size_t len = ((frame.data[0] & 0x0F) << 8) | frame.data[1];
+    if (len < 8)
+      return false;
+
+    flowControlPending_ = true;
+    if (len > ISOTP_MAX_PAYLOAD) {
+      stats_.overflows++;
+      flowStatus_ = FC_OVERFLOW;
+      return false;
+    }
+
+    flowStatus_ = FC_CONTINUE;
+    memcpy(rxBuf_, frame.data + 2, 6);
+    rxLen_ = 6;
+    rxExpected_ = len;
+    rxNextSeq_ = 1;
+    state_ = State::RECEIVING;
+    deadlineMs_ = nowMs + CONSECUTIVE_FRAME_TIMEOUT_MS;
+    return false;
+  }
+
+  case PCI_CONSECUTIVE: {
+    if (state_ != State::RECEIVING)
+      return false;
+    if ((frame.data[0] & 0x0F) != rxNextSeq_) {
+      reset();
+      return false;
+    }
+
+    size_t n = rxExpected_ - rxLen_;
+    if (n > (size_t)(frame.dlc - 1))
+      n = frame.dlc - 1;
+    memcpy(rxBuf_ + rxLen_, frame.data + 1, n);
+    rxLen_ += n;
+    rxNextSeq_ = (rxNextSeq_ + 1) & 0x0F;
+    deadlineMs_ = nowMs + CONSECUTIVE_FRAME_TIMEOUT_MS;
+
+    if (rxLen_ < rxExpected_)
+      return false;
+    return completeResponse(nowMs);
+  }
+
+  default:
+    return false;
+  }
+}
+
+bool DiagPoller::completeResponse(uint32_t nowMs) {
+  const RuntimeDiagPoll &poll = polls_[activeIdx_];
+
+  if (rxLen_ >= 3 && rxBuf_[0] == SID_NEGATIVE_RESPONSE &&
+      rxBuf_[1] == poll.service) {
+    if (rxBuf_[2] == NRC_RESPONSE_PENDING) {
+      state_ = State::AWAIT_RESPONSE;
+      deadlineMs_ = nowMs + RESPONSE_PENDING_TIMEOUT_MS;
+      rxLen_ = 0;
+      return false;
+    }
+    stats_.negativeResponses++;
+    reset();
+    return false;
+  }
+
+  size_t headerLen = responseHeaderLen();
+  bool idMatches =
+      (headerLen == 3)
+          ? (rxLen_ >= 3 && ((rxBuf_[1] << 8) | rxBuf_[2]) == poll.identifier)
+          : (rxLen_ >= 2 && rxBuf_[1] == (poll.identifier & 0xFF));
+
+  if (rxBuf_[0] != (uint8_t)(poll.service + 0x40) || !idMatches) {
+    // Unrelated response on the same ID - keep waiting until deadline
+    state_ = State::AWAIT_RESPONSE;
+    rxLen_ = 0;
+    return false;
+  }
+
+  stats_.responses++;
+  state_ = State::IDLE;
+  return true;
+}
+
+} // namespace W4RP
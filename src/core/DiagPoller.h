@@ -0,0 +1,107 @@
+/**
+ * @file DiagPoller.h
+ * @brief CORE:DiagPoller - OBD-II/UDS polling with ISO-TP reassembly
+ * @version 1.0.0
+ *
+ * Issues scheduled diagnostic requests through CAN::tryTransmit and
+ * reassembles ISO-TP responses in a fixed buffer. One request is in flight
+ * at a time; a minimum gap between requests bounds the added bus load.
+ */
+#pragma once
+#include "../interfaces/CAN.h"
+#include "Types.h"
+#include <vector>
+
+namespace W4RP {
+
+#define ISOTP_MAX_PAYLOAD 256
+
+/**
+ * @struct DiagPollerStats
+ * @brief Request/response counters since load
+ */
+struct DiagPollerStats {
+  uint32_t requests = 0;
+  uint32_t responses = 0;
+  uint32_t negativeResponses = 0;
+  uint32_t timeouts = 0;
+  uint32_t txFailures = 0;
+  uint32_t overflows = 0;
+};
+
+/**
+ * @class DiagPoller
+ * @brief Diagnostic request scheduler + ISO-TP receiver
+ */
+class DiagPoller {
+public:
+  /**
+   * @brief Replace poll table (resets in-flight request)
+   * @param polls Poll definitions from ruleset
+   */
+  void load(std::vector<RuntimeDiagPoll> polls);
+
+  /// @brief Drop all polls
+  void clear();
+
+  /// @brief Check if any polls are configured
+  bool isActive() const { return !polls_.empty(); }
+
+  /**
+   * @brief Set minimum gap between requests (bus-load limit)
+   * @param ms Gap in milliseconds
+   */
+  void setMinRequestGap(uint16_t ms) { minRequestGapMs_ = ms; }
+
+  /**
+   * @brief Send pending flow control or next due request
+   * @param bus CAN bus to transmit on
+   * @param nowMs Current time
+   */
+  void service(CAN &bus, uint32_t nowMs);
+
+  /**
+   * @brief Feed received frame
+   * @param frame CAN frame from bus
+   * @param nowMs Current time
+   * @return true if frame completed a positive response
+   */
+  bool processFrame(const CanFrame &frame, uint32_t nowMs);
+
+  /// @brief Poll answered by the last completed response
+  const RuntimeDiagPoll &completedPoll() const { return polls_[activeIdx_]; }
+
+  /// @brief Response data after the echoed service and PID/DID
+  const uint8_t *responseData() const { return rxBuf_ + responseHeaderLen(); }
+
+  /// @brief Length of responseData()
+  size_t responseLength() const { return rxLen_ - responseHeaderLen(); }
+
+  const DiagPollerStats &getStats() const { return stats_; }
+
+private:
+  enum class State : uint8_t { IDLE, AWAIT_RESPONSE, RECEIVING };
+
+  std::vector<RuntimeDiagPoll> polls_;
+  DiagPollerStats stats_;
+  State state_ = State::IDLE;
+  size_t activeIdx_ = 0;
+  uint32_t deadlineMs_ = 0;
+  uint32_t lastRequestMs_ = 0;
+  uint16_t minRequestGapMs_ = 25;
+
+  uint8_t rxBuf_[ISOTP_MAX_PAYLOAD];
+  size_t rxLen_ = 0;
+  size_t rxExpected_ = 0;
+  uint8_t rxNextSeq_ = 0;
+  bool flowControlPending_ = false;
+  uint8_t flowStatus_ = 0;
+
+  bool sendRequest(CAN &bus, RuntimeDiagPoll &poll, uint32_t nowMs);
+  bool sendFlowControl(CAN &bus);
+  bool completeResponse(uint32_t nowMs);
+  size_t responseHeaderLen() const;
+  void reset();
+};
+
+} // namespace W4RP
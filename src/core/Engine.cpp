@@ -10,8 +10,8 @@
 
 namespace W4RP {
 
-static uint64_t extractBits(const uint8_t data[8], uint16_t start, uint8_t len,
-                            bool bigEndian) {
+static uint64_t extractBits(const uint8_t *data, size_t dataLen, uint16_t start,
+                            uint8_t len, bool bigEndian) {
   if (len == 0 || len > 64)
     return 0;
 
@@ -19,10 +19,10 @@ static uint64_t extractBits(const uint8_t data[8], uint16_t start, uint8_t len,
 
   if (!bigEndian) {
     for (uint8_t i = 0; i < len; i++) {
-      uint16_t bitPos = start + i;
-      uint8_t byteIdx = bitPos / 8;
+      uint32_t bitPos = start + i;
+      size_t byteIdx = bitPos / 8;
       uint8_t bitIdx = bitPos % 8;
-      if (byteIdx < 8) {
+      if (byteIdx < dataLen) {
         uint8_t bit = (data[byteIdx] >> bitIdx) & 1;
         result |= ((uint64_t)bit << i);
       }
@@ -30,9 +30,9 @@ static uint64_t extractBits(const uint8_t data[8], uint16_t start, uint8_t len,
   } else {
     for (uint8_t i = 0; i < len; i++) {
       int bitPos = start - i;
-      if (bitPos < 0 || bitPos >= 64)
+      if (bitPos < 0 || bitPos >= (int)(dataLen * 8))
         continue;
-      uint8_t byteIdx = bitPos / 8;
+      size_t byteIdx = bitPos / 8;
       uint8_t bitIdx = bitPos % 8;
       uint8_t bit = (data[byteIdx] >> bitIdx) & 1;
       result = (result << 1) | bit;
@@ -42,10 +42,12 @@ static uint64_t extractBits(const uint8_t data[8], uint16_t start, uint8_t len,
   return result;
 }
 
-Engine::Engine() {}
-
-float Engine::decodeSignal(const RuntimeSignal &sig, const uint8_t *data) {
-  uint64_t raw = extractBits(data, sig.startBit, sig.bitLength, sig.bigEndian);
+// Shared by RuntimeSignal and StaticSignal (same decode fields)
+template <typename Signal>
+static float decodeFields(const Signal &sig, const uint8_t *data,
+                          size_t dataLen) {
+  uint64_t raw =
+      extractBits(data, dataLen, sig.startBit, sig.bitLength, sig.bigEndian);
   float val;
 
   if (sig.isSigned) {
@@ -62,24 +64,789 @@ float Engine::decodeSignal(const RuntimeSignal &sig, const uint8_t *data) {
   return val * sig.factor + sig.offset;
 }
 
+// Whole-byte field: a plain little-endian word read, no bit loop
+template <uint8_t Bits, bool Signed>
+static float decodeAligned(const RuntimeSignal &sig, const uint8_t *data,
+                           size_t dataLen) {
+  if ((size_t)sig.firstByte + Bits / 8 > dataLen)
+    return decodeFields(sig, data, dataLen); // Short diagnostic payload
+
+  const uint8_t *p = data + sig.firstByte;
+  uint32_t raw = p[0];
+  if (Bits >= 16)
+    raw |= (uint32_t)p[1] << 8;
+  if (Bits >= 32)
+    raw |= (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+
+  float val;
+  if (!Signed)
+    val = (float)raw;
+  else if (Bits == 8)
+    val = (float)(int8_t)raw;
+  else if (Bits == 16)
+    val = (float)(int16_t)raw;
+  else
+    val = (float)(int32_t)raw;
+
+  return val * sig.factor + sig.offset;
+}
+
+// Both orders read one contiguous run of bits (extractBits): Intel upwards
+// from startBit, Motorola downwards from it. A run of 8/16/32 bits on a
+// byte boundary is therefore the same little-endian word either way.
+static void classifyLayout(RuntimeSignal &sig) {
+  sig.layout = DecodeLayout::GENERIC;
+  uint8_t len = sig.bitLength;
+  if (len != 8 && len != 16 && len != 32)
+    return;
+
+  int lo = sig.bigEndian ? (int)sig.startBit - len + 1 : sig.startBit;
+  if (lo < 0 || lo % 8 != 0)
+    return;
+
+  sig.firstByte = lo / 8;
+  switch (len) {
+  case 8:
+    sig.layout = sig.isSigned ? DecodeLayout::S8 : DecodeLayout::U8;
+    break;
+  case 16:
+    sig.layout = sig.isSigned ? DecodeLayout::S16 : DecodeLayout::U16;
+    break;
+  default:
+    sig.layout = sig.isSigned ? DecodeLayout::S32 : DecodeLayout::U32;
+    break;
+  }
+}
+
+Engine::Engine() { registerBuiltinCapabilities(); }
+
+void Engine::registerBuiltinCapabilities() {
+  CapabilityMeta canTx;
+  canTx.id = "can_tx";
+  canTx.label = "Send CAN Frame";
+  canTx.description = "Transmit a CAN frame once or periodically";
+  canTx.category = "can";
+  canTx.coalesce = false; // Each call queues a distinct frame
+  canTx.params = {
+      {"id", "string", true, 0, 0, "CAN ID (hex or decimal)"},
+      {"data", "string", true, 0, 0, "Payload hex, up to 8 bytes"},
+      {"period", "int", false, 0, 30000, "Repeat period ms (0 = once)"},
+      {"priority", "int", false, 0, 255, "0 = most urgent"},
+      {"extended", "int", false, 0, 1, "1 = 29-bit ID (absent: ID > 0x7FF)"}};
+
+  registerCapability(
+      "can_tx", [this](const ParamMap &params) { handleCanTx(params); },
+      canTx);
+
+  CapabilityMeta canSignal;
+  canSignal.id = "can_signal";
+  canSignal.label = "Set CAN Signal";
+  canSignal.description = "Write a value into a periodic can_tx frame";
+  canSignal.category = "can";
+  canSignal.coalesce = false; // Rules may write different signals
+  canSignal.params = {
+      {"signal", "int", true, 0, 32767, "Ruleset signal giving ID and layout"},
+      {"value", "float", true, 0, 0, "Physical value"},
+      {"extended", "int", false, 0, 1, "1 = 29-bit ID (absent: ID > 0x7FF)"}};
+
+  registerCapability(
+      "can_signal",
+      [this](const ParamMap &params) { handleCanSignal(params); }, canSignal);
+}
+
+// Optional "extended" parameter; without it IDs above 0x7FF are 29-bit
+static bool txExtended(const ParamMap &params, const char *key,
+                       uint32_t id) {
+  auto it = params.find(key);
+  return it != params.end() ? it->second.toInt() != 0 : id > 0x7FF;
+}
+
+void Engine::enableNativeOutputs(uint64_t pinMask) {
+  nativePins_ = pinMask;
+
+  CapabilityMeta gpioSet;
+  gpioSet.id = "gpio_set";
+  gpioSet.label = "Set Output";
+  gpioSet.description = "Drive a GPIO pin low or high";
+  gpioSet.category = "outputs";
+  gpioSet.coalesce = false; // Rules may drive different pins
+  gpioSet.native = NativeKind::GPIO_SET;
+  gpioSet.params = {{"pin", "int", true, 0, 63, "GPIO number"},
+                    {"level", "int", true, 0, 1, "0 = low, 1 = high"}};
+
+  CapabilityMeta gpioPulse = gpioSet;
+  gpioPulse.id = "gpio_pulse";
+  gpioPulse.label = "Pulse Output";
+  gpioPulse.description = "Drive a GPIO pin, restore it after a delay";
+  gpioPulse.native = NativeKind::GPIO_PULSE;
+  gpioPulse.params.push_back(
+      {"width", "int", true, 1, NATIVE_PULSE_MAX_MS, "Pulse width ms"});
+
+  CapabilityMeta pwmDuty = gpioSet;
+  pwmDuty.id = "pwm_duty";
+  pwmDuty.label = "PWM Duty";
+  pwmDuty.description = "Set the PWM duty cycle of a GPIO pin";
+  pwmDuty.native = NativeKind::PWM_DUTY;
+  pwmDuty.params[1] = {"duty", "int", true, 0, 255, "0 = off, 255 = full"};
+
+  // No handler: a later registerCapability() with the same ID wins
+  for (const CapabilityMeta *meta : {&gpioSet, &gpioPulse, &pwmDuty}) {
+    handlers_.erase(meta->id);
+    typedHandlers_.erase(meta->id);
+    capabilityMeta_[meta->id] = *meta;
+  }
+}
+
+NativeKind Engine::nativeKindOf(const String &capabilityId) const {
+  if (handlers_.count(capabilityId))
+    return NativeKind::NONE;
+  auto it = capabilityMeta_.find(capabilityId);
+  return it == capabilityMeta_.end() ? NativeKind::NONE : it->second.native;
+}
+
+bool Engine::validateNative(const RuntimeAction &action,
+                            NativeKind kind) const {
+  size_t expected = (kind == NativeKind::GPIO_PULSE) ? 3 : 2;
+  bool valid = action.params.size() == expected;
+
+  // Constant integers only, so the call reads them without conversion
+  for (size_t i = 0; valid && i < action.params.size(); i++) {
+    valid = action.params[i].type == ParamType::INT ||
+            action.params[i].type == ParamType::BOOL;
+  }
+
+  if (valid) {
+    int32_t widthMs =
+        (kind == NativeKind::GPIO_PULSE) ? action.params[2].intVal : 0;
+    valid = nativeArgsValid(kind, action.params[0].intVal,
+                            action.params[1].intVal, widthMs);
+  }
+
+  if (!valid) {
+    Serial.printf("[W4RP] Invalid parameters for native '%s'\n",
+                  action.capabilityId.c_str());
+  }
+  return valid;
+}
+
+bool Engine::nativeArgsValid(NativeKind kind, int32_t pin, int32_t arg,
+                             int32_t widthMs) const {
+  if (pin < 0 || pin >= 64 || !((nativePins_ >> pin) & 1))
+    return false;
+
+  switch (kind) {
+  case NativeKind::GPIO_SET:
+    return arg == 0 || arg == 1;
+  case NativeKind::GPIO_PULSE:
+    return (arg == 0 || arg == 1) && widthMs > 0 &&
+           widthMs <= NATIVE_PULSE_MAX_MS;
+  case NativeKind::PWM_DUTY:
+    return arg >= 0 && arg <= 255;
+  default:
+    return false;
+  }
+}
+
+void Engine::runNative(const RuntimeAction &action, int16_t overrideParam,
+                       float overrideValue) {
+  int32_t arg = action.params[1].intVal;
+  if (overrideParam == 1)
+    arg = lroundf(overrideValue); // Ramp (the pin is never swept)
+
+  uint32_t widthMs =
+      (action.native == NativeKind::GPIO_PULSE) ? action.params[2].intVal : 0;
+  driveNative(action.native, action.params[0].intVal, arg, widthMs);
+}
+
+void Engine::driveNative(NativeKind kind, uint8_t pin, int32_t arg,
+                         uint32_t widthMs) {
+  switch (kind) {
+  case NativeKind::GPIO_SET:
+    digitalWrite(pin, arg ? HIGH : LOW);
+    break;
+  case NativeKind::GPIO_PULSE:
+    startPulse(pin, arg ? HIGH : LOW, widthMs);
+    break;
+  case NativeKind::PWM_DUTY:
+    analogWrite(pin, std::min<int32_t>(std::max<int32_t>(arg, 0), 255));
+    break;
+  case NativeKind::NONE:
+    break;
+  }
+}
+
+void Engine::startPulse(uint8_t pin, uint8_t level, uint32_t widthMs) {
+  // Re-triggering a pin extends its pulse
+  NativePulse *slot = nullptr;
+  for (NativePulse &pulse : pulses_) {
+    if (pulse.active && pulse.pin == pin) {
+      slot = &pulse;
+      break;
+    }
+    if (!pulse.active && !slot)
+      slot = &pulse;
+  }
+  if (!slot)
+    return; // All slots busy
+
+  if (!slot->active)
+    slot->restoreLevel = (level == HIGH) ? LOW : HIGH;
+  slot->active = true;
+  slot->pin = pin;
+  slot->endMs = millis() + widthMs;
+  digitalWrite(pin, level);
+}
+
+void Engine::serviceNativePulses(uint32_t nowMs) {
+  for (NativePulse &pulse : pulses_) {
+    if (pulse.active && (int32_t)(nowMs - pulse.endMs) >= 0) {
+      digitalWrite(pulse.pin, pulse.restoreLevel);
+      pulse.active = false;
+    }
+  }
+}
+
+bool Engine::attachStaticRuleset(const StaticRulesetView &view) {
+  if (!isValidStaticRuleset(view) || !view.signalState || !view.ruleState) {
+    Serial.println("[W4RP] Static ruleset: inconsistent tables");
+    return false;
+  }
+
+  for (size_t i = 0; i < view.actionCount; i++) {
+    const StaticAction &action = view.actions[i];
+    if (action.native == NativeKind::NONE)
+      continue;
+    if (!nativeArgsValid(action.native, action.pin, action.arg,
+                         action.widthMs)) {
+      Serial.printf("[W4RP] Static ruleset: invalid native action %d\n",
+                    (int)i);
+      return false;
+    }
+    if (action.native != NativeKind::PWM_DUTY)
+      pinMode(action.pin, OUTPUT);
+  }
+
+  for (size_t i = 0; i < view.signalCount; i++) {
+    view.signalState[i] = StaticSignalState();
+  }
+  for (size_t i = 0; i < view.ruleCount; i++) {
+    view.ruleState[i] = StaticRuleState();
+  }
+  staticRules_ = view;
+  return true;
+}
+
+void Engine::setCompiledRuleset(CompiledRuleset *compiled) {
+  compiled_ = compiled;
+  compiledActive_ = compiled_ && !signals_.empty() &&
+                    compiled_->sourceCRC() == rulesetCRC_;
+  syncOperands(); // Generated code stores straight into signals_
+  dirtyConditions_ = 0xFFFFFFFF; // Re-evaluate if the interpreter takes over
+}
+
+void Engine::updateStaticSignals(const CanFrame &frame) {
+  for (size_t i = 0; i < staticRules_.signalCount; i++) {
+    const StaticSignal &sig = staticRules_.signals[i];
+    if (sig.canId != frame.id)
+      continue;
+    StaticSignalState &state = staticRules_.signalState[i];
+    state.value = decodeFields(sig, frame.data, sizeof(frame.data));
+    state.everSet = true;
+  }
+}
+
+void Engine::evaluateStaticRules(uint32_t nowMs) {
+  const StaticRulesetView &rs = staticRules_;
+
+  uint32_t results = 0;
+  for (size_t c = 0; c < rs.conditionCount; c++) {
+    const StaticCondition &cond = rs.conditions[c];
+    const StaticSignalState &sig = rs.signalState[cond.signalIdx];
+    if (sig.everSet && evaluateStaticCondition(cond, sig.value))
+      results |= 1UL << c;
+  }
+
+  // Same debounce and cooldown semantics as WBP rules
+  for (size_t r = 0; r < rs.ruleCount; r++) {
+    const StaticRule &rule = rs.rules[r];
+    StaticRuleState &state = rs.ruleState[r];
+    bool allMet = (rule.conditionMask & results) == rule.conditionMask;
+
+    if (allMet != state.lastConditionState) {
+      state.lastConditionState = allMet;
+      state.lastConditionChangeMs = nowMs;
+    }
+    if (!allMet || (nowMs - state.lastConditionChangeMs) < rule.debounceMs ||
+        (nowMs - state.lastTriggerMs) < rule.cooldownMs)
+      continue;
+
+    for (size_t a = rule.actionStartIdx;
+         a < (size_t)(rule.actionStartIdx + rule.actionCount); a++) {
+      const StaticAction &action = rs.actions[a];
+      if (action.native != NativeKind::NONE) {
+        driveNative(action.native, action.pin, action.arg, action.widthMs);
+      } else {
+        action.callback(action.arg);
+      }
+    }
+
+    state.lastTriggerMs = nowMs;
+    rulesTriggered_++;
+  }
+}
+
+void Engine::handleCanTx(const ParamMap &params) {
+  auto idIt = params.find("p0");
+  auto dataIt = params.find("p1");
+  if (idIt == params.end() || dataIt == params.end())
+    return;
+
+  CanFrame frame = {};
+  frame.id = strtoul(idIt->second.c_str(), nullptr, 0);
+  frame.extended = txExtended(params, "p4", frame.id);
+
+  const String &hex = dataIt->second;
+  uint8_t n = 0;
+  for (size_t i = 0; i + 1 < hex.length() && n < sizeof(frame.data); i += 2) {
+    char byteStr[3] = {hex[i], hex[i + 1], 0};
+    frame.data[n++] = strtoul(byteStr, nullptr, 16);
+  }
+  frame.dlc = n;
+
+  auto periodIt = params.find("p2");
+  auto prioIt = params.find("p3");
+  uint32_t periodMs = (periodIt != params.end()) ? periodIt->second.toInt() : 0;
+  uint8_t priority = (prioIt != params.end()) ? prioIt->second.toInt() : 0;
+
+  // Queued only - the loop transmits via serviceTransmit()
+  if (periodMs > 0) {
+    txScheduler_.schedulePeriodic(frame, periodMs, priority, TX_OWNER_RULES);
+  } else {
+    txScheduler_.sendOnce(frame, priority, TX_OWNER_RULES);
+  }
+}
+
+void Engine::handleCanSignal(const ParamMap &params) {
+  auto sigIt = params.find("p0");
+  auto valueIt = params.find("p1");
+  if (sigIt == params.end() || valueIt == params.end())
+    return;
+
+  long idx = sigIt->second.toInt();
+  if (idx < 0 || (size_t)idx >= signals_.size())
+    return;
+  const RuntimeSignal &layout = signals_[idx];
+
+  // The frame must already be scheduled (can_tx with a period)
+  int slot = txScheduler_.findPeriodic(
+      layout.canId, txExtended(params, "p2", layout.canId));
+  txScheduler_.writeSignal(slot, layout, valueIt->second.toFloat());
+}
+
+float Engine::decodeSignal(const RuntimeSignal &sig, const uint8_t *data,
+                          size_t dataLen) {
+  switch (sig.layout) {
+  case DecodeLayout::U8:
+    return decodeAligned<8, false>(sig, data, dataLen);
+  case DecodeLayout::S8:
+    return decodeAligned<8, true>(sig, data, dataLen);
+  case DecodeLayout::U16:
+    return decodeAligned<16, false>(sig, data, dataLen);
+  case DecodeLayout::S16:
+    return decodeAligned<16, true>(sig, data, dataLen);
+  case DecodeLayout::U32:
+    return decodeAligned<32, false>(sig, data, dataLen);
+  case DecodeLayout::S32:
+    return decodeAligned<32, true>(sig, data, dataLen);
+  default:
+    return decodeFields(sig, data, dataLen);
+  }
+}
+
+void Engine::updateSignal(RuntimeSignal &sig, const uint8_t *data,
+                          size_t dataLen, uint32_t nowMs) {
+  setSignalValue(sig, decodeSignal(sig, data, dataLen), nowMs);
+}
+
+void Engine::setSignalValue(RuntimeSignal &sig, float value, uint32_t nowMs) {
+  sig.lastValue = sig.value;
+  sig.value = value;
+  sig.lastUpdateMs = nowMs;
+  sig.everSet = true;
+  dirtyConditions_ |= sig.dependentConditions;
+  if (sig.expiredWatches > 0)
+    reviveSignal(sig, nowMs);
+  size_t idx = &sig - signals_.data();
+  operands_[idx] = value;
+
+  for (int16_t w = sig.firstWindow; w >= 0; w = windows_[w].nextForSignal) {
+    windows_[w].add(nowMs, sig.value);
+  }
+
+  // Flag derived nodes reading this signal
+  if (!derived_.empty()) {
+    for (uint16_t e = derivedEdgeStart_[idx]; e < derivedEdgeStart_[idx + 1];
+         e++) {
+      derived_[derivedEdges_[e]].dirty = true;
+      derivedDirty_ = true;
+    }
+  }
+}
+
+static bool computeDerived(RuntimeDerived &node, const RuntimeSignal &a,
+                           const RuntimeSignal &b, float prevOut,
+                           uint32_t nowMs, float &out) {
+  switch (node.op) {
+  case DerivedOp::ADD:
+    out = a.value + b.value;
+    return true;
+  case DerivedOp::SUB:
+    out = a.value - b.value;
+    return true;
+  case DerivedOp::MUL:
+    out = a.value * b.value;
+    return true;
+  case DerivedOp::DIV:
+    if (fabsf(b.value) < 1e-9f)
+      return false;
+    out = a.value / b.value;
+    return true;
+  case DerivedOp::SCALE:
+    out = a.value * node.param;
+    return true;
+  default:
+    break;
+  }
+
+  // Stateful nodes: first sample primes the filter
+  bool primed = node.primed;
+  uint32_t dtMs = nowMs - node.prevMs;
+  float prevInput = node.prevInput;
+  node.primed = true;
+  node.prevMs = nowMs;
+  node.prevInput = a.value;
+
+  switch (node.op) {
+  case DerivedOp::EMA:
+    out = primed ? prevOut + node.param * (a.value - prevOut) : a.value;
+    return true;
+  case DerivedOp::LOWPASS:
+    out = primed ? prevOut + (a.value - prevOut) * dtMs / (node.param + dtMs)
+                 : a.value;
+    return true;
+  case DerivedOp::DERIVATIVE:
+    if (!primed || dtMs == 0)
+      return false;
+    out = (a.value - prevInput) * 1000.0f / dtMs;
+    return true;
+  default:
+    return false;
+  }
+}
+
+void Engine::updateDerived(uint32_t nowMs) {
+  if (!derivedDirty_)
+    return;
+
+  // Topological order: outputs flagged here are visited later in the pass
+  for (RuntimeDerived &node : derived_) {
+    if (!node.dirty)
+      continue;
+    node.dirty = false;
+
+    const RuntimeSignal &a = signals_[node.inputA];
+    const RuntimeSignal &b = signals_[node.inputB];
+    if (!a.everSet || !b.everSet)
+      continue;
+
+    RuntimeSignal &outSig = signals_[node.signalIdx];
+    float out;
+    if (computeDerived(node, a, b, outSig.value, nowMs, out)) {
+      setSignalValue(outSig, out, nowMs);
+    }
+  }
+
+  derivedDirty_ = false;
+}
+
+void Engine::updateSignalGroup(SignalGroup &group, const uint8_t *data,
+                               uint32_t nowMs) {
+  for (RuntimeSignal *sig : group.signals) {
+    updateSignal(*sig, data, sizeof(CanFrame::data), nowMs);
+  }
+
+  // Decode only the page selected by each multiplexor
+  for (MuxDispatch &md : group.muxes) {
+    // Scaled or signed multiplexors can decode outside the page range
+    float page = md.mux->value;
+    if (!(page >= 0.0f && page <= 65535.0f))
+      continue;
+    auto pit = md.pages.find(static_cast<uint32_t>(page));
+    if (pit == md.pages.end())
+      continue;
+    for (RuntimeSignal *sig : pit->second) {
+      updateSignal(*sig, data, sizeof(CanFrame::data), nowMs);
+    }
+  }
+}
+
+void Engine::buildSignalIndex() {
+  signalMap_.clear();
+  maskedSignalBuckets_.clear();
+
+  for (RuntimeSignal &sig : signals_) {
+    classifyLayout(sig);
+    if (sig.polled || sig.derived)
+      continue; // Fed by DiagPoller / derived signal DAG
+
+    SignalGroup *group = nullptr;
+
+    if (sig.canMask == CAN_ID_MASK_EXACT && !sig.extendedOnly) {
+      group = &signalMap_[sig.canId];
+    } else {
+      // Bucket by mask so a frame costs one lookup per distinct mask
+      MaskedSignalBucket *bucket = nullptr;
+      for (MaskedSignalBucket &b : maskedSignalBuckets_) {
+        if (b.mask == sig.canMask && b.extendedOnly == sig.extendedOnly) {
+          bucket = &b;
+          break;
+        }
+      }
+      if (!bucket) {
+        maskedSignalBuckets_.push_back({sig.canMask, sig.extendedOnly, {}});
+        bucket = &maskedSignalBuckets_.back();
+      }
+      group = &bucket->groups[sig.canId];
+    }
+
+    if (!sig.multiplexed) {
+      group->signals.push_back(&sig);
+      continue;
+    }
+
+    // Parser guarantees the multiplexor lives in the same group
+    RuntimeSignal *mux = &signals_[sig.muxSignalIdx];
+    MuxDispatch *md = nullptr;
+    for (MuxDispatch &m : group->muxes) {
+      if (m.mux == mux) {
+        md = &m;
+        break;
+      }
+    }
+    if (!md) {
+      group->muxes.push_back({mux, {}});
+      md = &group->muxes.back();
+    }
+    md->pages[sig.muxValue].push_back(&sig);
+  }
+}
+
+void Engine::buildDerivedEdges() {
+  derivedEdgeStart_.assign(signals_.size() + 1, 0);
+  derivedEdges_.clear();
+  derivedDirty_ = false;
+  if (derived_.empty())
+    return;
+
+  // Count edges per input signal, prefix-sum, then fill
+  for (const RuntimeDerived &node : derived_) {
+    derivedEdgeStart_[node.inputA + 1]++;
+    if (node.inputB != node.inputA)
+      derivedEdgeStart_[node.inputB + 1]++;
+  }
+  for (size_t i = 1; i < derivedEdgeStart_.size(); i++) {
+    derivedEdgeStart_[i] += derivedEdgeStart_[i - 1];
+  }
+
+  derivedEdges_.resize(derivedEdgeStart_.back());
+  std::vector<uint16_t> fill(derivedEdgeStart_.begin(),
+                             derivedEdgeStart_.end() - 1);
+  for (size_t n = 0; n < derived_.size(); n++) {
+    derivedEdges_[fill[derived_[n].inputA]++] = n;
+    if (derived_[n].inputB != derived_[n].inputA)
+      derivedEdges_[fill[derived_[n].inputB]++] = n;
+  }
+}
+
+void Engine::buildWindows() {
+  size_t count = 0;
+  for (const RuntimeCondition &cond : conditions_) {
+    if (isWindowOp(cond.operation))
+      count++;
+  }
+
+  windows_.assign(count, WindowAggregate());
+  windowArena_.assign(count * WINDOW_BUCKETS, WindowBucket());
+
+  size_t w = 0;
+  for (RuntimeCondition &cond : conditions_) {
+    if (!isWindowOp(cond.operation))
+      continue;
+    RuntimeSignal &sig = signals_[cond.signalIdx];
+    windows_[w].init(&windowArena_[w * WINDOW_BUCKETS], cond.windowMs);
+    windows_[w].nextForSignal = sig.firstWindow;
+    sig.firstWindow = w;
+    cond.windowIdx = w;
+    w++;
+  }
+}
+
+void Engine::buildConditionIndex() {
+  volatileConditions_ = 0;
+  for (size_t c = 0; c < conditions_.size() && c < 32; c++) {
+    const RuntimeCondition &cond = conditions_[c];
+    uint32_t bit = 1UL << c;
+    signals_[cond.signalIdx].dependentConditions |= bit;
+    if (cond.signalOperand)
+      signals_[cond.signalIdx2].dependentConditions |= bit;
+
+    // Result can change without a new sample: HOLD and windows age with
+    // time, edges are single-cycle pulses
+    Operation op = cond.operation;
+    if (op == Operation::HOLD || isWindowOp(op) || op == Operation::RISING ||
+        op == Operation::FALLING || op == Operation::CHANGED)
+      volatileConditions_ |= bit;
+  }
+
+  dirtyConditions_ = 0xFFFFFFFF;
+  conditionResults_ = 0;
+}
+
+void Engine::buildStaleWatches(uint32_t nowMs) {
+  staleWatches_.clear();
+  staleHeap_.clear();
+
+  auto addWatch = [this](uint16_t signalIdx, uint32_t timeoutMs,
+                         int16_t conditionIdx) {
+    RuntimeSignal &sig = signals_[signalIdx];
+    RuntimeStaleWatch watch;
+    watch.signalIdx = signalIdx;
+    watch.timeoutMs = timeoutMs;
+    watch.conditionIdx = conditionIdx;
+    watch.nextForSignal = sig.firstWatch;
+    sig.firstWatch = staleWatches_.size();
+    staleWatches_.push_back(watch);
+  };
+
+  for (size_t i = 0; i < signals_.size(); i++) {
+    if (signals_[i].timeoutMs > 0)
+      addWatch(i, signals_[i].timeoutMs, -1);
+  }
+  for (size_t c = 0; c < conditions_.size() && c < 32; c++) {
+    RuntimeCondition &cond = conditions_[c];
+    if (cond.operation != Operation::STALE)
+      continue;
+    cond.watchIdx = staleWatches_.size();
+    addWatch(cond.signalIdx, cond.holdMs, c);
+  }
+
+  // Signals never received go stale one timeout after load
+  for (size_t w = 0; w < staleWatches_.size(); w++) {
+    armStaleWatch(w, nowMs + staleWatches_[w].timeoutMs);
+  }
+}
+
+void Engine::armStaleWatch(uint16_t watchIdx, uint32_t deadlineMs) {
+  staleHeap_.push_back({deadlineMs, watchIdx});
+  std::push_heap(staleHeap_.begin(), staleHeap_.end());
+}
+
+void Engine::serviceStaleWatches(uint32_t nowMs) {
+  while (!staleHeap_.empty() &&
+         (int32_t)(nowMs - staleHeap_.front().deadlineMs) >= 0) {
+    std::pop_heap(staleHeap_.begin(), staleHeap_.end());
+    uint16_t w = staleHeap_.back().watchIdx;
+    staleHeap_.pop_back();
+
+    RuntimeStaleWatch &watch = staleWatches_[w];
+    RuntimeSignal &sig = signals_[watch.signalIdx];
+
+    // Updates don't move the deadline; re-arm from the latest one here
+    if (sig.everSet) {
+      uint32_t deadline = sig.lastUpdateMs + watch.timeoutMs;
+      if ((int32_t)(deadline - nowMs) > 0) {
+        armStaleWatch(w, deadline);
+        continue;
+      }
+    }
+
+    watch.expired = true;
+    sig.expiredWatches++;
+    if (watch.conditionIdx >= 0) {
+      dirtyConditions_ |= 1UL << watch.conditionIdx;
+    } else {
+      sig.timedOut = true;
+      operands_[watch.signalIdx] = NAN;
+      dirtyConditions_ |= sig.dependentConditions;
+    }
+  }
+}
+
+void Engine::reviveSignal(RuntimeSignal &sig, uint32_t nowMs) {
+  for (int16_t w = sig.firstWatch; w >= 0;
+       w = staleWatches_[w].nextForSignal) {
+    RuntimeStaleWatch &watch = staleWatches_[w];
+    if (!watch.expired)
+      continue;
+    watch.expired = false;
+    if (watch.conditionIdx >= 0)
+      dirtyConditions_ |= 1UL << watch.conditionIdx;
+    armStaleWatch(w, nowMs + watch.timeoutMs);
+  }
+  sig.expiredWatches = 0;
+  sig.timedOut = false;
+}
+
+void Engine::syncOperands() {
+  operands_.resize(signals_.size());
+  for (size_t i = 0; i < signals_.size(); i++) {
+    const RuntimeSignal &sig = signals_[i];
+    operands_[i] = sig.everSet && !sig.timedOut ? sig.value : NAN;
+  }
+}
+
+std::vector<uint16_t> Engine::getStaleSignals() const {
+  std::vector<uint16_t> stale;
+  for (size_t i = 0; i < signals_.size(); i++) {
+    if (signals_[i].expiredWatches > 0)
+      stale.push_back(i);
+  }
+  return stale;
+}
+
 bool Engine::loadRuleset(const uint8_t *data, size_t len) {
   std::vector<RuntimeSignal> newSignals;
   std::vector<RuntimeCondition> newConditions;
   std::vector<RuntimeAction> newActions;
   std::vector<RuntimeRule> newRules;
+  RuntimeExtensions newExt;
 
   if (!Protocol::parseRules(data, len, newSignals, newConditions, newActions,
-                            newRules)) {
+                            newRules, newExt)) {
     return false;
   }
 
   // Validate capabilities BEFORE committing (preserve existing rules on
   // failure)
   for (const RuntimeAction &action : newActions) {
+    NativeKind native = nativeKindOf(action.capabilityId);
+    if (native != NativeKind::NONE) {
+      if (!validateNative(action, native))
+        return false;
+      continue;
+    }
     if (handlers_.find(action.capabilityId) == handlers_.end()) {
       unknownCapability_ = action.capabilityId;
       return false;
     }
+
+    auto typed = typedHandlers_.find(action.capabilityId);
+    if (typed != typedHandlers_.end() &&
+        !typed->second.matches(action.params)) {
+      Serial.printf("[W4RP] Parameters of '%s' don't match its handler\n",
+                    action.capabilityId.c_str());
+      return false;
+    }
   }
   unknownCapability_ = ""; // Clear on success
 
@@ -89,54 +856,140 @@ bool Engine::loadRuleset(const uint8_t *data, size_t len) {
   actions_ = std::move(newActions);
   rules_ = std::move(newRules);
 
-  // Build signal lookup map
-  signalMap_.clear();
-  for (RuntimeSignal &sig : signals_) {
-    signalMap_[sig.canId].push_back(&sig);
+  // Build signal lookup (exact map + masked buckets)
+  buildSignalIndex();
+  buildActionSlots();
+  buildWindows();
+  buildConditionIndex();
+  buildStaleWatches(millis());
+  syncOperands();
+  derived_ = std::move(newExt.derived);
+  machines_ = std::move(newExt.machines);
+  machineStates_ = std::move(newExt.machineStates);
+  transitions_ = std::move(newExt.transitions);
+  scheduler_.load(std::move(newExt.actionSteps), actions_.size());
+  for (RuntimeStateMachine &machine : machines_) {
+    machine.enteredMs = millis();
   }
+  buildDerivedEdges();
+  diagPoller_.load(std::move(newExt.diagPolls));
+  logTracks_ = std::move(newExt.logTracks);
+  txScheduler_.clearOwner(TX_OWNER_RULES); // Frames of the old rules
 
   // Store binary for persistence
   rulesetBinary_.assign(data, data + len);
   rulesetCRC_ = Protocol::calculateCRC32(data, len);
+  compiledActive_ = compiled_ && compiled_->sourceCRC() == rulesetCRC_;
+  if (compiledActive_)
+    Serial.println("[W4RP] Ruleset runs compiled");
 
   return true;
 }
 
 void Engine::clearRuleset() {
   signals_.clear();
+  operands_.clear();
   conditions_.clear();
   actions_.clear();
   rules_.clear();
   signalMap_.clear();
+  maskedSignalBuckets_.clear();
+  windows_.clear();
+  windowArena_.clear();
+  derived_.clear();
+  derivedEdgeStart_.clear();
+  derivedEdges_.clear();
+  derivedDirty_ = false;
+  dirtyConditions_ = 0;
+  volatileConditions_ = 0;
+  conditionResults_ = 0;
+  staleWatches_.clear();
+  staleHeap_.clear();
+  machines_.clear();
+  machineStates_.clear();
+  transitions_.clear();
+  actionQueue_.clear();
+  slotEntry_.clear();
+  capSlots_.clear();
+  scheduler_.clear();
+  diagPoller_.clear();
+  txScheduler_.clearOwner(TX_OWNER_RULES);
+  logTracks_.clear();
   rulesetBinary_.clear();
   rulesetCRC_ = 0;
+  compiledActive_ = false;
   rulesTriggered_ = 0;
+  skippedInvocations_ = 0;
 }
 
 void Engine::registerCapability(const String &id, CapabilityHandler handler) {
   handlers_[id] = handler;
+  typedHandlers_.erase(id);
+
+  // A handler replacing a built-in output must not keep its pin schema
+  auto it = capabilityMeta_.find(id);
+  if (it != capabilityMeta_.end() && it->second.native != NativeKind::NONE)
+    capabilityMeta_.erase(it);
 }
 
 void Engine::registerCapability(const String &id, CapabilityHandler handler,
                                 const CapabilityMeta &meta) {
   handlers_[id] = handler;
+  typedHandlers_.erase(id);
   capabilityMeta_[id] = meta;
+
+  CapabilityMeta &stored = capabilityMeta_[id];
+  stored.asyncSlot = -1;
+  if (meta.async) {
+    stored.asyncSlot = worker_.addHandler(id, meta.budgetMs);
+    if (stored.asyncSlot < 0) {
+      Serial.printf("[W4RP] Capability '%s' runs inline (no async slot)\n",
+                    id.c_str());
+    }
+  }
 }
 
 void Engine::processCanFrame(const CanFrame &frame) {
   uint32_t now = millis();
 
-  // Update ruleset signals
-  auto it = signalMap_.find(frame.id);
-  if (it != signalMap_.end()) {
-    for (RuntimeSignal *sig : it->second) {
-      sig->lastValue = sig->value;
-      sig->value = decodeSignal(*sig, frame.data);
-      sig->lastUpdateMs = now;
-      sig->everSet = true;
+  // Diagnostic responses feed polled signals
+  if (diagPoller_.isActive() && diagPoller_.processFrame(frame, now)) {
+    const RuntimeDiagPoll &poll = diagPoller_.completedPoll();
+    for (size_t i = poll.signalStartIdx;
+         i < (size_t)(poll.signalStartIdx + poll.signalCount); i++) {
+      updateSignal(signals_[i], diagPoller_.responseData(),
+                   diagPoller_.responseLength(), now);
+    }
+  }
+
+  // Generated code decodes and updates condition results in one pass
+  if (compiledActive_) {
+    compiled_->processFrame(frame.id, frame.data, signals_.data(),
+                            conditionResults_, now);
+  } else {
+    // Update ruleset signals
+    auto it = signalMap_.find(frame.id);
+    if (it != signalMap_.end()) {
+      updateSignalGroup(it->second, frame.data, now);
+    }
+
+    // Masked signals (J1939 PGN, ID ranges)
+    for (MaskedSignalBucket &bucket : maskedSignalBuckets_) {
+      if (bucket.extendedOnly && !frame.extended)
+        continue;
+      auto mit = bucket.groups.find(frame.id & bucket.mask);
+      if (mit != bucket.groups.end()) {
+        updateSignalGroup(mit->second, frame.data, now);
+      }
     }
   }
 
+  // Recompute derived signals whose inputs changed
+  updateDerived(now);
+
+  if (staticRules_.signals)
+    updateStaticSignals(frame);
+
   // Update debug signals
   if (debugMode_) {
     auto dit = debugSignalMap_.find(frame.id);
@@ -144,7 +997,7 @@ void Engine::processCanFrame(const CanFrame &frame) {
       for (size_t idx : dit->second) {
         RuntimeSignal &sig = debugSignals_[idx];
         sig.lastValue = sig.value;
-        sig.value = decodeSignal(sig, frame.data);
+        sig.value = decodeSignal(sig, frame.data, sizeof(frame.data));
         sig.lastUpdateMs = now;
         sig.everSet = true;
 
@@ -160,17 +1013,35 @@ void Engine::processCanFrame(const CanFrame &frame) {
   }
 }
 
+void Engine::serviceDiagnostics(CAN &bus) {
+  diagPoller_.service(bus, millis());
+}
+
+void Engine::serviceTransmit(CAN &bus) { txScheduler_.service(bus, millis()); }
+
 bool Engine::evaluateCondition(RuntimeCondition &cond, uint32_t nowMs) {
-  if (cond.signalIdx >= signals_.size())
+  if (cond.signalIdx >= operands_.size())
     return false;
 
-  RuntimeSignal &sig = signals_[cond.signalIdx];
-  if (!sig.everSet)
+  // Driven by serviceStaleWatches(), valid before the first sample
+  if (cond.operation == Operation::STALE)
+    return staleWatches_[cond.watchIdx].expired;
+
+  float val = operands_[cond.signalIdx];
+  if (std::isnan(val)) // Never set or timed out
     return false;
 
-  float val = sig.value;
+  float ref = cond.value1;
   constexpr float EPSILON = 0.0001f;
 
+  // Right-hand side is another signal (plus value1 as offset)
+  if (cond.signalOperand) {
+    float rhs = operands_[cond.signalIdx2];
+    if (std::isnan(rhs))
+      return false;
+    ref = rhs + cond.value1;
+  }
+
   // Handle HOLD operation
   if (cond.operation == Operation::HOLD) {
     bool active = (fabsf(val) > EPSILON); // Fixed: use epsilon
@@ -187,20 +1058,65 @@ bool Engine::evaluateCondition(RuntimeCondition &cond, uint32_t nowMs) {
     }
   }
 
-  // Standard operations
+  // Edge/hysteresis operators compare against the previous evaluation
   switch (cond.operation) {
+  case Operation::HYSTERESIS:
+    // value1 > value2: on at >= value1, off at <= value2 (and mirrored)
+    if (cond.value1 > cond.value2) {
+      if (!cond.latched && val >= cond.value1)
+        cond.latched = true;
+      else if (cond.latched && val <= cond.value2)
+        cond.latched = false;
+    } else {
+      if (!cond.latched && val <= cond.value1)
+        cond.latched = true;
+      else if (cond.latched && val >= cond.value2)
+        cond.latched = false;
+    }
+    return cond.latched;
+  case Operation::RISING:
+  case Operation::FALLING:
+  case Operation::CHANGED: {
+    bool hadPrev = cond.hasPrev;
+    float prev = cond.prevValue;
+    cond.prevValue = val;
+    cond.hasPrev = true;
+    if (!hadPrev)
+      return false;
+    if (cond.operation == Operation::RISING)
+      return prev <= cond.value1 && val > cond.value1;
+    if (cond.operation == Operation::FALLING)
+      return prev >= cond.value1 && val < cond.value1;
+    return fabsf(val - prev) > (cond.value1 > EPSILON ? cond.value1 : EPSILON);
+  }
+  default:
+    break;
+  }
+
+  // Window aggregates compare the aggregate instead of the raw value
+  Operation op = cond.operation;
+  if (isWindowOp(op)) {
+    WindowAggregate &window = windows_[cond.windowIdx];
+    window.advance(nowMs);
+    if (!window.get(op, val))
+      return false;
+    op = cond.compare;
+  }
+
+  // Standard operations
+  switch (op) {
   case Operation::EQ:
-    return (fabsf(val - cond.value1) < EPSILON); // Fixed: use epsilon
+    return (fabsf(val - ref) < EPSILON); // Fixed: use epsilon
   case Operation::NE:
-    return (fabsf(val - cond.value1) >= EPSILON); // Fixed: use epsilon
+    return (fabsf(val - ref) >= EPSILON); // Fixed: use epsilon
   case Operation::GT:
-    return (val > cond.value1);
+    return (val > ref);
   case Operation::GE:
-    return (val >= cond.value1);
+    return (val >= ref);
   case Operation::LT:
-    return (val < cond.value1);
+    return (val < ref);
   case Operation::LE:
-    return (val <= cond.value1);
+    return (val <= ref);
   case Operation::WITHIN:
     return (val >= cond.value1 && val <= cond.value2);
   case Operation::OUTSIDE:
@@ -210,10 +1126,34 @@ bool Engine::evaluateCondition(RuntimeCondition &cond, uint32_t nowMs) {
   }
 }
 
-void Engine::executeAction(RuntimeAction &action) {
+bool Engine::executeAction(RuntimeAction &action, int16_t overrideParam,
+                           float overrideValue) {
+  if (action.native != NativeKind::NONE) {
+    runNative(action, overrideParam, overrideValue);
+    return true;
+  }
+
+  // Typed handler: arguments come straight from the RuntimeParams
+  const TypedCapabilityHandler &typed = capSlots_[action.capSlot].typed;
+  if (typed) {
+    if (overrideParam < 0) {
+      typed(action.params);
+      return true;
+    }
+    std::vector<RuntimeParam> swept = action.params; // Ramp step
+    RuntimeParam &p = swept[overrideParam];
+    if (p.type == ParamType::FLOAT) {
+      p.floatVal = overrideValue;
+    } else {
+      p.intVal = lroundf(overrideValue);
+    }
+    typed(swept);
+    return true;
+  }
+
   auto it = handlers_.find(action.capabilityId);
   if (it == handlers_.end())
-    return;
+    return false;
 
   // Convert params to map
   ParamMap params;
@@ -222,7 +1162,16 @@ void Engine::executeAction(RuntimeAction &action) {
     char key[16];
     snprintf(key, sizeof(key), "p%d", (int)i);
 
-    if (p.type == ParamType::STRING) {
+    if ((int)i == overrideParam) {
+      // Ramp value, formatted like the parameter it replaces
+      char buf[16];
+      if (p.type == ParamType::FLOAT) {
+        snprintf(buf, sizeof(buf), "%.4f", overrideValue);
+      } else {
+        snprintf(buf, sizeof(buf), "%ld", lroundf(overrideValue));
+      }
+      params[String(key)] = String(buf);
+    } else if (p.type == ParamType::STRING) {
       params[String(key)] = p.strVal;
     } else if (p.type == ParamType::FLOAT) {
       char buf[16];
@@ -233,24 +1182,50 @@ void Engine::executeAction(RuntimeAction &action) {
     }
   }
 
+  // Async capabilities run on the worker task
+  int8_t asyncSlot = capSlots_[action.capSlot].asyncSlot;
+  if (asyncSlot >= 0)
+    return worker_.submit(asyncSlot, it->second, std::move(params));
+
   it->second(params);
+  return true;
 }
 
 void Engine::evaluateRules() {
   uint32_t nowMs = millis();
 
-  for (RuntimeRule &rule : rules_) {
-    // Evaluate all conditions in mask (AND logic)
-    bool allMet = true;
+  // Each condition is evaluated at most once per cycle, so stateful
+  // operators (HOLD, edges, hysteresis) see every cycle regardless of how
+  // many rules share them or whether another condition short-circuits.
+  // Value-only conditions are skipped until one of their signals changes.
+  serviceStaleWatches(nowMs);
+  runDueSteps(nowMs);
+  serviceNativePulses(nowMs);
 
-    for (size_t c = 0; c < conditions_.size() && c < 32; c++) {
-      if (rule.conditionMask & (1 << c)) {
-        if (!evaluateCondition(conditions_[c], nowMs)) {
-          allMet = false;
-          break;
-        }
-      }
-    }
+  // Compiled rulesets keep conditionResults_ current in processCanFrame()
+  uint32_t previous = conditionResults_;
+  uint32_t pending =
+      compiledActive_ ? 0 : (dirtyConditions_ | volatileConditions_);
+  dirtyConditions_ = 0;
+  for (size_t c = 0; c < conditions_.size() && c < 32; c++) {
+    uint32_t bit = 1UL << c;
+    if (!(pending & bit))
+      continue;
+    RuntimeCondition &cond = conditions_[c];
+    cond.lastResult = evaluateCondition(cond, nowMs);
+    if (cond.lastResult)
+      conditionResults_ |= bit;
+    else
+      conditionResults_ &= ~bit;
+  }
+  uint32_t results = conditionResults_;
+
+  if (!machines_.empty())
+    advanceStateMachines(results, results ^ previous, nowMs);
+
+  for (RuntimeRule &rule : rules_) {
+    // All conditions in mask must hold (AND logic)
+    bool allMet = (rule.conditionMask & results) == rule.conditionMask;
 
     // Track state change for debounce
     if (allMet != rule.lastConditionState) {
@@ -268,16 +1243,179 @@ void Engine::evaluateRules() {
     if (!debounced || !cooldownOk)
       continue;
 
-    // Execute actions
+    // Queue actions; handlers run once evaluation is complete
     for (size_t a = rule.actionStartIdx;
          a < rule.actionStartIdx + rule.actionCount && a < actions_.size();
          a++) {
-      executeAction(actions_[a]);
+      queueAction(a, rule.priority);
     }
 
     rule.lastTriggerMs = nowMs;
     rulesTriggered_++;
   }
+
+  dispatchActions(nowMs);
+  if (staticRules_.rules)
+    evaluateStaticRules(nowMs);
+  worker_.checkWatchdog(millis());
+}
+
+void Engine::queueAction(uint16_t actionIdx, uint8_t priority) {
+  uint8_t slot = actions_[actionIdx].capSlot;
+  if (capSlots_[slot].coalesce) {
+    int16_t &entry = slotEntry_[slot];
+    if (entry >= 0) {
+      // Ties go to the later rule, as when handlers were called inline
+      if (priority >= actionQueue_[entry].priority)
+        actionQueue_[entry] = {actionIdx, priority};
+      return;
+    }
+    entry = actionQueue_.size();
+  }
+  actionQueue_.push_back({actionIdx, priority});
+}
+
+bool Engine::claimOutput(const RuntimeAction &action) {
+  const CapabilitySlot &out = capSlots_[action.capSlot];
+  if (!out.stateful)
+    return true;
+
+  // Output already holds this state
+  if (out.sent && out.paramHash == action.paramHash) {
+    skippedInvocations_++;
+    return false;
+  }
+  return true;
+}
+
+void Engine::recordOutput(const RuntimeAction &action, bool delivered) {
+  CapabilitySlot &out = capSlots_[action.capSlot];
+  if (!out.stateful)
+    return;
+  // A dropped call (no handler, worker full) leaves the state unknown
+  out.sent = delivered;
+  out.paramHash = action.paramHash;
+}
+
+void Engine::dispatchActions(uint32_t nowMs) {
+  for (const QueuedAction &q : actionQueue_) {
+    slotEntry_[actions_[q.actionIdx].capSlot] = -1;
+  }
+  for (const QueuedAction &q : actionQueue_) {
+    RuntimeAction &action = actions_[q.actionIdx];
+    if (!claimOutput(action))
+      continue;
+    recordOutput(action, executeAction(action));
+    if (scheduler_.hasSteps(q.actionIdx))
+      scheduler_.start(q.actionIdx, nowMs);
+  }
+  actionQueue_.clear();
+}
+
+void Engine::runDueSteps(uint32_t nowMs) {
+  ActionScheduler::DueStep due;
+  while (scheduler_.popDue(nowMs, due)) {
+    RuntimeAction &action = actions_[due.actionIdx];
+    if (due.paramIdx >= 0) {
+      // Ramp values vary; the next plain call must not be deduplicated
+      capSlots_[action.capSlot].sent = false;
+      executeAction(action, due.paramIdx, due.value);
+    } else if (claimOutput(action)) {
+      recordOutput(action, executeAction(action));
+    }
+  }
+}
+
+// FNV-1a over the typed values, so INT 1 and FLOAT 1.0 differ
+static uint32_t hashParams(const std::vector<RuntimeParam> &params) {
+  uint32_t hash = 2166136261u;
+  auto mix = [&hash](const void *data, size_t len) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < len; i++) {
+      hash = (hash ^ bytes[i]) * 16777619u;
+    }
+  };
+
+  for (const RuntimeParam &p : params) {
+    mix(&p.type, sizeof(p.type));
+    if (p.type == ParamType::STRING) {
+      mix(p.strVal.c_str(), p.strVal.length() + 1);
+    } else {
+      mix(&p.intVal, sizeof(p.intVal)); // Shares storage with floatVal
+    }
+  }
+  return hash;
+}
+
+void Engine::buildActionSlots() {
+  std::map<String, uint8_t> slots;
+  capSlots_.clear();
+
+  for (RuntimeAction &action : actions_) {
+    auto it = slots.find(action.capabilityId);
+    if (it == slots.end()) {
+      it = slots.emplace(action.capabilityId, capSlots_.size()).first;
+      CapabilitySlot slot;
+      auto meta = capabilityMeta_.find(action.capabilityId);
+      if (meta != capabilityMeta_.end()) {
+        slot.coalesce = meta->second.coalesce;
+        slot.stateful = meta->second.statefulOutput;
+        slot.asyncSlot = meta->second.asyncSlot;
+      }
+      auto typed = typedHandlers_.find(action.capabilityId);
+      if (typed != typedHandlers_.end() && slot.asyncSlot < 0)
+        slot.typed = typed->second.invoke;
+      capSlots_.push_back(slot);
+    }
+    action.capSlot = it->second;
+    action.paramHash = hashParams(action.params);
+
+    action.native = nativeKindOf(action.capabilityId);
+    if (action.native == NativeKind::GPIO_SET ||
+        action.native == NativeKind::GPIO_PULSE) {
+      pinMode(action.params[0].intVal, OUTPUT);
+    }
+  }
+
+  slotEntry_.assign(capSlots_.size(), -1);
+  actionQueue_.clear();
+  actionQueue_.reserve(actions_.size());
+}
+
+void Engine::advanceStateMachines(uint32_t results, uint32_t changed,
+                                  uint32_t nowMs) {
+  for (RuntimeStateMachine &machine : machines_) {
+    const RuntimeMachineState &state =
+        machineStates_[machine.firstState + machine.state];
+    uint32_t inStateMs = nowMs - machine.enteredMs;
+    bool timerDue = state.minTimeoutMs > 0 && inStateMs >= state.minTimeoutMs;
+
+    // Nothing this state waits on changed since the last check
+    if (!machine.pending && !(changed & state.conditionMask) && !timerDue)
+      continue;
+    machine.pending = false;
+
+    // At most one transition per machine per cycle
+    for (uint16_t t = state.firstTransition;
+         t < state.firstTransition + state.transitionCount; t++) {
+      const RuntimeTransition &tr = transitions_[t];
+      if ((tr.conditionMask & results) != tr.conditionMask ||
+          inStateMs < tr.timeoutMs)
+        continue;
+
+      for (size_t a = tr.actionStartIdx;
+           a < tr.actionStartIdx + tr.actionCount && a < actions_.size();
+           a++) {
+        queueAction(a, 0);
+      }
+
+      machine.state = tr.toState;
+      machine.enteredMs = nowMs;
+      machine.pending = true;
+      machine.transitions++;
+      break;
+    }
+  }
 }
 
 size_t Engine::loadDebugSignals(const String &definitions) {
@@ -311,6 +1449,7 @@ size_t Engine::loadDebugSignals(const String &definitions) {
         sig.offset = def.substring(p5 + 1).toFloat();
         sig.isSigned = false;
         sig.lastDebugValue = -999999.9f;
+        classifyLayout(sig);
 
         size_t idx = newSignals.size();
         newSignals.push_back(sig);
@@ -8,12 +8,23 @@
  */
 #pragma once
 #include "../interfaces/CAN.h"
+#include "ActionScheduler.h"
+#include "CapabilityWorker.h"
+#include "CompiledRuleset.h"
+#include "DiagPoller.h"
+#include "StaticRuleset.h"
+#include "TxScheduler.h"
+#include "TypedCapability.h"
 #include "Types.h"
+#include "WindowAggregate.h"
 #include <map>
 #include <vector>
 
 namespace W4RP {
 
+#define NATIVE_PULSE_SLOTS 8       // gpio_pulse outputs active at once
+#define NATIVE_PULSE_MAX_MS 60000
+
 /**
  * @class Engine
  * @brief Rule evaluation engine
@@ -64,11 +75,79 @@ public:
   void registerCapability(const String &id, CapabilityHandler handler,
                           const CapabilityMeta &meta);
 
+  /**
+   * @brief Register capability with a typed handler
+   * @code
+   * engine.registerCapability<int, float>(
+   *     "fan", [](int channel, float duty) { setFan(channel, duty); });
+   * @endcode
+   * Parameter types of meta are generated from Arg, Args (int, float,
+   * bool, String). Rulesets whose parameters don't match are rejected at
+   * load; calls then unpack RuntimeParams without a ParamMap.
+   * @param id Capability ID
+   * @param handler Callable taking (Arg, Args...)
+   * @param meta Capability metadata (names, ranges, dispatch flags)
+   */
+  template <typename Arg, typename... Args, typename F>
+  void registerCapability(const String &id, F handler,
+                          CapabilityMeta meta = CapabilityMeta()) {
+    if (meta.id.isEmpty())
+      meta.id = id;
+    describeTypedParams<Arg, Args...>(meta);
+
+    // The parsing wrapper serves the async worker
+    registerCapability(id, makeParsedCapability<Arg, Args...>(handler), meta);
+    typedHandlers_[id] = makeTypedCapability<Arg, Args...>(handler);
+  }
+
+  /**
+   * @brief Register built-in gpio_set, gpio_pulse and pwm_duty outputs
+   * Their actions run through a switch resolved at ruleset load, without
+   * a handler, ParamMap or heap allocation. A capability registered later
+   * with the same ID replaces the built-in.
+   * @param pinMask Bit n set = rules may drive GPIO n
+   */
+  void enableNativeOutputs(uint64_t pinMask);
+
+  /**
+   * @brief Run a ruleset compiled into firmware next to the WBP ruleset
+   * @param view Tables and state (see StaticRuleset.h), kept by pointer
+   * @return false if tables are inconsistent or use disabled native pins
+   */
+  bool attachStaticRuleset(const StaticRulesetView &view);
+
+  template <size_t S, size_t C, size_t A, size_t R>
+  bool attachStaticRuleset(StaticRuleset<S, C, A, R> &ruleset) {
+    return attachStaticRuleset(ruleset.view());
+  }
+
+  /// @brief Stop running the static ruleset
+  void detachStaticRuleset() { staticRules_ = StaticRulesetView(); }
+
+  /**
+   * @brief Use generated code (tools/wbp2cpp.py) for one WBP ruleset
+   * Takes over decoding and conditions while the loaded ruleset's CRC
+   * matches sourceCRC(); any other ruleset runs interpreted.
+   * @param compiled Backend (nullptr = always interpret), kept by pointer
+   */
+  void setCompiledRuleset(CompiledRuleset *compiled);
+
+  /// @brief Check if the loaded ruleset runs through the compiled backend
+  bool isCompiledActive() const { return compiledActive_; }
+
   /// @brief Get registered capabilities
   const std::map<String, CapabilityMeta> &getCapabilities() const {
     return capabilityMeta_;
   }
 
+  /// @brief Sequence counters (started, completed, cancelled)
+  const ActionSequenceStats &getSequenceStats() const {
+    return scheduler_.getStats();
+  }
+
+  /// @brief Worker running async capabilities (stats, watchdog)
+  CapabilityWorker &getCapabilityWorker() { return worker_; }
+
   /**
    * @brief Process received CAN frame
    * @param frame CAN frame from bus
@@ -78,6 +157,24 @@ public:
   /// @brief Evaluate rules and execute triggered actions
   void evaluateRules();
 
+  /**
+   * @brief Send due diagnostic requests and ISO-TP flow control
+   * @param bus CAN bus to transmit on (must not be listen-only)
+   */
+  void serviceDiagnostics(CAN &bus);
+
+  /// @brief Get diagnostic poller (rate limits, stats)
+  DiagPoller &getDiagPoller() { return diagPoller_; }
+
+  /**
+   * @brief Transmit due frames from the TX scheduler (non-blocking)
+   * @param bus CAN bus to transmit on (must not be listen-only)
+   */
+  void serviceTransmit(CAN &bus);
+
+  /// @brief Get CAN transmit scheduler (fed by can_tx and can_signal)
+  TxScheduler &getTxScheduler() { return txScheduler_; }
+
   /**
    * @brief Load debug signal definitions
    * @param definitions Comma-separated signal specs
@@ -101,22 +198,145 @@ public:
   /// @brief Set debug mode
   void setDebugMode(bool enabled) { debugMode_ = enabled; }
 
+  /// @brief Decoded signals of the loaded ruleset
+  const std::vector<RuntimeSignal> &getSignals() const { return signals_; }
+
+  /// @brief Signals selected for on-device history
+  const std::vector<RuntimeLogTrack> &getLogTracks() const {
+    return logTracks_;
+  }
+
+  /**
+   * @brief Signals with an expired timeout or STALE watch
+   * @return Signal indices (updated by evaluateRules)
+   */
+  std::vector<uint16_t> getStaleSignals() const;
+
+  /// @brief Sequence rules with their current state
+  const std::vector<RuntimeStateMachine> &getStateMachines() const {
+    return machines_;
+  }
+
   size_t getSignalCount() const { return signals_.size(); }
   size_t getConditionCount() const { return conditions_.size(); }
   size_t getActionCount() const { return actions_.size(); }
   size_t getRuleCount() const { return rules_.size(); }
   uint32_t getRulesTriggered() const { return rulesTriggered_; }
 
+  /// @brief Stateful-output calls skipped because parameters were unchanged
+  uint32_t getSkippedInvocations() const { return skippedInvocations_; }
+
 private:
   std::vector<RuntimeSignal> signals_;
   std::vector<RuntimeCondition> conditions_;
+
+  // Condition operands, one float per signal: the value, or NaN while the
+  // signal has no valid sample (never set or timed out). Both operands of
+  // a comparison are read from here rather than from two RuntimeSignals.
+  std::vector<float> operands_;
   std::vector<RuntimeAction> actions_;
   std::vector<RuntimeRule> rules_;
+  std::vector<RuntimeLogTrack> logTracks_;
   std::vector<uint8_t> rulesetBinary_;
   uint32_t rulesetCRC_ = 0;
 
-  std::map<uint32_t, std::vector<RuntimeSignal *>> signalMap_;
+  /// @brief Multiplexor signal and its pages, keyed by mux value
+  struct MuxDispatch {
+    RuntimeSignal *mux;
+    std::map<uint32_t, std::vector<RuntimeSignal *>> pages;
+  };
+
+  /// @brief All signals decoded from one CAN ID
+  struct SignalGroup {
+    std::vector<RuntimeSignal *> signals; // Always decoded (incl. muxes)
+    std::vector<MuxDispatch> muxes;
+  };
+
+  /// @brief Signals sharing one CAN ID mask, keyed by masked ID
+  struct MaskedSignalBucket {
+    uint32_t mask;
+    bool extendedOnly;
+    std::map<uint32_t, SignalGroup> groups;
+  };
+
+  std::map<uint32_t, SignalGroup> signalMap_;
+  std::vector<MaskedSignalBucket> maskedSignalBuckets_;
+  DiagPoller diagPoller_;
+  TxScheduler txScheduler_;
+
+  // Window aggregates; buckets come from one arena sized per ruleset
+  std::vector<WindowAggregate> windows_;
+  std::vector<WindowBucket> windowArena_;
+
+  // Derived signal DAG (topological order) and signal -> node edges (CSR)
+  std::vector<RuntimeDerived> derived_;
+  std::vector<uint16_t> derivedEdgeStart_;
+  std::vector<uint16_t> derivedEdges_;
+  bool derivedDirty_ = false;
+
+  // Condition bitmaps: only dirty (input changed) and volatile (time or
+  // cycle dependent) conditions are re-evaluated; the rest keep their result
+  uint32_t dirtyConditions_ = 0;
+  uint32_t volatileConditions_ = 0;
+  uint32_t conditionResults_ = 0;
+
+  /// @brief Stale watch deadline (ordered so the heap top is the earliest)
+  struct StaleDeadline {
+    uint32_t deadlineMs;
+    uint16_t watchIdx;
+    bool operator<(const StaleDeadline &other) const {
+      return (int32_t)(deadlineMs - other.deadlineMs) > 0;
+    }
+  };
+
+  // Sequence rules: per-machine state ranges, transitions grouped by state
+  std::vector<RuntimeStateMachine> machines_;
+  std::vector<RuntimeMachineState> machineStates_;
+  std::vector<RuntimeTransition> transitions_;
+
+  /// @brief Action fired this cycle, dispatched after evaluation
+  struct QueuedAction {
+    uint16_t actionIdx;
+    uint8_t priority;
+  };
+
+  /// @brief Dispatch policy of one capability used by the ruleset
+  struct CapabilitySlot {
+    bool coalesce = true;
+    bool stateful = false;
+    bool sent = false; // Stateful: paramHash holds the last call
+    uint32_t paramHash = 0;
+    int8_t asyncSlot = -1; // CapabilityWorker handler (-1 = inline)
+    TypedCapabilityHandler typed; // Inline typed thunk (empty = ParamMap)
+  };
+
+  // Per-cycle action queue; coalesced capabilities keep one entry each
+  std::vector<QueuedAction> actionQueue_;
+  std::vector<int16_t> slotEntry_; // capSlot -> queue index (-1 = none)
+  std::vector<CapabilitySlot> capSlots_;
+  CapabilityWorker worker_;
+  ActionScheduler scheduler_; // Timed action steps
+
+  /// @brief gpio_pulse output waiting to be restored
+  struct NativePulse {
+    bool active = false;
+    uint8_t pin = 0;
+    uint8_t restoreLevel = 0;
+    uint32_t endMs = 0;
+  };
+
+  StaticRulesetView staticRules_; // Flash tables (empty = none)
+  CompiledRuleset *compiled_ = nullptr;
+  bool compiledActive_ = false; // compiled_ matches the loaded ruleset
+  uint64_t nativePins_ = 0; // Pins rules may drive (enableNativeOutputs)
+  NativePulse pulses_[NATIVE_PULSE_SLOTS];
+
+  // Silence timers; deadlines are re-armed lazily, so frames cost nothing
+  std::vector<RuntimeStaleWatch> staleWatches_;
+  std::vector<StaleDeadline> staleHeap_;
+
   std::map<String, CapabilityHandler> handlers_;
+  std::map<String, TypedCapability> typedHandlers_;
   std::map<String, CapabilityMeta> capabilityMeta_;
 
   bool debugMode_ = false;
@@ -127,11 +347,52 @@ private:
   size_t debugQueueHead_ = 0;
 
   uint32_t rulesTriggered_ = 0;
+  uint32_t skippedInvocations_ = 0;
   String unknownCapability_;
 
+  void registerBuiltinCapabilities();
+  void handleCanTx(const ParamMap &params);
+  void handleCanSignal(const ParamMap &params);
   bool evaluateCondition(RuntimeCondition &cond, uint32_t nowMs);
-  void executeAction(RuntimeAction &action);
-  float decodeSignal(const RuntimeSignal &sig, const uint8_t *data);
+  bool executeAction(RuntimeAction &action, int16_t overrideParam = -1,
+                     float overrideValue = 0.0f);
+  void queueAction(uint16_t actionIdx, uint8_t priority);
+  void dispatchActions(uint32_t nowMs);
+  bool claimOutput(const RuntimeAction &action);
+  void recordOutput(const RuntimeAction &action, bool delivered);
+  void runDueSteps(uint32_t nowMs);
+  NativeKind nativeKindOf(const String &capabilityId) const;
+  bool validateNative(const RuntimeAction &action, NativeKind kind) const;
+  bool nativeArgsValid(NativeKind kind, int32_t pin, int32_t arg,
+                       int32_t widthMs) const;
+  void runNative(const RuntimeAction &action, int16_t overrideParam,
+                 float overrideValue);
+  void driveNative(NativeKind kind, uint8_t pin, int32_t arg,
+                   uint32_t widthMs);
+  void startPulse(uint8_t pin, uint8_t level, uint32_t widthMs);
+  void serviceNativePulses(uint32_t nowMs);
+  void updateStaticSignals(const CanFrame &frame);
+  void evaluateStaticRules(uint32_t nowMs);
+  void buildActionSlots();
+  float decodeSignal(const RuntimeSignal &sig, const uint8_t *data,
+                     size_t dataLen);
+  void updateSignal(RuntimeSignal &sig, const uint8_t *data, size_t dataLen,
+                    uint32_t nowMs);
+  void setSignalValue(RuntimeSignal &sig, float value, uint32_t nowMs);
+  void updateDerived(uint32_t nowMs);
+  void updateSignalGroup(SignalGroup &group, const uint8_t *data,
+                         uint32_t nowMs);
+  void buildSignalIndex();
+  void buildWindows();
+  void buildDerivedEdges();
+  void buildConditionIndex();
+  void buildStaleWatches(uint32_t nowMs);
+  void armStaleWatch(uint16_t watchIdx, uint32_t deadlineMs);
+  void serviceStaleWatches(uint32_t nowMs);
+  void reviveSignal(RuntimeSignal &sig, uint32_t nowMs);
+  void syncOperands();
+  void advanceStateMachines(uint32_t results, uint32_t changed,
+                            uint32_t nowMs);
 };
 
 } // namespace W4RP
@@ -0,0 +1,242 @@
+/**
+ * @file FrameCapture.cpp
+ * @brief CORE:FrameCapture - Capture ring implementation
+ */
+
+#include "FrameCapture.h"
+#include <cstring>
+#include <esp_heap_caps.h>
+
+namespace W4RP {
+
+namespace {
+constexpr size_t MIN_CAPACITY = 256;
+
+size_t writeVarint(uint8_t *out, uint32_t value) {
+  size_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+} // namespace
+
+bool FrameCapture::begin(size_t capacityBytes) {
+  end();
+  if (capacityBytes < MIN_CAPACITY)
+    capacityBytes = MIN_CAPACITY;
+
+  buf_ = (uint8_t *)heap_caps_malloc(capacityBytes, MALLOC_CAP_SPIRAM);
+  inPsram_ = buf_ != nullptr;
+  if (!buf_)
+    buf_ = (uint8_t *)heap_caps_malloc(capacityBytes, MALLOC_CAP_8BIT);
+
+  if (!buf_) {
+    Serial.printf("[Capture] Failed to allocate %u bytes\n",
+                  (unsigned)capacityBytes);
+    return false;
+  }
+
+  capacity_ = capacityBytes;
+  updatePreBytes();
+  clear();
+  Serial.printf("[Capture] %u byte ring in %s\n", (unsigned)capacity_,
+                inPsram_ ? "PSRAM" : "internal RAM");
+  return true;
+}
+
+void FrameCapture::end() {
+  if (buf_) {
+    heap_caps_free(buf_);
+    buf_ = nullptr;
+  }
+  capacity_ = 0;
+  inPsram_ = false;
+  state_ = State::IDLE;
+  clear();
+}
+
+void FrameCapture::setWindow(uint32_t preMs, uint32_t postMs) {
+  preUs_ = preMs * 1000;
+  postUs_ = postMs * 1000;
+  updatePreBytes();
+}
+
+void FrameCapture::updatePreBytes() {
+  uint64_t windowUs = (uint64_t)preUs_ + postUs_;
+  preBytes_ = windowUs ? (uint64_t)capacity_ * preUs_ / windowUs : capacity_;
+}
+
+void FrameCapture::clear() {
+  head_ = 0;
+  tail_ = 0;
+  used_ = 0;
+  recordCount_ = 0;
+  tailUs_ = 0;
+  headUs_ = 0;
+  triggered_ = false;
+  overflow_ = false;
+}
+
+bool FrameCapture::arm() {
+  if (!buf_)
+    return false;
+  clear();
+  stats_ = CaptureStats();
+  state_ = State::ARMED;
+  return true;
+}
+
+void FrameCapture::trigger(uint32_t nowUs) {
+  if (state_ != State::ARMED)
+    return;
+  triggerUs_ = nowUs;
+  triggered_ = true;
+  state_ = State::TRIGGERED;
+}
+
+void FrameCapture::stop() {
+  if (isRecording())
+    state_ = State::FROZEN;
+}
+
+bool FrameCapture::tick(uint32_t nowUs) {
+  if (state_ != State::TRIGGERED || nowUs - triggerUs_ < postUs_)
+    return false;
+  state_ = State::FROZEN;
+  return true;
+}
+
+size_t FrameCapture::readVarint(size_t pos, uint32_t &value) const {
+  value = 0;
+  size_t n = 0;
+  uint8_t b;
+  do {
+    b = at(pos + n);
+    value |= (uint32_t)(b & 0x7F) << (7 * n);
+    n++;
+  } while ((b & 0x80) && n < 5);
+  return n;
+}
+
+size_t FrameCapture::recordLength(size_t pos) const {
+  uint32_t delta;
+  size_t n = readVarint(pos, delta);
+  uint8_t flags = at(pos + n);
+  return n + 1 + ((flags & CAPTURE_REC_EXTENDED) ? 4 : 2) + (flags & 0x0F);
+}
+
+bool FrameCapture::evictOldest() {
+  if (recordCount_ == 0)
+    return false;
+
+  size_t len = recordLength(tail_);
+  tail_ = (tail_ + len) % capacity_;
+  used_ -= len;
+  recordCount_--;
+  stats_.evicted++;
+
+  // Next record's delta is relative to the one just removed
+  if (recordCount_ > 0) {
+    uint32_t delta;
+    readVarint(tail_, delta);
+    tailUs_ += delta;
+  }
+  return true;
+}
+
+void FrameCapture::record(const CanFrame &frame, uint32_t nowUs) {
+  if (!isRecording())
+    return;
+
+  uint8_t rec[CAPTURE_MAX_RECORD];
+  uint8_t dlc = frame.dlc > 8 ? 8 : frame.dlc;
+  size_t len = writeVarint(rec, recordCount_ ? nowUs - headUs_ : 0);
+
+  rec[len++] = dlc | (frame.extended ? CAPTURE_REC_EXTENDED : 0);
+  rec[len++] = frame.id & 0xFF;
+  rec[len++] = (frame.id >> 8) & 0xFF;
+  if (frame.extended) {
+    rec[len++] = (frame.id >> 16) & 0xFF;
+    rec[len++] = (frame.id >> 24) & 0xFF;
+  }
+  memcpy(rec + len, frame.data, dlc);
+  len += dlc;
+
+  if (state_ == State::ARMED) {
+    // Age out, then keep the post window's share of the ring free so a
+    // trigger on a busy bus still has room to record after it
+    while (recordCount_ > 0 && nowUs - tailUs_ > preUs_)
+      evictOldest();
+    while (recordCount_ > 0 && used_ + len > preBytes_)
+      evictOldest();
+  } else if (overflow_ || capacity_ - used_ < len) {
+    // Never overwrite pre-trigger history once triggered; after the first
+    // drop keep dropping, so a shorter frame can't leave a gap
+    overflow_ = true;
+    stats_.dropped++;
+    return;
+  }
+
+  size_t first = capacity_ - head_;
+  if (first >= len) {
+    memcpy(buf_ + head_, rec, len);
+  } else {
+    memcpy(buf_ + head_, rec, first);
+    memcpy(buf_, rec + first, len - first);
+  }
+  head_ = (head_ + len) % capacity_;
+  used_ += len;
+
+  if (recordCount_ == 0)
+    tailUs_ = nowUs;
+  headUs_ = nowUs;
+  recordCount_++;
+  stats_.recorded++;
+}
+
+size_t FrameCapture::getExportSize() const {
+  if (recordCount_ == 0)
+    return sizeof(CaptureHeader);
+  uint32_t delta;
+  size_t n = readVarint(tail_, delta);
+  return sizeof(CaptureHeader) + 1 + used_ - n;
+}
+
+size_t FrameCapture::readExport(size_t offset, uint8_t *dst,
+                                size_t len) const {
+  CaptureHeader header = {};
+  header.magic = CAPTURE_MAGIC;
+  header.version = CAPTURE_VERSION;
+  header.flags = (triggered_ ? CAPTURE_FLAG_TRIGGERED : 0) |
+                 (overflow_ ? CAPTURE_FLAG_OVERFLOW : 0);
+  header.recordCount = recordCount_;
+  header.startUs = tailUs_;
+  header.triggerUs = triggered_ ? triggerUs_ : 0;
+
+  size_t total = getExportSize();
+  if (offset >= total)
+    return 0;
+  if (len > total - offset)
+    len = total - offset;
+
+  uint32_t delta;
+  size_t skip = recordCount_ ? readVarint(tail_, delta) : 0;
+  const uint8_t *hdr = reinterpret_cast<const uint8_t *>(&header);
+
+  for (size_t i = 0; i < len; i++) {
+    size_t pos = offset + i;
+    if (pos < sizeof(CaptureHeader)) {
+      dst[i] = hdr[pos];
+    } else if (pos == sizeof(CaptureHeader)) {
+      dst[i] = 0; // First record delta
+    } else {
+      dst[i] = at(tail_ + skip + pos - sizeof(CaptureHeader) - 1);
+    }
+  }
+  return len;
+}
+
+} // namespace W4RP
@@ -0,0 +1,160 @@
+/**
+ * @file FrameCapture.h
+ * @brief CORE:FrameCapture - Raw CAN capture ring with trigger window
+ * @version 1.0.0
+ *
+ * Records received frames into a byte ring (PSRAM when available) using a
+ * compact encoding: varint timestamp delta, DLC/flags byte, 2- or 4-byte
+ * ID, payload. While armed the ring holds the last pre-trigger window; a
+ * trigger keeps recording for the post-trigger window, then freezes the
+ * ring for download.
+ */
+#pragma once
+#include "../interfaces/CAN.h"
+
+namespace W4RP {
+
+#define CAPTURE_MAGIC 0x50433457 // "W4CP" little-endian
+#define CAPTURE_VERSION 1
+#define CAPTURE_FLAG_TRIGGERED 0x01
+#define CAPTURE_FLAG_OVERFLOW 0x02
+#define CAPTURE_REC_EXTENDED 0x10
+#define CAPTURE_MAX_RECORD 18 // 5 varint + 1 flags + 4 ID + 8 data
+
+#pragma pack(push, 1)
+/**
+ * @struct CaptureHeader
+ * @brief Download header, followed by records oldest first
+ */
+struct CaptureHeader {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t flags;
+  uint16_t reserved;
+  uint32_t recordCount;
+  uint32_t startUs;   // Timestamp of first record
+  uint32_t triggerUs; // Valid if CAPTURE_FLAG_TRIGGERED
+};
+#pragma pack(pop)
+
+/**
+ * @struct CaptureStats
+ * @brief Capture counters since arm
+ */
+struct CaptureStats {
+  uint32_t recorded = 0;
+  uint32_t evicted = 0; // Aged out or overwritten before trigger
+  uint32_t dropped = 0; // Post-trigger frames that did not fit
+};
+
+/**
+ * @class FrameCapture
+ * @brief Pre/post trigger frame recorder
+ */
+class FrameCapture {
+public:
+  enum class State : uint8_t { IDLE, ARMED, TRIGGERED, FROZEN };
+
+  ~FrameCapture() { end(); }
+
+  /**
+   * @brief Allocate ring buffer (PSRAM first, then internal RAM)
+   * @param capacityBytes Ring size
+   * @return false if allocation failed
+   */
+  bool begin(size_t capacityBytes);
+
+  /// @brief Free ring buffer
+  void end();
+
+  bool isAllocated() const { return buf_ != nullptr; }
+  bool isInPsram() const { return inPsram_; }
+  size_t getCapacity() const { return capacity_; }
+
+  /**
+   * @brief Set trigger window
+   * While armed, history may use the pre share of the ring
+   * (preMs / (preMs + postMs)); the rest stays free for the post window.
+   * @param preMs History kept before trigger
+   * @param postMs Recording time after trigger
+   */
+  void setWindow(uint32_t preMs, uint32_t postMs);
+
+  /// @brief Clear ring and start recording
+  bool arm();
+
+  /**
+   * @brief Start post-trigger window (ignored unless armed)
+   * @param nowUs Current time in microseconds
+   */
+  void trigger(uint32_t nowUs);
+
+  /// @brief Freeze immediately
+  void stop();
+
+  /**
+   * @brief Record a received frame
+   * @param frame CAN frame
+   * @param nowUs Current time in microseconds
+   */
+  void record(const CanFrame &frame, uint32_t nowUs);
+
+  /**
+   * @brief Close post-trigger window if elapsed (call once per loop)
+   * @return true if the capture froze during this call
+   */
+  bool tick(uint32_t nowUs);
+
+  State getState() const { return state_; }
+  bool isRecording() const {
+    return state_ == State::ARMED || state_ == State::TRIGGERED;
+  }
+
+  /// @brief Encoded bytes currently held
+  size_t getUsedBytes() const { return used_; }
+  uint32_t getRecordCount() const { return recordCount_; }
+  const CaptureStats &getStats() const { return stats_; }
+
+  /// @brief Size of the download stream (CaptureHeader + records)
+  size_t getExportSize() const;
+
+  /**
+   * @brief Read download stream without linearizing the ring
+   * First record's delta is rewritten to 0 (relative to startUs).
+   * @param offset Byte offset into stream
+   * @param dst Destination buffer
+   * @param len Bytes requested
+   * @return Bytes copied
+   */
+  size_t readExport(size_t offset, uint8_t *dst, size_t len) const;
+
+private:
+  uint8_t *buf_ = nullptr;
+  size_t capacity_ = 0;
+  bool inPsram_ = false;
+
+  size_t head_ = 0; // Next write position
+  size_t tail_ = 0; // Oldest record
+  size_t used_ = 0;
+  uint32_t recordCount_ = 0;
+  uint32_t tailUs_ = 0; // Timestamp of oldest record
+  uint32_t headUs_ = 0; // Timestamp of newest record
+
+  State state_ = State::IDLE;
+  uint32_t preUs_ = 5000000;
+  uint32_t postUs_ = 1000000;
+  size_t preBytes_ = 0; // Ring bytes history may use while armed
+  uint32_t triggerUs_ = 0;
+  bool triggered_ = false;
+  bool overflow_ = false;
+  CaptureStats stats_;
+
+  void clear();
+  void updatePreBytes();
+  bool evictOldest();
+  uint8_t at(size_t pos) const { return buf_[pos % capacity_]; }
+  size_t readVarint(size_t pos, uint32_t &value) const;
+  size_t recordLength(size_t pos) const;
+};
+
+} // namespace W4RP
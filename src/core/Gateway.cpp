@@ -0,0 +1,120 @@
+/**
+ * @file Gateway.cpp
+ * @brief CORE:Gateway - CAN frame routing implementation
+ */
+
+#include "Gateway.h"
+
+namespace W4RP {
+
+bool Gateway::addRoute(const GatewayRoute &route) {
+  if (route.srcBus >= GATEWAY_MAX_BUSES || route.dstBus >= GATEWAY_MAX_BUSES ||
+      route.srcBus == route.dstBus ||
+      route.rewriteCount > GATEWAY_MAX_REWRITES) {
+    Serial.printf("[Gateway] Rejected route %u -> %u\n", route.srcBus,
+                  route.dstBus);
+    return false;
+  }
+
+  for (uint8_t i = 0; i < route.rewriteCount; i++) {
+    if (route.rewrites[i].byteIdx >= sizeof(CanFrame::data))
+      return false;
+  }
+
+  routes_.push_back(route);
+  routes_.back().canId &= route.mask;
+  compiled_ = false;
+  return true;
+}
+
+void Gateway::clearRoutes() {
+  routes_.clear();
+  compiled_ = false;
+}
+
+void Gateway::compile() {
+  for (BusDispatch &bd : dispatch_) {
+    bd.exact.clear();
+    bd.masked.clear();
+  }
+
+  for (size_t i = 0; i < routes_.size(); i++) {
+    const GatewayRoute &r = routes_[i];
+    BusDispatch &bd = dispatch_[r.srcBus];
+
+    if (r.mask == CAN_ID_MASK_EXACT) {
+      bd.exact[routeKey(r.canId, r.extended)].push_back(i);
+      continue;
+    }
+
+    MaskBucket *bucket = nullptr;
+    for (MaskBucket &b : bd.masked) {
+      if (b.mask == r.mask) {
+        bucket = &b;
+        break;
+      }
+    }
+    if (!bucket) {
+      bd.masked.push_back({r.mask, {}});
+      bucket = &bd.masked.back();
+    }
+    bucket->routes[routeKey(r.canId, r.extended)].push_back(i);
+  }
+
+  compiled_ = true;
+}
+
+void Gateway::forward(const RouteList &list, const CanFrame &frame,
+                      CAN *const *buses, size_t busCount) {
+  for (uint16_t idx : list) {
+    const GatewayRoute &r = routes_[idx];
+    CAN *dst = (r.dstBus < busCount) ? buses[r.dstBus] : nullptr;
+    if (!dst) {
+      stats_.dropped++;
+      continue;
+    }
+
+    CanFrame out = frame;
+    for (uint8_t i = 0; i < r.rewriteCount; i++) {
+      const GatewayRewrite &rw = r.rewrites[i];
+      out.data[rw.byteIdx] = (out.data[rw.byteIdx] & rw.andMask) | rw.orValue;
+    }
+
+    if (dst->tryTransmit(out)) {
+      stats_.forwarded++;
+    } else {
+      stats_.dropped++;
+    }
+  }
+}
+
+void Gateway::route(uint8_t srcBus, const CanFrame &frame, CAN *const *buses,
+                    size_t busCount) {
+  if (routes_.empty() || srcBus >= GATEWAY_MAX_BUSES)
+    return;
+  if (!compiled_)
+    compile();
+
+  uint32_t startUs = micros();
+  BusDispatch &bd = dispatch_[srcBus];
+
+  auto it = bd.exact.find(routeKey(frame.id, frame.extended));
+  if (it != bd.exact.end()) {
+    forward(it->second, frame, buses, busCount);
+  }
+
+  for (MaskBucket &bucket : bd.masked) {
+    auto mit =
+        bucket.routes.find(routeKey(frame.id & bucket.mask, frame.extended));
+    if (mit != bucket.routes.end()) {
+      forward(mit->second, frame, buses, busCount);
+    }
+  }
+
+  uint32_t elapsedUs = micros() - startUs;
+  stats_.totalLatencyUs += elapsedUs;
+  if (elapsedUs > stats_.maxLatencyUs)
+    stats_.maxLatencyUs = elapsedUs;
+}
+
+} // namespace W4RP
@@ -0,0 +1,119 @@
+/**
+ * @file Gateway.h
+ * @brief CORE:Gateway - CAN frame routing between buses
+ * @version 1.0.0
+ *
+ * Forwards frames from one CAN interface to another based on a routing
+ * table (source bus, ID/mask, destination bus, optional byte rewrites).
+ * Routes are compiled into per-bus hash tables so each frame costs one
+ * lookup for exact IDs plus one per distinct mask.
+ */
+#pragma once
+#include "../interfaces/CAN.h"
+#include "Types.h"
+#include <unordered_map>
+#include <vector>
+
+namespace W4RP {
+
+#define GATEWAY_MAX_BUSES 2
+#define GATEWAY_MAX_REWRITES 4
+
+/**
+ * @struct GatewayRewrite
+ * @brief Byte patch: data[byteIdx] = (data[byteIdx] & andMask) | orValue
+ */
+struct GatewayRewrite {
+  uint8_t byteIdx;
+  uint8_t andMask;
+  uint8_t orValue;
+};
+
+/**
+ * @struct GatewayRoute
+ * @brief Forward frames matching (id & mask) == (canId & mask) and the
+ * route's ID type
+ */
+struct GatewayRoute {
+  uint8_t srcBus;
+  uint8_t dstBus;
+  uint32_t canId;
+  uint32_t mask = CAN_ID_MASK_EXACT;
+  bool extended = false; // Match 29-bit frames (false = 11-bit only)
+  uint8_t rewriteCount = 0;
+  GatewayRewrite rewrites[GATEWAY_MAX_REWRITES];
+};
+
+/**
+ * @struct GatewayStats
+ * @brief Forwarding counters and routing latency
+ */
+struct GatewayStats {
+  uint32_t forwarded = 0;
+  uint32_t dropped = 0; // Destination refused (queue full, bus down)
+  uint32_t maxLatencyUs = 0;
+  uint32_t totalLatencyUs = 0;
+};
+
+/**
+ * @class Gateway
+ * @brief Compiled CAN routing table
+ */
+class Gateway {
+public:
+  /**
+   * @brief Add route (recompiled on next frame)
+   * @param route Route definition
+   * @return false if bus index or rewrite count invalid
+   */
+  bool addRoute(const GatewayRoute &route);
+
+  /// @brief Remove all routes
+  void clearRoutes();
+
+  /// @brief Check if any routes are configured
+  bool hasRoutes() const { return !routes_.empty(); }
+
+  /**
+   * @brief Forward frame to all matching destinations
+   * @param srcBus Index of bus the frame arrived on
+   * @param frame Received frame
+   * @param buses Bus table indexed by bus number
+   * @param busCount Entries in bus table
+   */
+  void route(uint8_t srcBus, const CanFrame &frame, CAN *const *buses,
+             size_t busCount);
+
+  const GatewayStats &getStats() const { return stats_; }
+  void resetStats() { stats_ = GatewayStats(); }
+
+private:
+  using RouteList = std::vector<uint16_t>;
+
+  // Lookup key: masked ID, bit 31 set for 29-bit frames
+  static constexpr uint32_t KEY_EXTENDED = 0x80000000;
+  static uint32_t routeKey(uint32_t id, bool extended) {
+    return (id & 0x1FFFFFFF) | (extended ? KEY_EXTENDED : 0);
+  }
+
+  struct MaskBucket {
+    uint32_t mask;
+    std::unordered_map<uint32_t, RouteList> routes;
+  };
+
+  struct BusDispatch {
+    std::unordered_map<uint32_t, RouteList> exact;
+    std::vector<MaskBucket> masked;
+  };
+
+  std::vector<GatewayRoute> routes_;
+  BusDispatch dispatch_[GATEWAY_MAX_BUSES];
+  bool compiled_ = false;
+  GatewayStats stats_;
+
+  void compile();
+  void forward(const RouteList &list, const CanFrame &frame,
+               CAN *const *buses, size_t busCount);
+};
+
+} // namespace W4RP
@@ -4,16 +4,19 @@
  */
 
 #include "Protocol.h"
+#include "WindowAggregate.h"
+#include <algorithm>
 #include <cstring>
 #include <esp_crc.h>
 
 namespace W4RP {
 
-uint32_t Protocol::calculateCRC32(const uint8_t *data, size_t len) {
-  return esp_crc32_le(0, data, len);
+uint32_t Protocol::calculateCRC32(const uint8_t *data, size_t len,
+                                  uint32_t crc) {
+  return esp_crc32_le(crc, data, len);
 }
 
-static String readStringFromTable(const uint8_t *stringTable, uint16_t offset,
+static String readStringFromTable(const uint8_t *stringTable, uint32_t offset,
                                   size_t tableLen) {
   if (offset >= tableLen)
     return String();
@@ -29,11 +32,581 @@ static String readStringFromTable(const uint8_t *stringTable, uint16_t offset,
   return String(ptr, len);
 }
 
-bool Protocol::parseRules(const uint8_t *data, size_t len,
-                          std::vector<RuntimeSignal> &outSignals,
-                          std::vector<RuntimeCondition> &outConditions,
-                          std::vector<RuntimeAction> &outActions,
-                          std::vector<RuntimeRule> &outRules) {
+template <typename Mask>
+static bool parseSignalMasks(const uint8_t *payload, size_t len,
+                             std::vector<RuntimeSignal> &signals) {
+  if (len % sizeof(Mask) != 0) {
+    Serial.println("[WBP] Error: Malformed signal mask section");
+    return false;
+  }
+
+  const Mask *masks = reinterpret_cast<const Mask *>(payload);
+  size_t count = len / sizeof(Mask);
+
+  for (size_t i = 0; i < count; i++) {
+    if (masks[i].signalIdx >= signals.size()) {
+      Serial.printf("[WBP] Error: Mask %d references invalid signal %d\n",
+                    (int)i, masks[i].signalIdx);
+      return false;
+    }
+    RuntimeSignal &sig = signals[masks[i].signalIdx];
+    sig.canMask = masks[i].mask;
+    sig.canId &= sig.canMask;
+  }
+
+  return true;
+}
+
+template <typename Mux>
+static bool parseSignalMux(const uint8_t *payload, size_t len,
+                           std::vector<RuntimeSignal> &signals) {
+  if (len % sizeof(Mux) != 0) {
+    Serial.println("[WBP] Error: Malformed signal mux section");
+    return false;
+  }
+
+  const Mux *muxes = reinterpret_cast<const Mux *>(payload);
+  size_t count = len / sizeof(Mux);
+
+  for (size_t i = 0; i < count; i++) {
+    uint16_t sigIdx = muxes[i].signalIdx;
+    uint16_t muxIdx = muxes[i].muxSignalIdx;
+    if (sigIdx >= signals.size() || muxIdx >= signals.size() ||
+        sigIdx == muxIdx) {
+      Serial.printf("[WBP] Error: Mux %d has invalid signal pair %d/%d\n",
+                    (int)i, sigIdx, muxIdx);
+      return false;
+    }
+
+    RuntimeSignal &sig = signals[sigIdx];
+    sig.multiplexed = true;
+    sig.muxSignalIdx = muxIdx;
+    sig.muxValue = muxes[i].muxValue;
+  }
+
+  return true;
+}
+
+template <typename Poll>
+static bool parseDiagPolls(const uint8_t *payload, size_t len,
+                           std::vector<RuntimeSignal> &signals,
+                           std::vector<RuntimeDiagPoll> &outPolls) {
+  if (len % sizeof(Poll) != 0) {
+    Serial.println("[WBP] Error: Malformed diagnostic poll section");
+    return false;
+  }
+
+  const Poll *polls = reinterpret_cast<const Poll *>(payload);
+  size_t count = len / sizeof(Poll);
+
+  for (size_t i = 0; i < count; i++) {
+    const Poll &wp = polls[i];
+    if (wp.signalStartIdx + wp.signalCount > signals.size()) {
+      Serial.printf("[WBP] Error: Poll %d signal range exceeds %d\n", (int)i,
+                    (int)signals.size());
+      return false;
+    }
+    if (wp.periodMs == 0) {
+      Serial.printf("[WBP] Error: Poll %d has zero period\n", (int)i);
+      return false;
+    }
+
+    RuntimeDiagPoll poll = {};
+    poll.requestId = wp.requestId;
+    poll.responseId = wp.responseId;
+    poll.extended = (wp.flags & WBP_POLL_FLAG_EXTENDED) != 0;
+    poll.service = wp.service;
+    poll.identifier = wp.identifier;
+    poll.periodMs = wp.periodMs;
+    poll.signalStartIdx = wp.signalStartIdx;
+    poll.signalCount = wp.signalCount;
+    outPolls.push_back(poll);
+
+    for (int j = 0; j < wp.signalCount; j++) {
+      signals[wp.signalStartIdx + j].polled = true;
+    }
+  }
+
+  return true;
+}
+
+template <typename Log>
+static bool parseSignalLog(const uint8_t *payload, size_t len,
+                           size_t signalCount,
+                           std::vector<RuntimeLogTrack> &outTracks) {
+  if (len % sizeof(Log) != 0) {
+    Serial.println("[WBP] Error: Malformed signal log section");
+    return false;
+  }
+
+  const Log *entries = reinterpret_cast<const Log *>(payload);
+  size_t count = len / sizeof(Log);
+
+  for (size_t i = 0; i < count; i++) {
+    const Log &wl = entries[i];
+    if (wl.signalIdx >= signalCount || wl.periodMs == 0) {
+      Serial.printf("[WBP] Error: Invalid log entry for signal %d\n",
+                    wl.signalIdx);
+      return false;
+    }
+    outTracks.push_back({wl.signalIdx, wl.periodMs});
+  }
+
+  return true;
+}
+
+template <typename Timeout>
+static bool parseSignalTimeouts(const uint8_t *payload, size_t len,
+                                std::vector<RuntimeSignal> &signals) {
+  if (len % sizeof(Timeout) != 0) {
+    Serial.println("[WBP] Error: Malformed signal timeout section");
+    return false;
+  }
+
+  const Timeout *entries = reinterpret_cast<const Timeout *>(payload);
+  size_t count = len / sizeof(Timeout);
+
+  for (size_t i = 0; i < count; i++) {
+    const Timeout &st = entries[i];
+    if (st.signalIdx >= signals.size() || st.timeoutMs == 0 ||
+        st.timeoutMs > 86400000) {
+      Serial.printf("[WBP] Error: Invalid timeout for signal %d\n",
+                    st.signalIdx);
+      return false;
+    }
+    signals[st.signalIdx].timeoutMs = st.timeoutMs;
+  }
+
+  return true;
+}
+
+template <typename Machine, typename Transition>
+static bool parseStateMachine(const uint8_t *payload, size_t len,
+                              size_t conditionCount, size_t actionCount,
+                              RuntimeExtensions &ext) {
+  const Machine *hdr = reinterpret_cast<const Machine *>(payload);
+  if (len < sizeof(Machine) ||
+      len != sizeof(Machine) + hdr->transitionCount * sizeof(Transition)) {
+    Serial.println("[WBP] Error: Malformed state machine section");
+    return false;
+  }
+  if (hdr->stateCount == 0 || hdr->initialState >= hdr->stateCount) {
+    Serial.println("[WBP] Error: Invalid state machine states");
+    return false;
+  }
+
+  const Transition *edges =
+      reinterpret_cast<const Transition *>(payload + sizeof(Machine));
+  uint32_t validMask =
+      conditionCount >= 32 ? 0xFFFFFFFF : (1UL << conditionCount) - 1;
+
+  for (size_t i = 0; i < hdr->transitionCount; i++) {
+    const Transition &e = edges[i];
+    if (e.fromState >= hdr->stateCount || e.toState >= hdr->stateCount ||
+        (e.conditionMask & ~validMask) ||
+        (e.conditionMask == 0 && e.timeoutMs == 0) ||
+        e.timeoutMs > 86400000 ||
+        e.actionStartIdx + e.actionCount > actionCount) {
+      Serial.printf("[WBP] Error: Invalid state transition %d\n", (int)i);
+      return false;
+    }
+  }
+
+  RuntimeStateMachine machine;
+  machine.firstState = ext.machineStates.size();
+  machine.stateCount = hdr->stateCount;
+  machine.initialState = hdr->initialState;
+  machine.state = hdr->initialState;
+
+  // Group transitions by source state so a step only scans the current one
+  for (uint8_t st = 0; st < hdr->stateCount; st++) {
+    RuntimeMachineState state = {};
+    state.firstTransition = ext.transitions.size();
+    for (size_t i = 0; i < hdr->transitionCount; i++) {
+      const Transition &e = edges[i];
+      if (e.fromState != st)
+        continue;
+      ext.transitions.push_back({e.toState, e.actionStartIdx, e.actionCount,
+                                 e.conditionMask, e.timeoutMs});
+      state.transitionCount++;
+      state.conditionMask |= e.conditionMask;
+      if (e.timeoutMs > 0 &&
+          (state.minTimeoutMs == 0 || e.timeoutMs < state.minTimeoutMs))
+        state.minTimeoutMs = e.timeoutMs;
+    }
+    ext.machineStates.push_back(state);
+  }
+
+  ext.machines.push_back(machine);
+  return true;
+}
+
+template <typename Priority>
+static bool parseRulePriorities(const uint8_t *payload, size_t len,
+                                std::vector<RuntimeRule> &rules) {
+  if (len % sizeof(Priority) != 0) {
+    Serial.println("[WBP] Error: Malformed rule priority section");
+    return false;
+  }
+
+  const Priority *entries = reinterpret_cast<const Priority *>(payload);
+  size_t count = len / sizeof(Priority);
+
+  for (size_t i = 0; i < count; i++) {
+    if (entries[i].ruleIdx >= rules.size()) {
+      Serial.printf("[WBP] Error: Priority for invalid rule %d\n",
+                    entries[i].ruleIdx);
+      return false;
+    }
+    rules[entries[i].ruleIdx].priority = entries[i].priority;
+  }
+
+  return true;
+}
+
+template <typename Step>
+static bool parseActionSteps(const uint8_t *payload, size_t len,
+                             const std::vector<RuntimeAction> &actions,
+                             std::vector<RuntimeActionStep> &outSteps) {
+  if (len % sizeof(Step) != 0) {
+    Serial.println("[WBP] Error: Malformed action step section");
+    return false;
+  }
+
+  const Step *entries = reinterpret_cast<const Step *>(payload);
+  size_t count = len / sizeof(Step);
+
+  for (size_t i = 0; i < count; i++) {
+    const Step &ws = entries[i];
+    bool valid = ws.ownerAction < actions.size() &&
+                 ws.stepAction < actions.size() &&
+                 ws.kind <= static_cast<uint8_t>(ActionStepKind::RAMP) &&
+                 ws.delayMs <= 86400000;
+
+    // A ramp sweeps a numeric parameter of the step action
+    if (valid && ws.kind == static_cast<uint8_t>(ActionStepKind::RAMP)) {
+      const std::vector<RuntimeParam> &params = actions[ws.stepAction].params;
+      valid = ws.intervalMs > 0 && ws.durationMs >= ws.intervalMs &&
+              ws.paramIdx < params.size() &&
+              (params[ws.paramIdx].type == ParamType::INT ||
+               params[ws.paramIdx].type == ParamType::FLOAT);
+    }
+
+    if (!valid) {
+      Serial.printf("[WBP] Error: Invalid action step %d\n", (int)i);
+      return false;
+    }
+
+    outSteps.push_back({ws.ownerAction, ws.stepAction,
+                        static_cast<ActionStepKind>(ws.kind), ws.paramIdx,
+                        ws.delayMs, ws.durationMs, ws.intervalMs, ws.from,
+                        ws.to});
+  }
+
+  return true;
+}
+
+static bool isBinaryOp(DerivedOp op) { return op <= DerivedOp::DIV; }
+
+template <typename Derived>
+static bool parseDerived(const uint8_t *payload, size_t len,
+                         std::vector<RuntimeSignal> &signals,
+                         std::vector<RuntimeDerived> &outDerived) {
+  if (len % sizeof(Derived) != 0) {
+    Serial.println("[WBP] Error: Malformed derived signal section");
+    return false;
+  }
+
+  const Derived *nodes = reinterpret_cast<const Derived *>(payload);
+  size_t count = len / sizeof(Derived);
+
+  for (size_t i = 0; i < count; i++) {
+    const Derived &wd = nodes[i];
+    DerivedOp op = static_cast<DerivedOp>(wd.op);
+    bool binary = isBinaryOp(op);
+
+    bool valid = wd.op <= static_cast<uint8_t>(DerivedOp::DERIVATIVE) &&
+                 wd.signalIdx < signals.size() &&
+                 wd.inputA < signals.size() &&
+                 (!binary || wd.inputB < signals.size()) &&
+                 !signals[wd.signalIdx].derived;
+    if (op == DerivedOp::EMA)
+      valid = valid && wd.param > 0.0f && wd.param <= 1.0f;
+    if (op == DerivedOp::LOWPASS)
+      valid = valid && wd.param > 0.0f;
+
+    if (!valid) {
+      Serial.printf("[WBP] Error: Invalid derived signal %d\n", (int)i);
+      return false;
+    }
+
+    RuntimeDerived node = {};
+    node.signalIdx = wd.signalIdx;
+    node.op = op;
+    node.inputA = wd.inputA;
+    node.inputB = binary ? wd.inputB : wd.inputA;
+    node.param = wd.param;
+    outDerived.push_back(node);
+    signals[wd.signalIdx].derived = true;
+  }
+
+  return true;
+}
+
+// Kahn's algorithm: order nodes so inputs are computed before outputs
+static bool sortDerived(const std::vector<RuntimeSignal> &signals,
+                        std::vector<RuntimeDerived> &nodes) {
+  size_t n = nodes.size();
+  std::vector<int16_t> producer(signals.size(), -1);
+  for (size_t i = 0; i < n; i++) {
+    producer[nodes[i].signalIdx] = i;
+  }
+
+  std::vector<uint8_t> pending(n, 0);
+  for (size_t i = 0; i < n; i++) {
+    if (producer[nodes[i].inputA] >= 0)
+      pending[i]++;
+    if (isBinaryOp(nodes[i].op) && producer[nodes[i].inputB] >= 0)
+      pending[i]++;
+  }
+
+  std::vector<RuntimeDerived> sorted;
+  sorted.reserve(n);
+  std::vector<size_t> ready;
+  for (size_t i = 0; i < n; i++) {
+    if (pending[i] == 0)
+      ready.push_back(i);
+  }
+
+  while (!ready.empty()) {
+    size_t done = ready.back();
+    ready.pop_back();
+    sorted.push_back(nodes[done]);
+
+    uint16_t out = nodes[done].signalIdx;
+    for (size_t i = 0; i < n; i++) {
+      uint8_t uses = (nodes[i].inputA == out) +
+                     (isBinaryOp(nodes[i].op) && nodes[i].inputB == out);
+      if (uses && (pending[i] -= uses) == 0)
+        ready.push_back(i);
+    }
+  }
+
+  if (sorted.size() != n) {
+    Serial.println("[WBP] Error: Derived signals contain a cycle");
+    return false;
+  }
+
+  nodes = std::move(sorted);
+  return true;
+}
+
+template <typename Signal> static RuntimeSignal parseSignal(const Signal &ws) {
+  RuntimeSignal sig = {};
+  sig.canId = ws.canId;
+  sig.startBit = ws.startBit;
+  sig.bitLength = ws.bitLength;
+  sig.bigEndian = (ws.flags & WBP_SIG_FLAG_BIG_ENDIAN) != 0;
+  sig.isSigned = (ws.flags & WBP_SIG_FLAG_SIGNED) != 0;
+  sig.factor = ws.factor;
+  sig.offset = ws.offset;
+
+  if (ws.flags & WBP_SIG_FLAG_J1939) {
+    // Match on PGN only. PDU1 (PF < 240) carries the destination
+    // address in PS, which is not part of the PGN either.
+    uint8_t pf = (sig.canId >> 16) & 0xFF;
+    sig.canMask = (pf < 240) ? J1939_PGN_MASK_PDU1 : J1939_PGN_MASK_PDU2;
+    sig.extendedOnly = true;
+  }
+  sig.canId &= sig.canMask;
+  return sig;
+}
+
+template <typename Condition>
+static bool parseCondition(const Condition &wc, int i, size_t signalCount,
+                           RuntimeCondition &cond) {
+  cond = {};
+  cond.signalIdx = wc.signalIdx;
+
+  // Validate signal index
+  if (cond.signalIdx >= signalCount) {
+    Serial.printf("[WBP] Error: Condition %d references invalid signal %d\n",
+                  i, cond.signalIdx);
+    return false;
+  }
+
+  // Validate operation code
+  uint8_t opCode = wc.operation & ~WBP_COND_FLAG_SIGNAL_OPERAND;
+  if (opCode > static_cast<uint8_t>(Operation::STALE)) {
+    Serial.printf("[WBP] Error: Condition %d has invalid operation %d\n", i,
+                  opCode);
+    return false;
+  }
+  cond.operation = static_cast<Operation>(opCode);
+
+  // Signal-to-signal comparison: signal <op> signal2 + value1
+  if (wc.operation & WBP_COND_FLAG_SIGNAL_OPERAND) {
+    if (cond.operation > Operation::LE || wc.signalIdx2 >= signalCount) {
+      Serial.printf("[WBP] Error: Condition %d has invalid operand\n", i);
+      return false;
+    }
+    cond.signalOperand = true;
+    cond.signalIdx2 = wc.signalIdx2;
+  }
+
+  cond.value1 = wc.value1;
+  cond.value2 = wc.value2;
+
+  if (cond.operation == Operation::HOLD) {
+    if (cond.value1 < 0.0f || cond.value1 > 86400000.0f) {
+      Serial.println("[WBP] Invalid hold time");
+      return false;
+    }
+    cond.holdMs = static_cast<uint32_t>(cond.value1);
+  }
+
+  if (cond.operation == Operation::STALE) {
+    if (cond.value1 < 1.0f || cond.value1 > 86400000.0f) {
+      Serial.println("[WBP] Invalid stale time");
+      return false;
+    }
+    cond.holdMs = static_cast<uint32_t>(cond.value1);
+  }
+
+  if (isWindowOp(cond.operation)) {
+    if (wc.compareOp > static_cast<uint8_t>(Operation::LE) ||
+        cond.value2 < 1.0f || cond.value2 > (float)WINDOW_MAX_MS) {
+      Serial.printf("[WBP] Error: Condition %d has invalid window\n", i);
+      return false;
+    }
+    cond.compare = static_cast<Operation>(wc.compareOp);
+    cond.windowMs = static_cast<uint32_t>(cond.value2);
+  }
+
+  if ((cond.operation == Operation::HYSTERESIS && cond.value1 == cond.value2) ||
+      (cond.operation == Operation::CHANGED && cond.value1 < 0.0f)) {
+    Serial.printf("[WBP] Error: Condition %d has invalid thresholds\n", i);
+    return false;
+  }
+
+  return true;
+}
+
+// Rules and state machines address conditions through 32-bit masks
+static bool checkConditionCount(size_t count) {
+  if (count > WBP_MAX_CONDITIONS) {
+    Serial.printf("[WBP] Error: %d conditions exceed limit of %d\n",
+                  (int)count, WBP_MAX_CONDITIONS);
+    return false;
+  }
+  return true;
+}
+
+static bool validateRule(const RuntimeRule &rule, int i,
+                         const std::vector<RuntimeCondition> &conditions,
+                         size_t actionCount) {
+  // Validate condition mask - ensure all referenced conditions exist
+  for (size_t c = 0; c < 32; c++) {
+    if (!(rule.conditionMask & (1UL << c)))
+      continue;
+    if (c >= conditions.size()) {
+      Serial.printf(
+          "[WBP] Error: Rule %d references non-existent condition %d\n", i,
+          (int)c);
+      return false;
+    }
+
+    // RISING/FALLING hold for one cycle and restart the debounce timer,
+    // so a debounced rule on one could never fire
+    Operation op = conditions[c].operation;
+    if (rule.debounceMs > 0 &&
+        (op == Operation::RISING || op == Operation::FALLING)) {
+      Serial.printf("[WBP] Error: Rule %d debounces edge condition %d\n", i,
+                    (int)c);
+      return false;
+    }
+  }
+
+  // Validate action indices
+  if (rule.actionStartIdx + rule.actionCount > actionCount) {
+    Serial.printf("[WBP] Error: Rule %d action range [%d, %d) exceeds %d\n", i,
+                  rule.actionStartIdx, rule.actionStartIdx + rule.actionCount,
+                  (int)actionCount);
+    return false;
+  }
+  return true;
+}
+
+// Extension entry layouts per WBP version
+struct ExtLayoutV2 {
+  using Mask = WBPSignalMask;
+  using Mux = WBPSignalMux;
+  using Poll = WBPDiagPoll;
+  using Log = WBPSignalLog;
+  using Derived = WBPDerivedSignal;
+  using Timeout = WBPSignalTimeout;
+  using Machine = WBPStateMachine;
+  using Transition = WBPStateTransition;
+  using Priority = WBPRulePriority;
+  using Step = WBPActionStep;
+};
+
+struct ExtLayoutV3 {
+  using Mask = WBPSignalMaskV3;
+  using Mux = WBPSignalMuxV3;
+  using Poll = WBPDiagPollV3;
+  using Log = WBPSignalLogV3;
+  using Derived = WBPDerivedSignalV3;
+  using Timeout = WBPSignalTimeoutV3;
+  using Machine = WBPStateMachineV3;
+  using Transition = WBPStateTransitionV3;
+  using Priority = WBPRulePriorityV3;
+  using Step = WBPActionStepV3;
+};
+
+template <typename L>
+static bool parseExtension(uint16_t type, const uint8_t *payload, size_t len,
+                           size_t conditionCount,
+                           std::vector<RuntimeSignal> &signals,
+                           std::vector<RuntimeAction> &actions,
+                           std::vector<RuntimeRule> &rules,
+                           RuntimeExtensions &ext) {
+  switch (type) {
+  case WBP_EXT_SIGNAL_MASKS:
+    return parseSignalMasks<typename L::Mask>(payload, len, signals);
+  case WBP_EXT_SIGNAL_MUX:
+    return parseSignalMux<typename L::Mux>(payload, len, signals);
+  case WBP_EXT_DIAG_POLLS:
+    return parseDiagPolls<typename L::Poll>(payload, len, signals,
+                                            ext.diagPolls);
+  case WBP_EXT_DERIVED:
+    return parseDerived<typename L::Derived>(payload, len, signals,
+                                             ext.derived);
+  case WBP_EXT_SIGNAL_TIMEOUTS:
+    return parseSignalTimeouts<typename L::Timeout>(payload, len, signals);
+  case WBP_EXT_STATE_MACHINE:
+    return parseStateMachine<typename L::Machine, typename L::Transition>(
+        payload, len, conditionCount, actions.size(), ext);
+  case WBP_EXT_RULE_PRIORITY:
+    return parseRulePriorities<typename L::Priority>(payload, len, rules);
+  case WBP_EXT_ACTION_STEPS:
+    return parseActionSteps<typename L::Step>(payload, len, actions,
+                                              ext.actionSteps);
+  case WBP_EXT_SIGNAL_LOG:
+    return parseSignalLog<typename L::Log>(payload, len, signals.size(),
+                                           ext.logTracks);
+  default:
+    // Unknown sections are skipped for forward compatibility
+    return true;
+  }
+}
+
+static bool parseRulesV2(const uint8_t *data, size_t len,
+                         std::vector<RuntimeSignal> &outSignals,
+                         std::vector<RuntimeCondition> &outConditions,
+                         std::vector<RuntimeAction> &outActions,
+                         std::vector<RuntimeRule> &outRules,
+                         RuntimeExtensions &outExt) {
   // Validate minimum length
   if (len < sizeof(WBPRulesHeader)) {
     Serial.println("[WBP] Error: Data too short for header");
@@ -42,12 +615,6 @@ bool Protocol::parseRules(const uint8_t *data, size_t len,
 
   const WBPRulesHeader *header = reinterpret_cast<const WBPRulesHeader *>(data);
 
-  // Validate magic
-  if (header->magic != WBP_MAGIC_RULES) {
-    Serial.printf("[WBP] Error: Invalid magic 0x%08X\n", header->magic);
-    return false;
-  }
-
   // Validate version
   if (header->version < WBP_MIN_VERSION || header->version > WBP_VERSION) {
     Serial.printf("[WBP] Error: Unsupported version %d\n", header->version);
@@ -69,7 +636,7 @@ bool Protocol::parseRules(const uint8_t *data, size_t len,
   // Validate CRC
   const uint8_t *crcData = data + sizeof(WBPRulesHeader);
   size_t crcLen = header->totalSize - sizeof(WBPRulesHeader);
-  uint32_t calculatedCrc = calculateCRC32(crcData, crcLen);
+  uint32_t calculatedCrc = Protocol::calculateCRC32(crcData, crcLen);
 
   if (calculatedCrc != header->crc32) {
     Serial.printf("[WBP] Error: CRC mismatch 0x%08X != 0x%08X\n", calculatedCrc,
@@ -106,6 +673,9 @@ bool Protocol::parseRules(const uint8_t *data, size_t len,
     return false;
   }
 
+  if (!checkConditionCount(header->conditionCount))
+    return false;
+
   const uint8_t *stringTable = data + header->stringTableOffset;
   size_t stringTableLen = header->totalSize - header->stringTableOffset;
 
@@ -114,17 +684,8 @@ bool Protocol::parseRules(const uint8_t *data, size_t len,
   outSignals.reserve(header->signalCount);
   const WBPSignal *signals = reinterpret_cast<const WBPSignal *>(data + offset);
 
-  for (int i = 0; i < header->signalCount; i++) {
-    RuntimeSignal sig = {};
-    sig.canId = signals[i].canId;
-    sig.startBit = signals[i].startBit;
-    sig.bitLength = signals[i].bitLength;
-    sig.bigEndian = (signals[i].flags & 0x01) != 0;
-    sig.isSigned = (signals[i].flags & 0x02) != 0;
-    sig.factor = signals[i].factor;
-    sig.offset = signals[i].offset;
-    outSignals.push_back(sig);
-  }
+  for (int i = 0; i < header->signalCount; i++)
+    outSignals.push_back(parseSignal(signals[i]));
   offset += header->signalCount * sizeof(WBPSignal);
 
   // Parse Conditions
@@ -134,36 +695,9 @@ bool Protocol::parseRules(const uint8_t *data, size_t len,
       reinterpret_cast<const WBPCondition *>(data + offset);
 
   for (int i = 0; i < header->conditionCount; i++) {
-    RuntimeCondition cond = {};
-    cond.signalIdx = conditions[i].signalIdx;
-
-    // Validate signal index
-    if (cond.signalIdx >= header->signalCount) {
-      Serial.printf("[WBP] Error: Condition %d references invalid signal %d\n",
-                    i, cond.signalIdx);
+    RuntimeCondition cond;
+    if (!parseCondition(conditions[i], i, header->signalCount, cond))
       return false;
-    }
-
-    // Validate operation code
-    uint8_t opCode = conditions[i].operation;
-    if (opCode > static_cast<uint8_t>(Operation::HOLD)) {
-      Serial.printf("[WBP] Error: Condition %d has invalid operation %d\n", i,
-                    opCode);
-      return false;
-    }
-    cond.operation = static_cast<Operation>(opCode);
-
-    cond.value1 = conditions[i].value1;
-    cond.value2 = conditions[i].value2;
-
-    if (cond.operation == Operation::HOLD) {
-      if (cond.value1 < 0.0f || cond.value1 > 86400000.0f) {
-        Serial.println("[WBP] Invalid hold time");
-        return false;
-      }
-      cond.holdMs = static_cast<uint32_t>(cond.value1);
-    }
-
     outConditions.push_back(cond);
   }
   offset += header->conditionCount * sizeof(WBPCondition);
@@ -244,28 +778,315 @@ bool Protocol::parseRules(const uint8_t *data, size_t len,
     rule.debounceMs = static_cast<uint16_t>(rules[i].debounceDs) * 10;
     rule.cooldownMs = static_cast<uint16_t>(rules[i].cooldownDs) * 10;
 
-    // Validate condition mask - ensure all referenced conditions exist
-    for (size_t c = 0; c < 32; c++) {
-      if ((rule.conditionMask & (1 << c)) && c >= header->conditionCount) {
-        Serial.printf(
-            "[WBP] Error: Rule %d references non-existent condition %d\n", i,
-            (int)c);
+    if (!validateRule(rule, i, outConditions, header->actionCount))
+      return false;
+
+    outRules.push_back(rule);
+  }
+  offset += header->ruleCount * sizeof(WBPRule);
+
+  // Parse extension sections (between rules and string table)
+  outExt = RuntimeExtensions();
+  if (header->flags & WBP_FLAG_HAS_EXT) {
+    while (offset + sizeof(WBPExtHeader) <= header->stringTableOffset) {
+      const WBPExtHeader *ext =
+          reinterpret_cast<const WBPExtHeader *>(data + offset);
+      offset += sizeof(WBPExtHeader);
+
+      if (offset + ext->length > header->stringTableOffset) {
+        Serial.printf("[WBP] Error: Extension 0x%02X overruns string table\n",
+                      ext->type);
         return false;
       }
+
+      if (!parseExtension<ExtLayoutV2>(ext->type, data + offset, ext->length,
+                                       header->conditionCount, outSignals,
+                                       outActions, outRules, outExt))
+        return false;
+      offset += ext->length;
+    }
+  }
+
+  return true;
+}
+
+// Table section holding exactly count entries; may be absent when empty
+template <typename Entry>
+static bool sectionTable(const uint8_t *data, const WBPSectionV3 *sec,
+                         size_t count, const Entry *&out) {
+  if (!sec) {
+    out = nullptr;
+    return count == 0;
+  }
+  out = reinterpret_cast<const Entry *>(data + sec->offset);
+  return sec->length % sizeof(Entry) == 0 &&
+         sec->length / sizeof(Entry) == count;
+}
+
+static bool parseRulesV3(const uint8_t *data, size_t len,
+                         std::vector<RuntimeSignal> &outSignals,
+                         std::vector<RuntimeCondition> &outConditions,
+                         std::vector<RuntimeAction> &outActions,
+                         std::vector<RuntimeRule> &outRules,
+                         RuntimeExtensions &outExt) {
+  if (len < sizeof(WBPRulesHeaderV3)) {
+    Serial.println("[WBP] Error: Data too short for header");
+    return false;
+  }
+
+  const WBPRulesHeaderV3 *header =
+      reinterpret_cast<const WBPRulesHeaderV3 *>(data);
+
+  if (header->totalSize > len) {
+    Serial.printf("[WBP] Error: Declared size %u > buffer %u\n",
+                  header->totalSize, (unsigned)len);
+    return false;
+  }
+
+  // Section directory follows the header
+  size_t dirEnd =
+      sizeof(WBPRulesHeaderV3) + header->sectionCount * sizeof(WBPSectionV3);
+  if (header->totalSize < dirEnd) {
+    Serial.println("[WBP] Error: Total size too small");
+    return false;
+  }
+
+  uint32_t calculatedCrc =
+      Protocol::calculateCRC32(data + sizeof(WBPRulesHeaderV3),
+                               header->totalSize - sizeof(WBPRulesHeaderV3));
+  if (calculatedCrc != header->crc32) {
+    Serial.printf("[WBP] Error: CRC mismatch 0x%08X != 0x%08X\n", calculatedCrc,
+                  header->crc32);
+    return false;
+  }
+
+  if (!checkConditionCount(header->conditionCount))
+    return false;
+
+  const WBPSectionV3 *sections =
+      reinterpret_cast<const WBPSectionV3 *>(data + sizeof(WBPRulesHeaderV3));
+  const WBPSectionV3 *core[WBP_SEC_STRINGS - WBP_SEC_META + 1] = {};
+
+  for (uint16_t s = 0; s < header->sectionCount; s++) {
+    const WBPSectionV3 &sec = sections[s];
+    if (sec.offset % WBP_SEC_ALIGN != 0 || sec.offset < dirEnd ||
+        sec.offset > header->totalSize ||
+        sec.length > header->totalSize - sec.offset) {
+      Serial.printf("[WBP] Error: Section 0x%02X out of bounds\n", sec.type);
+      return false;
+    }
+    if (sec.type < WBP_SEC_META || sec.type > WBP_SEC_STRINGS)
+      continue;
+    if (core[sec.type - WBP_SEC_META]) {
+      Serial.printf("[WBP] Error: Duplicate section 0x%02X\n", sec.type);
+      return false;
+    }
+    core[sec.type - WBP_SEC_META] = &sec;
+  }
+
+  const WBPSignalV3 *signals;
+  const WBPConditionV3 *conditions;
+  const WBPActionV3 *actions;
+  const WBPActionParamV3 *actionParams;
+  const WBPRuleV3 *rules;
+  if (!sectionTable(data, core[WBP_SEC_SIGNALS - WBP_SEC_META],
+                    header->signalCount, signals) ||
+      !sectionTable(data, core[WBP_SEC_CONDITIONS - WBP_SEC_META],
+                    header->conditionCount, conditions) ||
+      !sectionTable(data, core[WBP_SEC_ACTIONS - WBP_SEC_META],
+                    header->actionCount, actions) ||
+      !sectionTable(data, core[WBP_SEC_ACTION_PARAMS - WBP_SEC_META],
+                    header->actionParamCount, actionParams) ||
+      !sectionTable(data, core[WBP_SEC_RULES - WBP_SEC_META],
+                    header->ruleCount, rules)) {
+    Serial.println("[WBP] Error: Counts do not match sections");
+    return false;
+  }
+
+  const WBPSectionV3 *strings = core[WBP_SEC_STRINGS - WBP_SEC_META];
+  const uint8_t *stringTable = strings ? data + strings->offset : nullptr;
+  size_t stringTableLen = strings ? strings->length : 0;
+
+  // Parse Signals
+  outSignals.clear();
+  outSignals.reserve(header->signalCount);
+  for (int i = 0; i < header->signalCount; i++)
+    outSignals.push_back(parseSignal(signals[i]));
+
+  // Parse Conditions
+  outConditions.clear();
+  outConditions.reserve(header->conditionCount);
+  for (int i = 0; i < header->conditionCount; i++) {
+    RuntimeCondition cond;
+    if (!parseCondition(conditions[i], i, header->signalCount, cond))
+      return false;
+    outConditions.push_back(cond);
+  }
+
+  // Parse Actions
+  outActions.clear();
+  outActions.reserve(header->actionCount);
+  for (int i = 0; i < header->actionCount; i++) {
+    const WBPActionV3 &wa = actions[i];
+    RuntimeAction action = {};
+    action.capabilityId =
+        readStringFromTable(stringTable, wa.capStrOffset, stringTableLen);
+
+    if (action.capabilityId.isEmpty()) {
+      Serial.printf("[WBP] Error: Empty capability ID at action %d\n", i);
+      return false;
     }
 
-    // Validate action indices
-    if (rule.actionStartIdx + rule.actionCount > header->actionCount) {
-      Serial.printf("[WBP] Error: Rule %d action range [%d, %d) exceeds %d\n",
-                    i, rule.actionStartIdx,
-                    rule.actionStartIdx + rule.actionCount,
-                    header->actionCount);
+    if (wa.paramCount > header->actionParamCount ||
+        wa.paramStartIdx > header->actionParamCount - wa.paramCount) {
+      Serial.printf("[WBP] Error: Action %d param overflow (start=%u count=%d "
+                    "total=%u)\n",
+                    i, wa.paramStartIdx, wa.paramCount,
+                    header->actionParamCount);
       return false;
     }
 
+    action.params.reserve(wa.paramCount);
+    for (int j = 0; j < wa.paramCount; j++) {
+      const WBPActionParamV3 &ap = actionParams[wa.paramStartIdx + j];
+      RuntimeParam param = {};
+
+      if (ap.type > static_cast<uint8_t>(ParamType::BOOL)) {
+        Serial.printf("[WBP] Error: Action %d param %d has invalid type %d\n",
+                      i, j, ap.type);
+        return false;
+      }
+      param.type = static_cast<ParamType>(ap.type);
+
+      switch (param.type) {
+      case ParamType::INT:
+      case ParamType::BOOL:
+        param.intVal = ap.intVal;
+        break;
+      case ParamType::FLOAT:
+        param.floatVal = ap.floatVal;
+        break;
+      case ParamType::STRING:
+        param.strVal =
+            readStringFromTable(stringTable, ap.strOffset, stringTableLen);
+        break;
+      }
+
+      action.params.push_back(param);
+    }
+
+    outActions.push_back(action);
+  }
+
+  // Parse Rules
+  outRules.clear();
+  outRules.reserve(header->ruleCount);
+  for (int i = 0; i < header->ruleCount; i++) {
+    RuntimeRule rule = {};
+    rule.conditionMask = rules[i].conditionMask;
+    rule.actionStartIdx = rules[i].actionStartIdx;
+    rule.actionCount = rules[i].actionCount;
+    rule.debounceMs = rules[i].debounceMs;
+    rule.cooldownMs = rules[i].cooldownMs;
+
+    if (!validateRule(rule, i, outConditions, header->actionCount))
+      return false;
+
     outRules.push_back(rule);
   }
 
+  // Extension sections, in directory order, once the core tables exist
+  outExt = RuntimeExtensions();
+  for (uint16_t s = 0; s < header->sectionCount; s++) {
+    const WBPSectionV3 &sec = sections[s];
+    if (sec.type >= WBP_SEC_META && sec.type <= WBP_SEC_STRINGS)
+      continue;
+    if (!parseExtension<ExtLayoutV3>(sec.type, data + sec.offset, sec.length,
+                                     header->conditionCount, outSignals,
+                                     outActions, outRules, outExt))
+      return false;
+  }
+
+  return true;
+}
+
+bool Protocol::parseRules(const uint8_t *data, size_t len,
+                          std::vector<RuntimeSignal> &outSignals,
+                          std::vector<RuntimeCondition> &outConditions,
+                          std::vector<RuntimeAction> &outActions,
+                          std::vector<RuntimeRule> &outRules,
+                          RuntimeExtensions &outExt) {
+  // Magic and version lead both layouts
+  uint32_t magic;
+  if (len < sizeof(magic) + 1) {
+    Serial.println("[WBP] Error: Data too short for header");
+    return false;
+  }
+  memcpy(&magic, data, sizeof(magic));
+
+  if (magic != WBP_MAGIC_RULES) {
+    Serial.printf("[WBP] Error: Invalid magic 0x%08X\n", magic);
+    return false;
+  }
+
+  bool parsed;
+  if (data[4] == WBP_VERSION_V3) {
+    // v3 tables are read in place; realign a buffer that does not start
+    // on a word boundary
+    if (reinterpret_cast<uintptr_t>(data) % alignof(WBPRulesHeaderV3) != 0) {
+      std::vector<uint32_t> aligned((len + 3) / 4);
+      memcpy(aligned.data(), data, len);
+      return parseRules(reinterpret_cast<const uint8_t *>(aligned.data()),
+                        len, outSignals, outConditions, outActions, outRules,
+                        outExt);
+    }
+    parsed = parseRulesV3(data, len, outSignals, outConditions, outActions,
+                          outRules, outExt);
+  } else {
+    parsed = parseRulesV2(data, len, outSignals, outConditions, outActions,
+                          outRules, outExt);
+  }
+  if (!parsed)
+    return false;
+
+  if (!sortDerived(outSignals, outExt.derived))
+    return false;
+
+  // Steps run once; a step action may not start a sequence of its own
+  std::stable_sort(outExt.actionSteps.begin(), outExt.actionSteps.end(),
+                   [](const RuntimeActionStep &a, const RuntimeActionStep &b) {
+                     return a.ownerAction < b.ownerAction;
+                   });
+  for (const RuntimeActionStep &step : outExt.actionSteps) {
+    for (const RuntimeActionStep &other : outExt.actionSteps) {
+      if (other.ownerAction == step.stepAction) {
+        Serial.printf("[WBP] Error: Step action %d has steps\n",
+                      step.stepAction);
+        return false;
+      }
+    }
+  }
+
+  // Derived signals are never decoded; a multiplexor must share the frame
+  // and may not itself be multiplexed
+  for (size_t i = 0; i < outSignals.size(); i++) {
+    const RuntimeSignal &sig = outSignals[i];
+    if (sig.derived && (sig.polled || sig.multiplexed)) {
+      Serial.printf("[WBP] Error: Derived signal %d is also decoded\n",
+                    (int)i);
+      return false;
+    }
+    if (!sig.multiplexed)
+      continue;
+    const RuntimeSignal &mux = outSignals[sig.muxSignalIdx];
+    if (mux.multiplexed || mux.derived || mux.canId != sig.canId ||
+        mux.canMask != sig.canMask || mux.extendedOnly != sig.extendedOnly) {
+      Serial.printf("[WBP] Error: Signal %d has invalid multiplexor %d\n",
+                    (int)i, sig.muxSignalIdx);
+      return false;
+    }
+  }
+
   Serial.printf(
       "[WBP] Parsed: %d signals, %d conditions, %d actions, %d rules\n",
       outSignals.size(), outConditions.size(), outActions.size(),
@@ -336,6 +1157,7 @@ size_t Protocol::serializeProfile(
     cap.categoryStrIdx = strTable.add(meta.category);
     cap.paramCount = meta.params.size();
     cap.paramStartIdx = capParams.size();
+    cap.nativeKind = static_cast<uint8_t>(meta.native);
 
     for (const auto &p : meta.params) {
       WBPCapParam param = {};
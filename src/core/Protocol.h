@@ -21,25 +21,29 @@ public:
    * @brief Calculate CRC32 (IEEE 802.3)
    * @param data Data buffer
    * @param len Data length
+   * @param crc Running CRC to continue (0 to start)
    * @return CRC32 checksum
    */
-  static uint32_t calculateCRC32(const uint8_t *data, size_t len);
+  static uint32_t calculateCRC32(const uint8_t *data, size_t len,
+                                 uint32_t crc = 0);
 
   /**
    * @brief Parse WBP rules payload
-   * @param data WBP binary
+   * @param data WBP binary (v2, or v3 read in place)
    * @param len Data length
    * @param outSignals Output signals
    * @param outConditions Output conditions
    * @param outActions Output actions
    * @param outRules Output rules
+   * @param outExt Output extension sections
    * @return true if parsed successfully
    */
   static bool parseRules(const uint8_t *data, size_t len,
                          std::vector<RuntimeSignal> &outSignals,
                          std::vector<RuntimeCondition> &outConditions,
                          std::vector<RuntimeAction> &outActions,
-                         std::vector<RuntimeRule> &outRules);
+                         std::vector<RuntimeRule> &outRules,
+                         RuntimeExtensions &outExt);
 
   /**
    * @brief Serialize module profile to WBP
@@ -93,7 +97,8 @@ struct WBPSignal {
 struct WBPCondition {
   uint8_t signalIdx;
   uint8_t operation;
-  uint16_t reserved;
+  uint8_t compareOp;  // Window ops: EQ..LE applied to the aggregate
+  uint8_t signalIdx2; // WBP_COND_FLAG_SIGNAL_OPERAND: right-hand signal
   float value1;
   float value2;
 };
@@ -121,6 +126,90 @@ struct WBPRule {
   uint8_t cooldownDs;
 };
 
+struct WBPExtHeader {
+  uint8_t type;
+  uint8_t reserved;
+  uint16_t length; // Payload bytes following this header
+};
+
+struct WBPSignalMask {
+  uint8_t signalIdx;
+  uint8_t reserved1;
+  uint16_t reserved2;
+  uint32_t mask;
+};
+
+struct WBPSignalMux {
+  uint8_t signalIdx;    // Multiplexed signal
+  uint8_t muxSignalIdx; // Multiplexor signal (same CAN ID)
+  uint16_t muxValue;    // Page selecting this signal
+};
+
+struct WBPDiagPoll {
+  uint32_t requestId;
+  uint32_t responseId;
+  uint8_t service;
+  uint8_t flags; // Bit 0: extended (29-bit) IDs
+  uint16_t identifier;
+  uint16_t periodMs;
+  uint8_t signalStartIdx;
+  uint8_t signalCount;
+};
+
+struct WBPSignalLog {
+  uint8_t signalIdx;
+  uint8_t reserved;
+  uint16_t periodMs; // Sample period
+};
+
+struct WBPDerivedSignal {
+  uint8_t signalIdx; // Output signal
+  uint8_t op;        // DerivedOp
+  uint8_t inputA;
+  uint8_t inputB; // Binary ops only
+  float param;    // SCALE factor, EMA alpha, LOWPASS time constant (ms)
+};
+
+struct WBPSignalTimeout {
+  uint8_t signalIdx;
+  uint8_t reserved1;
+  uint16_t reserved2;
+  uint32_t timeoutMs; // Invalidate signal after this long without update
+};
+
+struct WBPStateMachine {
+  uint8_t stateCount;
+  uint8_t initialState;
+  uint8_t transitionCount; // WBPStateTransition entries that follow
+  uint8_t reserved;
+};
+
+struct WBPStateTransition {
+  uint8_t fromState;
+  uint8_t toState;
+  uint8_t actionStartIdx;
+  uint8_t actionCount;
+  uint32_t conditionMask; // All must hold (0 = timeout only)
+  uint32_t timeoutMs;     // Minimum time in fromState
+};
+
+struct WBPRulePriority {
+  uint8_t ruleIdx;
+  uint8_t priority; // Higher wins (default 0)
+};
+
+struct WBPActionStep {
+  uint8_t ownerAction; // Action that starts the sequence
+  uint8_t stepAction;  // Action invoked by this step
+  uint8_t kind;        // ActionStepKind
+  uint8_t paramIdx;    // RAMP: parameter of stepAction to sweep
+  uint32_t delayMs;    // From sequence start
+  uint16_t durationMs; // RAMP length
+  uint16_t intervalMs; // RAMP call period
+  float from;
+  float to;
+};
+
 struct WBPProfileHeader {
   uint32_t magic;
   uint8_t version;
@@ -148,7 +237,8 @@ struct WBPCapability {
   uint16_t categoryStrIdx;
   uint8_t paramCount;
   uint8_t paramStartIdx;
-  uint16_t reserved;
+  uint8_t nativeKind; // NativeKind (0 = handler)
+  uint8_t reserved;
 };
 
 struct WBPCapParam {
@@ -163,4 +253,167 @@ struct WBPCapParam {
 
 #pragma pack(pop)
 
+// WBP v3: every field is naturally aligned and every section starts on a
+// WBP_SEC_ALIGN boundary, so tables are read in place without packing.
+// Indices are 16-bit, offsets and counts of params 32-bit.
+
+struct WBPRulesHeaderV3 {
+  uint32_t magic;
+  uint8_t version; // WBP_VERSION_V3
+  uint8_t flags;
+  uint16_t sectionCount; // WBPSectionV3 entries following the header
+  uint32_t totalSize;
+  uint32_t crc32; // Bytes after the header up to totalSize
+  uint16_t signalCount;
+  uint16_t conditionCount;
+  uint16_t actionCount;
+  uint16_t ruleCount;
+  uint32_t actionParamCount;
+  uint32_t reserved;
+};
+
+struct WBPSectionV3 {
+  uint16_t type; // WBP_SEC_* or WBP_EXT_*
+  uint16_t reserved;
+  uint32_t offset; // From start of header
+  uint32_t length;
+};
+
+struct WBPSignalV3 {
+  uint32_t canId;
+  uint16_t startBit;
+  uint8_t bitLength;
+  uint8_t flags;
+  float factor;
+  float offset;
+};
+
+struct WBPConditionV3 {
+  uint16_t signalIdx;
+  uint16_t signalIdx2;
+  uint8_t operation;
+  uint8_t compareOp;
+  uint16_t reserved;
+  float value1;
+  float value2;
+};
+
+struct WBPActionV3 {
+  uint32_t capStrOffset;
+  uint32_t paramStartIdx;
+  uint16_t paramCount;
+  uint16_t reserved;
+};
+
+struct WBPActionParamV3 {
+  uint8_t type;
+  uint8_t reserved[3];
+  union {
+    int32_t intVal;     // INT, BOOL
+    float floatVal;     // FLOAT (unscaled, unlike v2)
+    uint32_t strOffset; // STRING
+  };
+};
+
+struct WBPRuleV3 {
+  uint32_t conditionMask;
+  uint32_t flowIdStrOffset;
+  uint16_t actionStartIdx;
+  uint16_t actionCount;
+  uint16_t debounceMs;
+  uint16_t cooldownMs;
+};
+
+struct WBPSignalMaskV3 {
+  uint16_t signalIdx;
+  uint16_t reserved;
+  uint32_t mask;
+};
+
+struct WBPSignalMuxV3 {
+  uint16_t signalIdx;
+  uint16_t muxSignalIdx;
+  uint16_t muxValue;
+  uint16_t reserved;
+};
+
+struct WBPDiagPollV3 {
+  uint32_t requestId;
+  uint32_t responseId;
+  uint8_t service;
+  uint8_t flags;
+  uint16_t identifier;
+  uint16_t periodMs;
+  uint16_t signalStartIdx;
+  uint16_t signalCount;
+  uint16_t reserved;
+};
+
+struct WBPSignalLogV3 {
+  uint16_t signalIdx;
+  uint16_t periodMs;
+};
+
+struct WBPDerivedSignalV3 {
+  uint16_t signalIdx;
+  uint8_t op;
+  uint8_t reserved;
+  uint16_t inputA;
+  uint16_t inputB;
+  float param;
+};
+
+struct WBPSignalTimeoutV3 {
+  uint16_t signalIdx;
+  uint16_t reserved;
+  uint32_t timeoutMs;
+};
+
+struct WBPStateMachineV3 {
+  uint8_t stateCount;
+  uint8_t initialState;
+  uint16_t transitionCount;
+};
+
+struct WBPStateTransitionV3 {
+  uint8_t fromState;
+  uint8_t toState;
+  uint16_t reserved;
+  uint16_t actionStartIdx;
+  uint16_t actionCount;
+  uint32_t conditionMask;
+  uint32_t timeoutMs;
+};
+
+struct WBPRulePriorityV3 {
+  uint16_t ruleIdx;
+  uint8_t priority;
+  uint8_t reserved;
+};
+
+struct WBPActionStepV3 {
+  uint16_t ownerAction;
+  uint16_t stepAction;
+  uint8_t kind;
+  uint8_t paramIdx;
+  uint16_t durationMs;
+  uint32_t delayMs;
+  uint16_t intervalMs;
+  uint16_t reserved;
+  float from;
+  float to;
+};
+
+static_assert(sizeof(WBPRulesHeaderV3) == 32, "WBP v3 header layout");
+static_assert(sizeof(WBPSectionV3) == 12, "WBP v3 section layout");
+static_assert(sizeof(WBPSignalV3) == 16, "WBP v3 signal layout");
+static_assert(sizeof(WBPConditionV3) == 16, "WBP v3 condition layout");
+static_assert(sizeof(WBPActionV3) == 12, "WBP v3 action layout");
+static_assert(sizeof(WBPActionParamV3) == 8, "WBP v3 param layout");
+static_assert(sizeof(WBPRuleV3) == 16, "WBP v3 rule layout");
+static_assert(sizeof(WBPDiagPollV3) == 20, "WBP v3 diag poll layout");
+static_assert(sizeof(WBPDerivedSignalV3) == 12, "WBP v3 derived layout");
+static_assert(sizeof(WBPStateTransitionV3) == 16, "WBP v3 transition layout");
+static_assert(sizeof(WBPActionStepV3) == 24, "WBP v3 action step layout");
+
 } // namespace W4RP
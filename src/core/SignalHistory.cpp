@@ -0,0 +1,390 @@
+/**
+ * @file SignalHistory.cpp
+ * @brief CORE:SignalHistory - Gorilla-style signal log implementation
+ */
+
+#include "SignalHistory.h"
+#include "Protocol.h"
+#include <algorithm>
+#include <cstring>
+
+namespace W4RP {
+
+namespace {
+// Worst case: 4 + 32 timestamp bits, 2 + 5 + 5 + 32 value bits
+constexpr size_t MAX_SAMPLE_BITS = 80;
+constexpr size_t SEGMENT_BLOB_BYTES =
+    sizeof(HistorySegmentHeader) + HISTORY_SEGMENT_BYTES;
+
+void putBits(uint8_t *buf, size_t &pos, uint32_t value, uint8_t n) {
+  for (int i = n - 1; i >= 0; i--) {
+    if ((value >> i) & 1)
+      buf[pos >> 3] |= 0x80 >> (pos & 7);
+    pos++;
+  }
+}
+
+bool getBits(const uint8_t *buf, size_t len, size_t &pos, uint8_t n,
+             uint32_t &out) {
+  if (pos + n > len * 8)
+    return false;
+  out = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    out = (out << 1) | ((buf[pos >> 3] >> (7 - (pos & 7))) & 1);
+    pos++;
+  }
+  return true;
+}
+
+uint32_t floatBits(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+float bitsFloat(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+} // namespace
+
+uint32_t SignalHistory::signalKey(const RuntimeSignal &sig) {
+  uint8_t flags = (sig.bigEndian ? 0x01 : 0) | (sig.isSigned ? 0x02 : 0) |
+                  (sig.extendedOnly ? 0x04 : 0) |
+                  (sig.multiplexed ? 0x08 : 0) | (sig.polled ? 0x10 : 0);
+
+  uint8_t def[24];
+  size_t n = 0;
+  memcpy(def + n, &sig.canId, 4);
+  n += 4;
+  memcpy(def + n, &sig.canMask, 4);
+  n += 4;
+  memcpy(def + n, &sig.startBit, 2);
+  n += 2;
+  def[n++] = sig.bitLength;
+  def[n++] = flags;
+  memcpy(def + n, &sig.factor, 4);
+  n += 4;
+  memcpy(def + n, &sig.offset, 4);
+  n += 4;
+  memcpy(def + n, &sig.muxValue, 2);
+  n += 2;
+
+  return Protocol::calculateCRC32(def, n);
+}
+
+void SignalHistory::slotKey(size_t slot, char *out, size_t outLen) {
+  snprintf(out, outLen, "hs%02u", (unsigned)slot);
+}
+
+void SignalHistory::begin(Storage *storage, size_t segments) {
+  storage_ = storage;
+  segments = std::min<size_t>(std::max<size_t>(segments, 1),
+                              HISTORY_MAX_SEGMENTS);
+  slots_.assign(segments, SegmentInfo());
+
+  uint8_t blob[SEGMENT_BLOB_BYTES];
+  uint32_t newestMs = 0;
+  size_t found = 0;
+
+  for (size_t i = 0; i < slots_.size(); i++) {
+    char key[8];
+    slotKey(i, key, sizeof(key));
+    size_t len = storage_->readBlob(key, nullptr, 0);
+    if (len < sizeof(HistorySegmentHeader) || len > sizeof(blob))
+      continue;
+    if (storage_->readBlob(key, blob, sizeof(blob)) != len)
+      continue;
+
+    const HistorySegmentHeader *h =
+        reinterpret_cast<const HistorySegmentHeader *>(blob);
+    if (h->magic != HISTORY_SEGMENT_MAGIC || h->count == 0)
+      continue;
+
+    slots_[i] = {h->signalKey, h->seq, h->firstMs, h->lastMs, h->count};
+    if (h->seq >= nextSeq_)
+      nextSeq_ = h->seq + 1;
+    if (h->lastMs > newestMs)
+      newestMs = h->lastMs;
+    found++;
+  }
+
+  baseMs_ = found ? newestMs + 1 : 0;
+  Serial.printf("[History] %u/%u segments, log time resumes at %u ms\n",
+                (unsigned)found, (unsigned)slots_.size(), baseMs_);
+}
+
+void SignalHistory::configure(const std::vector<RuntimeLogTrack> &tracks,
+                              const std::vector<RuntimeSignal> &signals,
+                              uint32_t rulesCrc) {
+  if (rulesCrc == rulesCrc_)
+    return;
+
+  flush();
+  tracks_.clear();
+  rulesCrc_ = rulesCrc;
+
+  tracks_.reserve(tracks.size());
+  for (const RuntimeLogTrack &lt : tracks) {
+    if (tracks_.size() >= HISTORY_MAX_TRACKS) {
+      Serial.printf("[History] Track limit %d reached\n", HISTORY_MAX_TRACKS);
+      break;
+    }
+    tracks_.emplace_back();
+    Track &t = tracks_.back();
+    t.signalIdx = lt.signalIdx;
+    t.periodMs = lt.periodMs;
+    t.signalKey = signalKey(signals[lt.signalIdx]);
+  }
+}
+
+void SignalHistory::service(const std::vector<RuntimeSignal> &signals,
+                            uint32_t nowMs) {
+  for (Track &t : tracks_) {
+    if (t.signalIdx >= signals.size())
+      continue;
+    const RuntimeSignal &sig = signals[t.signalIdx];
+    if (!sig.everSet)
+      continue;
+    if (t.sampled && nowMs - t.lastSampleMs < t.periodMs)
+      continue;
+
+    t.lastSampleMs = nowMs;
+    t.sampled = true;
+    append(t, getLogTime(nowMs), sig.value);
+  }
+}
+
+void SignalHistory::flush() {
+  for (Track &t : tracks_) {
+    seal(t);
+  }
+}
+
+void SignalHistory::append(Track &t, uint32_t timeMs, float value) {
+  if (t.count > 0 &&
+      (t.bitPos + MAX_SAMPLE_BITS > HISTORY_SEGMENT_BYTES * 8 ||
+       t.count == UINT16_MAX)) {
+    seal(t);
+  }
+
+  uint32_t bits = floatBits(value);
+  stats_.samples++;
+
+  if (t.count == 0) {
+    memset(t.buf, 0, sizeof(t.buf));
+    t.bitPos = 0;
+    putBits(t.buf, t.bitPos, bits, 32);
+    t.firstMs = timeMs;
+    t.lastMs = timeMs;
+    t.prevDelta = 0;
+    t.prevBits = bits;
+    t.hasWindow = false;
+    t.count = 1;
+    return;
+  }
+
+  // Timestamp: delta-of-delta in variable-width buckets
+  uint32_t delta = timeMs - t.lastMs;
+  int32_t dod = (int32_t)(delta - t.prevDelta);
+  if (dod == 0) {
+    putBits(t.buf, t.bitPos, 0, 1);
+  } else if (dod >= -63 && dod <= 64) {
+    putBits(t.buf, t.bitPos, 0x2, 2);
+    putBits(t.buf, t.bitPos, dod + 63, 7);
+  } else if (dod >= -255 && dod <= 256) {
+    putBits(t.buf, t.bitPos, 0x6, 3);
+    putBits(t.buf, t.bitPos, dod + 255, 9);
+  } else if (dod >= -2047 && dod <= 2048) {
+    putBits(t.buf, t.bitPos, 0xE, 4);
+    putBits(t.buf, t.bitPos, dod + 2047, 12);
+  } else {
+    putBits(t.buf, t.bitPos, 0xF, 4);
+    putBits(t.buf, t.bitPos, (uint32_t)dod, 32);
+  }
+
+  // Value: XOR with previous, reuse leading/trailing window when it fits
+  uint32_t x = bits ^ t.prevBits;
+  if (x == 0) {
+    putBits(t.buf, t.bitPos, 0, 1);
+  } else {
+    uint8_t lead = __builtin_clz(x);
+    uint8_t trail = __builtin_ctz(x);
+    if (t.hasWindow && lead >= t.prevLead && trail >= t.prevTrail) {
+      putBits(t.buf, t.bitPos, 0x2, 2);
+      putBits(t.buf, t.bitPos, x >> t.prevTrail,
+              32 - t.prevLead - t.prevTrail);
+    } else {
+      uint8_t len = 32 - lead - trail;
+      putBits(t.buf, t.bitPos, 0x3, 2);
+      putBits(t.buf, t.bitPos, lead, 5);
+      putBits(t.buf, t.bitPos, len - 1, 5);
+      putBits(t.buf, t.bitPos, x >> trail, len);
+      t.prevLead = lead;
+      t.prevTrail = trail;
+      t.hasWindow = true;
+    }
+  }
+
+  t.prevDelta = delta;
+  t.prevBits = bits;
+  t.lastMs = timeMs;
+  t.count++;
+}
+
+size_t SignalHistory::pickSlot() const {
+  size_t oldest = 0;
+  for (size_t i = 0; i < slots_.size(); i++) {
+    if (slots_[i].count == 0)
+      return i;
+    if (slots_[i].seq < slots_[oldest].seq)
+      oldest = i;
+  }
+  return oldest;
+}
+
+void SignalHistory::seal(Track &t) {
+  if (t.count == 0)
+    return;
+
+  if (storage_) {
+    size_t payloadLen = (t.bitPos + 7) / 8;
+    uint8_t blob[SEGMENT_BLOB_BYTES];
+
+    HistorySegmentHeader h;
+    h.magic = HISTORY_SEGMENT_MAGIC;
+    h.count = t.count;
+    h.signalKey = t.signalKey;
+    h.seq = nextSeq_++;
+    h.firstMs = t.firstMs;
+    h.lastMs = t.lastMs;
+    memcpy(blob, &h, sizeof(h));
+    memcpy(blob + sizeof(h), t.buf, payloadLen);
+
+    size_t slot = pickSlot();
+    char key[8];
+    slotKey(slot, key, sizeof(key));
+
+    if (storage_->writeBlob(key, blob, sizeof(h) + payloadLen)) {
+      slots_[slot] = {h.signalKey, h.seq, h.firstMs, h.lastMs, h.count};
+      stats_.segmentsWritten++;
+      stats_.payloadBytes += payloadLen;
+      stats_.flashBytes += sizeof(h) + payloadLen;
+    } else {
+      stats_.writeFailures++;
+    }
+  }
+
+  t.count = 0;
+  t.bitPos = 0;
+}
+
+size_t SignalHistory::decode(const uint8_t *payload, size_t payloadLen,
+                             uint16_t count, uint32_t firstMs, uint32_t fromMs,
+                             uint32_t toMs, const SampleCallback &callback) {
+  size_t pos = 0;
+  size_t visited = 0;
+  uint32_t bits;
+  if (count == 0 || !getBits(payload, payloadLen, pos, 32, bits))
+    return 0;
+
+  uint32_t timeMs = firstMs;
+  uint32_t prevDelta = 0;
+  uint8_t lead = 0;
+  uint8_t trail = 0;
+
+  for (uint16_t i = 0;; i++) {
+    if (timeMs > toMs)
+      break;
+    if (timeMs >= fromMs) {
+      callback(timeMs, bitsFloat(bits));
+      visited++;
+    }
+    if (i + 1 >= count)
+      break;
+
+    // Timestamp bucket: 0, 10, 110, 1110, 1111
+    uint32_t v = 0;
+    uint8_t ones = 0;
+    while (ones < 4 && getBits(payload, payloadLen, pos, 1, v) && v)
+      ones++;
+    static const uint8_t widths[] = {0, 7, 9, 12, 32};
+    static const int32_t biases[] = {0, 63, 255, 2047, 0};
+    int32_t dod = 0;
+    if (ones > 0) {
+      if (!getBits(payload, payloadLen, pos, widths[ones], v))
+        break;
+      dod = (int32_t)v - biases[ones];
+    }
+    prevDelta += dod;
+    timeMs += prevDelta;
+
+    if (!getBits(payload, payloadLen, pos, 1, v))
+      break;
+    if (v) {
+      if (!getBits(payload, payloadLen, pos, 1, v))
+        break;
+      if (v) {
+        uint32_t l, n;
+        if (!getBits(payload, payloadLen, pos, 5, l) ||
+            !getBits(payload, payloadLen, pos, 5, n))
+          break;
+        lead = l;
+        trail = 32 - lead - (n + 1);
+      }
+      uint32_t x;
+      if (!getBits(payload, payloadLen, pos, 32 - lead - trail, x))
+        break;
+      bits ^= x << trail;
+    }
+  }
+
+  return visited;
+}
+
+size_t SignalHistory::query(uint32_t key, uint32_t fromMs, uint32_t toMs,
+                            const SampleCallback &callback) {
+  std::vector<size_t> order;
+  for (size_t i = 0; i < slots_.size(); i++) {
+    const SegmentInfo &s = slots_[i];
+    if (s.count > 0 && s.signalKey == key && s.lastMs >= fromMs &&
+        s.firstMs <= toMs) {
+      order.push_back(i);
+    }
+  }
+  std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    return slots_[a].seq < slots_[b].seq;
+  });
+
+  size_t visited = 0;
+  uint8_t blob[SEGMENT_BLOB_BYTES];
+
+  for (size_t m = 0; m < order.size() && storage_; m++) {
+    char slot[8];
+    slotKey(order[m], slot, sizeof(slot));
+    size_t len = storage_->readBlob(slot, blob, sizeof(blob));
+    if (len < sizeof(HistorySegmentHeader))
+      continue;
+
+    const HistorySegmentHeader *h =
+        reinterpret_cast<const HistorySegmentHeader *>(blob);
+    if (h->magic != HISTORY_SEGMENT_MAGIC || h->signalKey != key)
+      continue;
+    visited += decode(blob + sizeof(*h), len - sizeof(*h), h->count,
+                      h->firstMs, fromMs, toMs, callback);
+  }
+
+  // Samples not yet sealed
+  for (const Track &t : tracks_) {
+    if (t.signalKey == key && t.count > 0 && t.lastMs >= fromMs &&
+        t.firstMs <= toMs) {
+      visited += decode(t.buf, (t.bitPos + 7) / 8, t.count, t.firstMs, fromMs,
+                        toMs, callback);
+    }
+  }
+
+  return visited;
+}
+
+} // namespace W4RP
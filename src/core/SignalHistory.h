@@ -0,0 +1,162 @@
+/**
+ * @file SignalHistory.h
+ * @brief CORE:SignalHistory - Compressed on-device signal log
+ * @version 1.0.0
+ *
+ * Samples selected signals into per-signal segments using Gorilla-style
+ * compression (delta-of-delta timestamps, XOR'd float values). Full
+ * segments are written once to Storage as append-only blobs; the segment
+ * index lives in RAM and is rebuilt from segment headers in begin().
+ */
+#pragma once
+#include "../interfaces/Storage.h"
+#include "Types.h"
+#include <functional>
+#include <vector>
+
+namespace W4RP {
+
+#define HISTORY_MAX_TRACKS 8
+#define HISTORY_DEFAULT_SEGMENTS 32 // About 9 KB of NVS
+#define HISTORY_MAX_SEGMENTS 4096   // RAM index: 20 bytes per segment
+#define HISTORY_SEGMENT_BYTES 256 // Compressed payload per segment
+#define HISTORY_SEGMENT_MAGIC 0x5348 // "HS"
+
+#pragma pack(push, 1)
+/**
+ * @struct HistorySegmentHeader
+ * @brief Stored in front of each segment payload
+ */
+struct HistorySegmentHeader {
+  uint16_t magic;
+  uint16_t count;     // Samples in payload
+  uint32_t signalKey; // SignalHistory::signalKey() of the source signal
+  uint32_t seq;       // Write order (oldest is overwritten first)
+  uint32_t firstMs;   // Log time of first sample
+  uint32_t lastMs;    // Log time of last sample
+};
+#pragma pack(pop)
+
+/**
+ * @struct SignalHistoryStats
+ * @brief Logging and flash write counters since boot
+ */
+struct SignalHistoryStats {
+  uint32_t samples = 0;
+  uint32_t segmentsWritten = 0;
+  uint32_t payloadBytes = 0; // Compressed sample bytes sealed
+  uint32_t flashBytes = 0;   // Bytes handed to Storage (incl. headers)
+  uint32_t writeFailures = 0;
+};
+
+/**
+ * @class SignalHistory
+ * @brief Long-term signal log over Storage blobs
+ */
+class SignalHistory {
+public:
+  using SampleCallback = std::function<void(uint32_t timeMs, float value)>;
+
+  /**
+   * @brief Rebuild segment index from storage
+   * Log time resumes after the newest stored sample, so power-off gaps
+   * are collapsed. Retention grows linearly with the segment count; see
+   * docs/core/history.md for sizing.
+   * @param storage Storage backend (not owned)
+   * @param segments Segment slots (blobs hs00..), at most
+   * HISTORY_MAX_SEGMENTS
+   */
+  void begin(Storage *storage, size_t segments = HISTORY_DEFAULT_SEGMENTS);
+
+  /**
+   * @brief Apply track list of a ruleset (no-op if rulesCrc unchanged)
+   * Open segments of the previous ruleset are sealed first.
+   */
+  void configure(const std::vector<RuntimeLogTrack> &tracks,
+                 const std::vector<RuntimeSignal> &signals, uint32_t rulesCrc);
+
+  /**
+   * @brief Sample due tracks (call once per loop)
+   * @param signals Engine signals
+   * @param nowMs Current millis()
+   */
+  void service(const std::vector<RuntimeSignal> &signals, uint32_t nowMs);
+
+  /// @brief Write all open segments to storage
+  void flush();
+
+  /**
+   * @brief Visit samples of one signal in time order
+   * @param signalKey Key from signalKey()
+   * @param fromMs Start of range (log time, inclusive)
+   * @param toMs End of range (log time, inclusive)
+   * @param callback Called per sample
+   * @return Samples visited
+   */
+  size_t query(uint32_t signalKey, uint32_t fromMs, uint32_t toMs,
+               const SampleCallback &callback);
+
+  /// @brief Convert millis() to log time
+  uint32_t getLogTime(uint32_t nowMs) const { return baseMs_ + nowMs; }
+
+  /// @brief Check if any tracks are configured
+  bool isActive() const { return !tracks_.empty(); }
+
+  /// @brief Segment slots set by begin()
+  size_t getSegmentCount() const { return slots_.size(); }
+
+  /**
+   * @brief Stable identity of a signal definition
+   * History survives ruleset edits as long as the decode is unchanged.
+   */
+  static uint32_t signalKey(const RuntimeSignal &sig);
+
+  const SignalHistoryStats &getStats() const { return stats_; }
+
+private:
+  struct SegmentInfo {
+    uint32_t signalKey;
+    uint32_t seq;
+    uint32_t firstMs;
+    uint32_t lastMs;
+    uint16_t count; // 0 = slot unused
+  };
+
+  /// @brief Open segment + compressor state for one signal
+  struct Track {
+    uint16_t signalIdx;
+    uint16_t periodMs;
+    uint32_t signalKey;
+    uint32_t lastSampleMs = 0;
+    bool sampled = false;
+
+    uint8_t buf[HISTORY_SEGMENT_BYTES];
+    size_t bitPos = 0;
+    uint16_t count = 0;
+    uint32_t firstMs = 0;
+    uint32_t lastMs = 0;
+    uint32_t prevDelta = 0;
+    uint32_t prevBits = 0;
+    uint8_t prevLead = 0;
+    uint8_t prevTrail = 0;
+    bool hasWindow = false;
+  };
+
+  Storage *storage_ = nullptr;
+  std::vector<SegmentInfo> slots_;
+  std::vector<Track> tracks_;
+  uint32_t rulesCrc_ = 0;
+  uint32_t nextSeq_ = 1;
+  uint32_t baseMs_ = 0;
+  SignalHistoryStats stats_;
+
+  void append(Track &track, uint32_t timeMs, float value);
+  void seal(Track &track);
+  size_t pickSlot() const;
+  static void slotKey(size_t slot, char *out, size_t outLen);
+  static size_t decode(const uint8_t *payload, size_t payloadLen,
+                       uint16_t count, uint32_t firstMs, uint32_t fromMs,
+                       uint32_t toMs, const SampleCallback &callback);
+};
+
+} // namespace W4RP
@@ -0,0 +1,206 @@
+/**
+ * @file StaticRuleset.h
+ * @brief CORE:StaticRuleset - Rules compiled into firmware
+ * @version 1.0.0
+ *
+ * Factory rules declared as constexpr arrays live in flash and run without
+ * NVS, CRC, parsing or heap allocation. Only per-signal values and
+ * per-rule timers sit in RAM, sized at compile time. A static ruleset runs
+ * next to the dynamic (WBP) ruleset; clearRuleset() doesn't touch it.
+ *
+ * @code
+ * constexpr StaticSignal kSignals[] = {
+ *     {0x316, 16, 16, false, false, 0.25f, 0.0f}}; // RPM
+ * constexpr StaticCondition kConditions[] = {{0, Operation::GT, 6000}};
+ * constexpr StaticAction kActions[] = {{NativeKind::GPIO_SET, 4, 1}};
+ * constexpr StaticRule kRules[] = {{0x1, 0, 1, 0, 1000}};
+ * static_assert(isValidStaticRuleset(kSignals, kConditions, kActions,
+ *                                    kRules), "factory rules");
+ *
+ * static auto factoryRules =
+ *     makeStaticRuleset(kSignals, kConditions, kActions, kRules);
+ * engine.attachStaticRuleset(factoryRules);
+ * @endcode
+ */
+#pragma once
+#include "Types.h"
+
+namespace W4RP {
+
+/**
+ * @struct StaticSignal
+ * @brief Signal decoded from a standard or extended CAN ID
+ */
+struct StaticSignal {
+  uint32_t canId;
+  uint16_t startBit;
+  uint8_t bitLength;
+  bool bigEndian;
+  bool isSigned;
+  float factor;
+  float offset;
+};
+
+/**
+ * @struct StaticCondition
+ * @brief Value comparison (EQ..LE, WITHIN, OUTSIDE)
+ */
+struct StaticCondition {
+  uint8_t signalIdx;
+  Operation operation;
+  float value1;
+  float value2 = 0.0f; // WITHIN / OUTSIDE upper bound
+};
+
+/**
+ * @struct StaticAction
+ * @brief Native output or plain function call
+ */
+struct StaticAction {
+  NativeKind native;    // NONE = call callback(arg)
+  uint8_t pin;          // Native: GPIO (must be enabled)
+  int32_t arg;          // Level, duty or callback argument
+  uint32_t widthMs = 0; // GPIO_PULSE width
+  void (*callback)(int32_t) = nullptr;
+};
+
+/**
+ * @struct StaticRule
+ * @brief Rule over up to 32 static conditions
+ */
+struct StaticRule {
+  uint32_t conditionMask;
+  uint8_t actionStartIdx;
+  uint8_t actionCount;
+  uint16_t debounceMs;
+  uint16_t cooldownMs;
+};
+
+/// @brief Runtime state of a static signal
+struct StaticSignalState {
+  float value;
+  bool everSet;
+};
+
+/// @brief Runtime state of a static rule
+struct StaticRuleState {
+  uint32_t lastTriggerMs;
+  uint32_t lastConditionChangeMs;
+  bool lastConditionState;
+};
+
+/**
+ * @struct StaticRulesetView
+ * @brief Size-erased view the Engine runs (tables in flash, state in RAM)
+ */
+struct StaticRulesetView {
+  const StaticSignal *signals = nullptr;
+  size_t signalCount = 0;
+  const StaticCondition *conditions = nullptr;
+  size_t conditionCount = 0;
+  const StaticAction *actions = nullptr;
+  size_t actionCount = 0;
+  const StaticRule *rules = nullptr;
+  size_t ruleCount = 0;
+  StaticSignalState *signalState = nullptr;
+  StaticRuleState *ruleState = nullptr;
+};
+
+/**
+ * @struct StaticRuleset
+ * @brief Static tables plus their state, sized by the tables
+ * Give it static storage duration; the Engine keeps pointers into it.
+ */
+template <size_t S, size_t C, size_t A, size_t R> struct StaticRuleset {
+  const StaticSignal (&signals)[S];
+  const StaticCondition (&conditions)[C];
+  const StaticAction (&actions)[A];
+  const StaticRule (&rules)[R];
+  StaticSignalState signalState[S] = {};
+  StaticRuleState ruleState[R] = {};
+
+  StaticRulesetView view() {
+    return {signals, S,     conditions, C,           actions,
+            A,       rules, R,          signalState, ruleState};
+  }
+};
+
+/// @brief Bind static tables (sizes are deduced)
+template <size_t S, size_t C, size_t A, size_t R>
+StaticRuleset<S, C, A, R>
+makeStaticRuleset(const StaticSignal (&signals)[S],
+                  const StaticCondition (&conditions)[C],
+                  const StaticAction (&actions)[A],
+                  const StaticRule (&rules)[R]) {
+  return {signals, conditions, actions, rules};
+}
+
+/**
+ * @brief Check table cross-references (also run by attachStaticRuleset)
+ * Native pins are checked by the Engine when attaching.
+ */
+constexpr bool isValidStaticRuleset(const StaticRulesetView &rs) {
+  if (rs.conditionCount > 32)
+    return false;
+  for (size_t i = 0; i < rs.signalCount; i++) {
+    if (rs.signals[i].bitLength == 0 || rs.signals[i].bitLength > 64)
+      return false;
+  }
+  for (size_t i = 0; i < rs.conditionCount; i++) {
+    if (rs.conditions[i].signalIdx >= rs.signalCount ||
+        rs.conditions[i].operation > Operation::OUTSIDE)
+      return false;
+  }
+  for (size_t i = 0; i < rs.actionCount; i++) {
+    if (rs.actions[i].native == NativeKind::NONE && !rs.actions[i].callback)
+      return false;
+  }
+  for (size_t i = 0; i < rs.ruleCount; i++) {
+    const StaticRule &rule = rs.rules[i];
+    if (rs.conditionCount < 32 && (rule.conditionMask >> rs.conditionCount))
+      return false;
+    if (rule.actionStartIdx + rule.actionCount > rs.actionCount)
+      return false;
+  }
+  return true;
+}
+
+/// @brief Compile-time check of static tables (use in static_assert)
+template <size_t S, size_t C, size_t A, size_t R>
+constexpr bool isValidStaticRuleset(const StaticSignal (&signals)[S],
+                                    const StaticCondition (&conditions)[C],
+                                    const StaticAction (&actions)[A],
+                                    const StaticRule (&rules)[R]) {
+  return isValidStaticRuleset(StaticRulesetView{
+      signals, S, conditions, C, actions, A, rules, R, nullptr, nullptr});
+}
+
+/// @brief Evaluate a static condition against a signal value
+constexpr bool evaluateStaticCondition(const StaticCondition &cond,
+                                       float value) {
+  // Same epsilon as Engine::evaluateCondition()
+  float diff =
+      (value > cond.value1) ? value - cond.value1 : cond.value1 - value;
+  switch (cond.operation) {
+  case Operation::EQ:
+    return diff < 0.0001f;
+  case Operation::NE:
+    return diff >= 0.0001f;
+  case Operation::GT:
+    return value > cond.value1;
+  case Operation::GE:
+    return value >= cond.value1;
+  case Operation::LT:
+    return value < cond.value1;
+  case Operation::LE:
+    return value <= cond.value1;
+  case Operation::WITHIN:
+    return value >= cond.value1 && value <= cond.value2;
+  case Operation::OUTSIDE:
+    return value < cond.value1 || value > cond.value2;
+  default:
+    return false;
+  }
+}
+
+} // namespace W4RP
@@ -0,0 +1,250 @@
+/**
+ * @file TxScheduler.cpp
+ * @brief CORE:TxScheduler - CAN transmit scheduler implementation
+ */
+
+#include "TxScheduler.h"
+#include <cmath>
+#include <cstring>
+
+namespace W4RP {
+
+static void insertBits(uint8_t *data, size_t dataLen, uint16_t start,
+                       uint8_t len, bool bigEndian, uint64_t raw) {
+  if (len == 0 || len > 64)
+    return;
+
+  if (!bigEndian) {
+    for (uint8_t i = 0; i < len; i++) {
+      uint32_t bitPos = start + i;
+      size_t byteIdx = bitPos / 8;
+      uint8_t bitIdx = bitPos % 8;
+      if (byteIdx < dataLen) {
+        uint8_t bit = (raw >> i) & 1;
+        data[byteIdx] = (data[byteIdx] & ~(1 << bitIdx)) | (bit << bitIdx);
+      }
+    }
+  } else {
+    // Mirrors extractBits: MSB at start, walking down
+    for (uint8_t i = 0; i < len; i++) {
+      int bitPos = start - i;
+      if (bitPos < 0 || bitPos >= (int)(dataLen * 8))
+        continue;
+      size_t byteIdx = bitPos / 8;
+      uint8_t bitIdx = bitPos % 8;
+      uint8_t bit = (raw >> (len - 1 - i)) & 1;
+      data[byteIdx] = (data[byteIdx] & ~(1 << bitIdx)) | (bit << bitIdx);
+    }
+  }
+}
+
+void TxScheduler::encodeSignal(const RuntimeSignal &layout, float value,
+                               uint8_t *data, size_t dataLen) {
+  if (layout.bitLength == 0 || layout.bitLength > 64)
+    return;
+
+  float scaled = (layout.factor != 0.0f)
+                     ? (value - layout.offset) / layout.factor
+                     : value - layout.offset;
+  double rounded = round(scaled);
+
+  // Clamp to representable range
+  double minRaw, maxRaw;
+  if (layout.isSigned) {
+    minRaw = -ldexp(1.0, layout.bitLength - 1);
+    maxRaw = ldexp(1.0, layout.bitLength - 1) - 1.0;
+  } else {
+    minRaw = 0.0;
+    maxRaw = ldexp(1.0, layout.bitLength) - 1.0;
+  }
+  if (rounded < minRaw)
+    rounded = minRaw;
+  if (rounded > maxRaw)
+    rounded = maxRaw;
+
+  uint64_t raw = layout.isSigned ? (uint64_t)(int64_t)rounded
+                                 : (uint64_t)rounded;
+  insertBits(data, dataLen, layout.startBit, layout.bitLength,
+             layout.bigEndian, raw);
+}
+
+TxScheduler::TxScheduler() { clear(); }
+
+void TxScheduler::clear() {
+  for (Slot &slot : slots_) {
+    slot.active = false;
+  }
+  heapSize_ = 0;
+}
+
+void TxScheduler::clearOwner(uint8_t owner) {
+  for (size_t i = 0; i < TX_SCHEDULER_CAPACITY; i++) {
+    if (slots_[i].active && slots_[i].owner == owner)
+      remove(i);
+  }
+}
+
+bool TxScheduler::before(uint8_t a, uint8_t b) const {
+  const Slot &sa = slots_[a];
+  const Slot &sb = slots_[b];
+  int32_t diff = (int32_t)(sa.dueMs - sb.dueMs);
+  if (diff != 0)
+    return diff < 0;
+  return sa.priority < sb.priority;
+}
+
+void TxScheduler::heapSwap(size_t i, size_t j) {
+  uint8_t tmp = heap_[i];
+  heap_[i] = heap_[j];
+  heap_[j] = tmp;
+  heapPos_[heap_[i]] = i;
+  heapPos_[heap_[j]] = j;
+}
+
+void TxScheduler::siftUp(size_t i) {
+  while (i > 0) {
+    size_t parent = (i - 1) / 2;
+    if (!before(heap_[i], heap_[parent]))
+      break;
+    heapSwap(i, parent);
+    i = parent;
+  }
+}
+
+void TxScheduler::siftDown(size_t i) {
+  while (true) {
+    size_t left = 2 * i + 1;
+    size_t right = left + 1;
+    size_t best = i;
+    if (left < heapSize_ && before(heap_[left], heap_[best]))
+      best = left;
+    if (right < heapSize_ && before(heap_[right], heap_[best]))
+      best = right;
+    if (best == i)
+      break;
+    heapSwap(i, best);
+    i = best;
+  }
+}
+
+void TxScheduler::heapRemove(size_t i) {
+  heapSize_--;
+  if (i == heapSize_)
+    return;
+  heapSwap(i, heapSize_);
+  siftDown(i);
+  siftUp(i);
+}
+
+int TxScheduler::allocate(const CanFrame &frame, uint32_t periodMs,
+                          uint8_t priority, uint8_t owner, uint32_t dueMs) {
+  for (size_t i = 0; i < TX_SCHEDULER_CAPACITY; i++) {
+    Slot &slot = slots_[i];
+    if (slot.active)
+      continue;
+
+    slot.frame = frame;
+    slot.periodMs = periodMs;
+    slot.dueMs = dueMs;
+    slot.priority = priority;
+    slot.owner = owner;
+    slot.active = true;
+
+    heap_[heapSize_] = i;
+    heapPos_[i] = heapSize_;
+    heapSize_++;
+    siftUp(heapSize_ - 1);
+    return i;
+  }
+
+  stats_.rejected++;
+  return -1;
+}
+
+int TxScheduler::findPeriodic(uint32_t canId, bool extended) const {
+  for (size_t i = 0; i < TX_SCHEDULER_CAPACITY; i++) {
+    const Slot &slot = slots_[i];
+    if (slot.active && slot.periodMs > 0 && slot.frame.id == canId &&
+        slot.frame.extended == extended)
+      return i;
+  }
+  return -1;
+}
+
+int TxScheduler::schedulePeriodic(const CanFrame &frame, uint32_t periodMs,
+                                  uint8_t priority, uint8_t owner) {
+  if (periodMs == 0)
+    return -1;
+
+  int idx = findPeriodic(frame.id, frame.extended);
+  if (idx >= 0) {
+    // Update in place, keep phase
+    Slot &slot = slots_[idx];
+    slot.frame = frame;
+    slot.periodMs = periodMs;
+    slot.priority = priority;
+    siftDown(heapPos_[idx]);
+    siftUp(heapPos_[idx]);
+    return idx;
+  }
+
+  return allocate(frame, periodMs, priority, owner, millis());
+}
+
+int TxScheduler::sendOnce(const CanFrame &frame, uint8_t priority,
+                          uint8_t owner) {
+  return allocate(frame, 0, priority, owner, millis());
+}
+
+void TxScheduler::remove(int slot) {
+  if (slot < 0 || slot >= TX_SCHEDULER_CAPACITY || !slots_[slot].active)
+    return;
+  slots_[slot].active = false;
+  heapRemove(heapPos_[slot]);
+}
+
+bool TxScheduler::writeSignal(int slot, const RuntimeSignal &layout,
+                              float value) {
+  if (slot < 0 || slot >= TX_SCHEDULER_CAPACITY || !slots_[slot].active)
+    return false;
+  encodeSignal(layout, value, slots_[slot].frame.data,
+               sizeof(slots_[slot].frame.data));
+  return true;
+}
+
+void TxScheduler::service(CAN &bus, uint32_t nowMs) {
+  for (int sent = 0; sent < TX_SCHEDULER_MAX_PER_SERVICE && heapSize_ > 0;
+       sent++) {
+    uint8_t idx = heap_[0];
+    Slot &slot = slots_[idx];
+
+    int32_t lateness = (int32_t)(nowMs - slot.dueMs);
+    if (lateness < 0)
+      return;
+
+    if (!bus.tryTransmit(slot.frame)) {
+      // Controller queue full - retry next loop, keep deadline order
+      stats_.deferred++;
+      return;
+    }
+
+    stats_.sent++;
+    stats_.totalLatenessMs += lateness;
+    if ((uint32_t)lateness > stats_.maxLatenessMs)
+      stats_.maxLatenessMs = lateness;
+
+    if (slot.periodMs == 0) {
+      slot.active = false;
+      heapRemove(0);
+      continue;
+    }
+
+    // Advance on the original grid; resync if more than a period behind
+    slot.dueMs += slot.periodMs;
+    if ((int32_t)(nowMs - slot.dueMs) >= (int32_t)slot.periodMs)
+      slot.dueMs = nowMs + slot.periodMs;
+    siftDown(0);
+  }
+}
+
+} // namespace W4RP
@@ -0,0 +1,137 @@
+/**
+ * @file TxScheduler.h
+ * @brief CORE:TxScheduler - Periodic and one-shot CAN transmit table
+ * @version 1.0.0
+ *
+ * Fixed-capacity frame table serviced from the main loop. Frames go out in
+ * deadline order (priority breaks ties) using CAN::tryTransmit, so a full
+ * TX queue defers frames instead of blocking.
+ */
+#pragma once
+#include "../interfaces/CAN.h"
+#include "Types.h"
+
+namespace W4RP {
+
+#define TX_SCHEDULER_CAPACITY 16
+#define TX_SCHEDULER_MAX_PER_SERVICE 4
+
+// Slot owners; a ruleset load clears only TX_OWNER_RULES frames
+#define TX_OWNER_APP 0
+#define TX_OWNER_RULES 1
+
+/**
+ * @struct TxSchedulerStats
+ * @brief Transmit counters and jitter since reset
+ */
+struct TxSchedulerStats {
+  uint32_t sent = 0;
+  uint32_t deferred = 0;      // tryTransmit refused (queue full/bus off)
+  uint32_t rejected = 0;      // Table full
+  uint32_t maxLatenessMs = 0; // Worst transmit time past deadline
+  uint32_t totalLatenessMs = 0;
+};
+
+/**
+ * @class TxScheduler
+ * @brief Deadline-ordered CAN transmit scheduler
+ */
+class TxScheduler {
+public:
+  TxScheduler();
+
+  /**
+   * @brief Add or update a periodic frame (keyed by CAN ID)
+   * @param frame Frame to send
+   * @param periodMs Period in milliseconds (> 0)
+   * @param priority 0 = most urgent, used to order equal deadlines
+   * @param owner TX_OWNER_* (kept from the first caller on update)
+   * @return Slot index or -1 if table full
+   */
+  int schedulePeriodic(const CanFrame &frame, uint32_t periodMs,
+                       uint8_t priority = 0, uint8_t owner = TX_OWNER_APP);
+
+  /**
+   * @brief Queue a frame for a single transmission
+   * @param frame Frame to send
+   * @param priority 0 = most urgent
+   * @param owner TX_OWNER_*
+   * @return Slot index or -1 if table full
+   */
+  int sendOnce(const CanFrame &frame, uint8_t priority = 0,
+               uint8_t owner = TX_OWNER_APP);
+
+  /**
+   * @brief Remove frame from table
+   * @param slot Slot index
+   */
+  void remove(int slot);
+
+  /// @brief Remove all frames
+  void clear();
+
+  /// @brief Remove the frames of one owner
+  void clearOwner(uint8_t owner);
+
+  /**
+   * @brief Find periodic slot by CAN ID
+   * @return Slot index or -1
+   */
+  int findPeriodic(uint32_t canId, bool extended) const;
+
+  /**
+   * @brief Update a signal inside a scheduled frame's payload
+   * @param slot Slot index
+   * @param layout Signal layout (startBit, bitLength, endianness, scaling)
+   * @param value Physical value
+   * @return true if slot is active
+   */
+  bool writeSignal(int slot, const RuntimeSignal &layout, float value);
+
+  /**
+   * @brief Transmit due frames (bounded per call)
+   * @param bus CAN bus
+   * @param nowMs Current time
+   */
+  void service(CAN &bus, uint32_t nowMs);
+
+  size_t getActiveCount() const { return heapSize_; }
+  const TxSchedulerStats &getStats() const { return stats_; }
+  void resetStats() { stats_ = TxSchedulerStats(); }
+
+  /**
+   * @brief Write a physical value into a payload (inverse of decoding)
+   * @param layout Signal layout
+   * @param value Physical value, scaled and clamped to the bit width
+   * @param data Payload buffer
+   * @param dataLen Payload length
+   */
+  static void encodeSignal(const RuntimeSignal &layout, float value,
+                           uint8_t *data, size_t dataLen);
+
+private:
+  struct Slot {
+    CanFrame frame;
+    uint32_t periodMs; // 0 = one-shot
+    uint32_t dueMs;
+    uint8_t priority;
+    uint8_t owner;
+    bool active;
+  };
+
+  Slot slots_[TX_SCHEDULER_CAPACITY];
+  uint8_t heap_[TX_SCHEDULER_CAPACITY]; // Slot indices, earliest due on top
+  uint8_t heapPos_[TX_SCHEDULER_CAPACITY];
+  size_t heapSize_ = 0;
+  TxSchedulerStats stats_;
+
+  int allocate(const CanFrame &frame, uint32_t periodMs, uint8_t priority,
+               uint8_t owner, uint32_t dueMs);
+  bool before(uint8_t a, uint8_t b) const;
+  void heapSwap(size_t i, size_t j);
+  void siftUp(size_t i);
+  void siftDown(size_t i);
+  void heapRemove(size_t i);
+};
+
+} // namespace W4RP
@@ -0,0 +1,145 @@
+/**
+ * @file TypedCapability.h
+ * @brief CORE:TypedCapability - Typed capability handler adapters
+ * @version 1.0.0
+ *
+ * Adapts handlers such as [](int state, float duty) {...} to the Engine.
+ * The CapabilityMeta parameter list is generated from the signature and a
+ * thunk unpacks RuntimeParams straight into the arguments. Parameter types
+ * are checked once when a ruleset loads, not on every call.
+ */
+#pragma once
+#include "Types.h"
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace W4RP {
+
+/**
+ * @struct CapabilityArg
+ * @brief Mapping of a handler argument type to WBP parameters
+ * Specialized for int, float, bool and String.
+ */
+template <typename T> struct CapabilityArg;
+
+template <> struct CapabilityArg<int> {
+  static constexpr ParamType type = ParamType::INT;
+  static constexpr const char *name = "int";
+  static int get(const RuntimeParam &p) { return p.intVal; }
+  static int parse(const String &s) { return s.toInt(); }
+};
+
+template <> struct CapabilityArg<float> {
+  static constexpr ParamType type = ParamType::FLOAT;
+  static constexpr const char *name = "float";
+  static float get(const RuntimeParam &p) { return p.floatVal; }
+  static float parse(const String &s) { return s.toFloat(); }
+};
+
+template <> struct CapabilityArg<bool> {
+  static constexpr ParamType type = ParamType::BOOL;
+  static constexpr const char *name = "bool";
+  static bool get(const RuntimeParam &p) { return p.intVal != 0; }
+  static bool parse(const String &s) { return s.toInt() != 0; }
+};
+
+template <> struct CapabilityArg<String> {
+  static constexpr ParamType type = ParamType::STRING;
+  static constexpr const char *name = "string";
+  static const String &get(const RuntimeParam &p) { return p.strVal; }
+  static String parse(const String &s) { return s; }
+};
+
+template <typename T> using CapabilityArgOf = CapabilityArg<std::decay_t<T>>;
+
+using TypedCapabilityHandler =
+    std::function<void(const std::vector<RuntimeParam> &)>;
+
+/**
+ * @struct TypedCapability
+ * @brief Thunk of a typed handler and the parameter types it accepts
+ */
+struct TypedCapability {
+  TypedCapabilityHandler invoke;
+  std::vector<ParamType> signature;
+
+  /// @brief Check ruleset parameters against the signature (load time)
+  bool matches(const std::vector<RuntimeParam> &params) const {
+    if (params.size() != signature.size())
+      return false;
+    for (size_t i = 0; i < params.size(); i++) {
+      if (params[i].type != signature[i])
+        return false;
+    }
+    return true;
+  }
+};
+
+namespace detail {
+
+inline String paramAt(const ParamMap &params, size_t i) {
+  char key[8];
+  snprintf(key, sizeof(key), "p%d", (int)i);
+  auto it = params.find(key);
+  return it == params.end() ? String() : it->second;
+}
+
+template <typename... Args, typename F, size_t... I>
+void invokeTyped(F &handler, const std::vector<RuntimeParam> &params,
+                 std::index_sequence<I...>) {
+  handler(CapabilityArgOf<Args>::get(params[I])...);
+}
+
+template <typename... Args, typename F, size_t... I>
+void invokeParsed(F &handler, const ParamMap &params,
+                  std::index_sequence<I...>) {
+  handler(CapabilityArgOf<Args>::parse(paramAt(params, I))...);
+}
+
+} // namespace detail
+
+/**
+ * @brief Set parameter types of meta from a handler signature
+ * Names and ranges already in meta.params are kept; missing entries are
+ * named p0, p1, ...
+ */
+template <typename... Args> void describeTypedParams(CapabilityMeta &meta) {
+  const char *types[] = {CapabilityArgOf<Args>::name...};
+  meta.params.resize(sizeof...(Args));
+  for (size_t i = 0; i < sizeof...(Args); i++) {
+    CapabilityParamMeta &param = meta.params[i];
+    param.type = types[i];
+    if (param.name.isEmpty())
+      param.name = String("p") + String((int)i);
+  }
+}
+
+/**
+ * @brief Build the thunk of a typed handler
+ * @tparam Args Handler argument types
+ */
+template <typename... Args, typename F>
+TypedCapability makeTypedCapability(F handler) {
+  TypedCapability typed;
+  typed.signature = {CapabilityArgOf<Args>::type...};
+  typed.invoke = [handler](const std::vector<RuntimeParam> &params) mutable {
+    detail::invokeTyped<Args...>(handler, params,
+                                 std::index_sequence_for<Args...>());
+  };
+  return typed;
+}
+
+/**
+ * @brief Wrap a typed handler as a ParamMap handler (async worker path)
+ * @tparam Args Handler argument types
+ */
+template <typename... Args, typename F>
+CapabilityHandler makeParsedCapability(F handler) {
+  return [handler](const ParamMap &params) mutable {
+    detail::invokeParsed<Args...>(handler, params,
+                                  std::index_sequence_for<Args...>());
+  };
+}
+
+} // namespace W4RP
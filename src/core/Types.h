@@ -18,8 +18,44 @@ namespace W4RP {
 #define WBP_MAGIC_RULES 0xC0DE5702
 #define WBP_VERSION 0x02
 #define WBP_MIN_VERSION 0x02
+#define WBP_VERSION_V3 0x03 // Sectioned rules layout, see WBPRulesHeaderV3
 #define WBP_FLAG_HAS_META 0x01
 #define WBP_FLAG_PERSIST 0x02
+#define WBP_FLAG_HAS_EXT 0x04
+#define WBP_MAX_CONDITIONS 32 // Condition results are one 32-bit bitmap
+
+#define WBP_SIG_FLAG_BIG_ENDIAN 0x01
+#define WBP_SIG_FLAG_SIGNED 0x02
+#define WBP_SIG_FLAG_J1939 0x04
+
+// Condition operation byte: compare against WBPCondition::signalIdx2
+#define WBP_COND_FLAG_SIGNAL_OPERAND 0x80
+
+#define WBP_EXT_SIGNAL_MASKS 0x01
+#define WBP_EXT_SIGNAL_MUX 0x02
+#define WBP_EXT_DIAG_POLLS 0x03
+#define WBP_EXT_SIGNAL_LOG 0x04
+#define WBP_EXT_DERIVED 0x05
+#define WBP_EXT_SIGNAL_TIMEOUTS 0x06
+#define WBP_EXT_STATE_MACHINE 0x07
+#define WBP_EXT_RULE_PRIORITY 0x08
+#define WBP_EXT_ACTION_STEPS 0x09
+
+// WBP v3 section types; extensions keep their WBP_EXT_* values
+#define WBP_SEC_META 0x40
+#define WBP_SEC_SIGNALS 0x41
+#define WBP_SEC_CONDITIONS 0x42
+#define WBP_SEC_ACTIONS 0x43
+#define WBP_SEC_ACTION_PARAMS 0x44
+#define WBP_SEC_RULES 0x45
+#define WBP_SEC_STRINGS 0x46
+#define WBP_SEC_ALIGN 4 // Section offset alignment
+
+#define WBP_POLL_FLAG_EXTENDED 0x01
+
+#define CAN_ID_MASK_EXACT 0xFFFFFFFF
+#define J1939_PGN_MASK_PDU1 0x03FF0000 // PS field is destination address
+#define J1939_PGN_MASK_PDU2 0x03FFFF00 // PS field is group extension
 
 /**
  * @enum Operation
@@ -34,7 +70,72 @@ enum class Operation : uint8_t {
   LE = 5,
   WITHIN = 6,
   OUTSIDE = 7,
-  HOLD = 8
+  HOLD = 8,
+  // Window aggregates: aggregate(signal, value2 ms) <compare> value1
+  AVG = 9,
+  MIN = 10,
+  MAX = 11,
+  STDDEV = 12,
+  // Stateful: evaluated once per cycle against the previous evaluation
+  HYSTERESIS = 13, // On crossing value1, off crossing value2
+  RISING = 14,     // Crossed above value1 since last cycle
+  FALLING = 15,    // Crossed below value1 since last cycle
+  CHANGED = 16,    // Moved more than value1 since last cycle
+  STALE = 17       // No update for value1 ms
+};
+
+/// @brief AVG..STDDEV (backed by a WindowAggregate)
+inline bool isWindowOp(Operation op) {
+  return op >= Operation::AVG && op <= Operation::STDDEV;
+}
+
+/**
+ * @enum DerivedOp
+ * @brief Derived signal node types
+ */
+enum class DerivedOp : uint8_t {
+  ADD = 0,       // a + b
+  SUB = 1,       // a - b
+  MUL = 2,       // a * b
+  DIV = 3,       // a / b (held while b == 0)
+  SCALE = 4,     // a * param
+  EMA = 5,       // Exponential moving average, alpha = param
+  LOWPASS = 6,   // First-order low-pass, time constant = param ms
+  DERIVATIVE = 7 // da/dt per second
+};
+
+/**
+ * @enum ActionStepKind
+ * @brief Timed step of an action sequence
+ */
+enum class ActionStepKind : uint8_t {
+  CALL = 0, // Invoke step action once
+  RAMP = 1  // Invoke step action every intervalMs, sweeping one param
+};
+
+/**
+ * @enum NativeKind
+ * @brief Built-in output run by the Engine without a handler
+ */
+enum class NativeKind : uint8_t {
+  NONE = 0,
+  GPIO_SET = 1,   // pin, level
+  GPIO_PULSE = 2, // pin, level, widthMs
+  PWM_DUTY = 3    // pin, duty (0-255)
+};
+
+/**
+ * @enum DecodeLayout
+ * @brief Signal bit layout class, resolved at load to pick a decoder
+ */
+enum class DecodeLayout : uint8_t {
+  GENERIC = 0, // Bit loop (any start, length, order)
+  U8 = 1,      // Whole bytes from firstByte, unsigned / signed
+  S8 = 2,
+  U16 = 3,
+  S16 = 4,
+  U32 = 5,
+  S32 = 6
 };
 
 /**
@@ -48,18 +149,35 @@ enum class ParamType : uint8_t { INT = 0, FLOAT = 1, STRING = 2, BOOL = 3 };
  * @brief CAN signal definition + runtime state
  */
 struct RuntimeSignal {
-  uint32_t canId;
+  // Runtime state; conditions read the value from Engine's operand array
+  float value = 0.0f;
+  float lastValue = 0.0f;
+  uint32_t lastUpdateMs = 0;
+  bool everSet = false;
+  bool timedOut = false;            // timeoutMs elapsed without an update
+  bool derived = false;             // Computed from other signals, not decoded
+  int16_t firstWindow = -1;         // Head of window aggregates fed by signal
+  uint32_t dependentConditions = 0; // Conditions reading this signal (bits)
+  uint8_t expiredWatches = 0;       // Stale watches awaiting an update
+  int16_t firstWatch = -1;          // Head of stale watches on this signal
+
+  uint32_t canId;                       // Match code (already masked)
+  uint32_t canMask = CAN_ID_MASK_EXACT; // Match if (id & canMask) == canId
+  bool extendedOnly = false;            // Ignore 11-bit frames (J1939)
   uint16_t startBit;
   uint8_t bitLength;
   bool bigEndian;
   bool isSigned;
   float factor;
   float offset;
-  float value = 0.0f;
-  float lastValue = 0.0f;
   float lastDebugValue = -999999.9f;
-  uint32_t lastUpdateMs = 0;
-  bool everSet = false;
+  bool multiplexed = false; // Only decoded when mux signal == muxValue
+  uint16_t muxSignalIdx = 0;
+  uint16_t muxValue = 0;
+  bool polled = false;    // Decoded from a diagnostic response, not broadcast
+  uint32_t timeoutMs = 0; // Invalidate after this long without update
+  DecodeLayout layout = DecodeLayout::GENERIC; // Set by Engine at load
+  uint16_t firstByte = 0; // Aligned layouts: lowest byte of the field
 };
 
 /**
@@ -67,12 +185,21 @@ struct RuntimeSignal {
  * @brief Condition definition + hold state
  */
 struct RuntimeCondition {
-  uint8_t signalIdx;
+  uint16_t signalIdx;
   Operation operation;
+  bool signalOperand = false; // EQ..LE against signalIdx2 + value1
+  uint16_t signalIdx2 = 0;
   float value1;
   float value2;
-  uint32_t holdMs = 0;
+  uint32_t holdMs = 0; // HOLD / STALE duration
   uint32_t holdStartMs = 0;
+  Operation compare = Operation::GT; // Window ops: comparison with value1
+  uint32_t windowMs = 0;
+  uint16_t windowIdx = 0;
+  uint16_t watchIdx = 0; // STALE: Engine stale watch
+  float prevValue = 0.0f; // Signal value at previous evaluation
+  bool hasPrev = false;
+  bool latched = false; // HYSTERESIS output
   bool holdActive = false;
   bool lastResult = false;
 };
@@ -97,6 +224,9 @@ struct RuntimeParam {
 struct RuntimeAction {
   String capabilityId;
   std::vector<RuntimeParam> params;
+  uint8_t capSlot = 0;    // Dense per-ruleset capability index (set by Engine)
+  uint32_t paramHash = 0; // Hash of typed params (set by Engine)
+  NativeKind native = NativeKind::NONE; // Resolved at load (set by Engine)
 };
 
 /**
@@ -105,15 +235,141 @@ struct RuntimeAction {
  */
 struct RuntimeRule {
   uint32_t conditionMask;
-  uint8_t actionStartIdx;
-  uint8_t actionCount;
+  uint16_t actionStartIdx;
+  uint16_t actionCount;
   uint16_t debounceMs;
   uint16_t cooldownMs;
+  uint8_t priority = 0; // Higher wins when rules drive the same capability
   uint32_t lastTriggerMs = 0;
   uint32_t lastConditionChangeMs = 0;
   bool lastConditionState = false;
 };
 
+/**
+ * @struct RuntimeDiagPoll
+ * @brief Periodic OBD-II/UDS request + scheduling state
+ *
+ * Signals [signalStartIdx, signalStartIdx + signalCount) are decoded from
+ * the positive response payload, after the echoed service and PID/DID.
+ */
+struct RuntimeDiagPoll {
+  uint32_t requestId;
+  uint32_t responseId;
+  bool extended;
+  uint8_t service;     // 0x01 (OBD-II PID), 0x22 (UDS ReadDataByIdentifier)
+  uint16_t identifier; // PID or DID
+  uint16_t periodMs;
+  uint16_t signalStartIdx;
+  uint16_t signalCount;
+  uint32_t lastRequestMs = 0;
+  bool everRequested = false;
+};
+
+/**
+ * @struct RuntimeDerived
+ * @brief Derived signal node + filter state
+ */
+struct RuntimeDerived {
+  uint16_t signalIdx; // Output signal
+  DerivedOp op;
+  uint16_t inputA;
+  uint16_t inputB; // Binary ops only
+  float param;
+  float prevInput = 0.0f;
+  uint32_t prevMs = 0;
+  bool primed = false;
+  bool dirty = false;
+};
+
+/**
+ * @struct RuntimeLogTrack
+ * @brief Signal sampled into on-device history
+ */
+struct RuntimeLogTrack {
+  uint16_t signalIdx;
+  uint16_t periodMs;
+};
+
+/**
+ * @struct RuntimeActionStep
+ * @brief Step scheduled when its owner action runs
+ */
+struct RuntimeActionStep {
+  uint16_t ownerAction; // Action that starts the sequence
+  uint16_t stepAction;  // Action invoked by this step
+  ActionStepKind kind;
+  uint8_t paramIdx;     // RAMP: parameter replaced by the ramp value
+  uint32_t delayMs;     // From sequence start
+  uint16_t durationMs;  // RAMP length
+  uint16_t intervalMs;  // RAMP call period
+  float from;           // RAMP start value
+  float to;             // RAMP end value
+};
+
+/**
+ * @struct RuntimeStaleWatch
+ * @brief Silence timer for one signal (signal timeout or STALE condition)
+ */
+struct RuntimeStaleWatch {
+  uint16_t signalIdx;
+  uint32_t timeoutMs;
+  int16_t conditionIdx = -1; // -1 = signal timeout
+  int16_t nextForSignal = -1;
+  bool expired = false;
+};
+
+/**
+ * @struct RuntimeTransition
+ * @brief State machine edge: taken once its conditions hold and the machine
+ * has been in fromState for timeoutMs
+ */
+struct RuntimeTransition {
+  uint8_t toState;
+  uint16_t actionStartIdx;
+  uint16_t actionCount;
+  uint32_t conditionMask; // AND of conditions (0 = timeout only)
+  uint32_t timeoutMs;     // Minimum time in the source state (0 = none)
+};
+
+/**
+ * @struct RuntimeMachineState
+ * @brief Outgoing transitions of one state (contiguous, in WBP order)
+ */
+struct RuntimeMachineState {
+  uint16_t firstTransition;
+  uint16_t transitionCount;
+  uint32_t conditionMask; // Union of outgoing transition masks
+  uint32_t minTimeoutMs;  // Shortest timed transition (0 = none)
+};
+
+/**
+ * @struct RuntimeStateMachine
+ * @brief Sequence rule; states and transitions live in Engine tables
+ */
+struct RuntimeStateMachine {
+  uint16_t firstState; // Index of state 0 in the machine state table
+  uint8_t stateCount;
+  uint8_t initialState;
+  uint8_t state = 0;
+  uint32_t enteredMs = 0;
+  bool pending = true;      // Just entered a state, check all transitions
+  uint32_t transitions = 0; // Transitions taken since load
+};
+
+/**
+ * @struct RuntimeExtensions
+ * @brief Optional ruleset sections parsed from WBP extensions
+ */
+struct RuntimeExtensions {
+  std::vector<RuntimeDiagPoll> diagPolls;
+  std::vector<RuntimeLogTrack> logTracks;
+  std::vector<RuntimeDerived> derived; // Topologically sorted
+  std::vector<RuntimeStateMachine> machines;
+  std::vector<RuntimeMachineState> machineStates;
+  std::vector<RuntimeTransition> transitions;
+  std::vector<RuntimeActionStep> actionSteps; // Grouped by owner action
+};
+
 /**
  * @struct CapabilityParamMeta
  * @brief Parameter metadata for profile
@@ -137,6 +393,12 @@ struct CapabilityMeta {
   String description;
   String category;
   std::vector<CapabilityParamMeta> params;
+  bool coalesce = true;        // One call per cycle, highest priority wins
+  bool statefulOutput = false; // Skip calls repeating the last parameters
+  bool async = false;          // Run on the capability worker task
+  uint32_t budgetMs = 0;       // Async execution budget (0 = default)
+  int8_t asyncSlot = -1;       // Set by Engine on registration
+  NativeKind native = NativeKind::NONE; // Built-in output (no handler)
 };
 
 using ParamMap = std::map<String, String>;
@@ -0,0 +1,170 @@
+/**
+ * @file WindowAggregate.cpp
+ * @brief CORE:WindowAggregate - Sliding window implementation
+ */
+
+#include "WindowAggregate.h"
+#include <cmath>
+#include <cstring>
+
+namespace W4RP {
+
+void WindowAggregate::init(WindowBucket *buckets, uint32_t windowMs) {
+  buckets_ = buckets;
+  bucketMs_ = (windowMs + WINDOW_BUCKETS - 1) / WINDOW_BUCKETS;
+  if (bucketMs_ == 0)
+    bucketMs_ = 1;
+  started_ = false;
+  hasShift_ = false;
+  reset();
+}
+
+void WindowAggregate::reset() {
+  memset(buckets_, 0, WINDOW_BUCKETS * sizeof(WindowBucket));
+  sum_ = 0.0f;
+  sumSq_ = 0.0f;
+  count_ = 0;
+  sinceResync_ = 0;
+  minHead_ = minLen_ = 0;
+  maxHead_ = maxLen_ = 0;
+}
+
+void WindowAggregate::advance(uint32_t nowMs) {
+  uint32_t slot = nowMs / bucketMs_;
+  if (!started_) {
+    curSlot_ = slot;
+    started_ = true;
+    return;
+  }
+
+  uint32_t elapsed = slot - curSlot_;
+  if (elapsed == 0)
+    return;
+
+  // Whole window expired (or millis() wrapped)
+  if (elapsed >= WINDOW_BUCKETS) {
+    reset();
+    curSlot_ = slot;
+    return;
+  }
+
+  while (elapsed--)
+    step();
+}
+
+void WindowAggregate::step() {
+  // Close current bucket into running sums and deques
+  uint8_t pos = curSlot_ % WINDOW_BUCKETS;
+  const WindowBucket &cur = buckets_[pos];
+  if (cur.count > 0) {
+    sum_ += cur.sum;
+    sumSq_ += cur.sumSq;
+    count_ += cur.count;
+
+    while (minLen_ > 0 &&
+           buckets_[minQ_[(minHead_ + minLen_ - 1) % WINDOW_BUCKETS]].min >=
+               cur.min)
+      minLen_--;
+    minQ_[(minHead_ + minLen_++) % WINDOW_BUCKETS] = pos;
+
+    while (maxLen_ > 0 &&
+           buckets_[maxQ_[(maxHead_ + maxLen_ - 1) % WINDOW_BUCKETS]].max <=
+               cur.max)
+      maxLen_--;
+    maxQ_[(maxHead_ + maxLen_++) % WINDOW_BUCKETS] = pos;
+  }
+
+  // Reuse the oldest position, dropping it from the window
+  curSlot_++;
+  uint8_t next = curSlot_ % WINDOW_BUCKETS;
+  WindowBucket &old = buckets_[next];
+  if (old.count > 0) {
+    sum_ -= old.sum;
+    sumSq_ -= old.sumSq;
+    count_ -= old.count;
+    if (minLen_ > 0 && minQ_[minHead_] == next) {
+      minHead_ = (minHead_ + 1) % WINDOW_BUCKETS;
+      minLen_--;
+    }
+    if (maxLen_ > 0 && maxQ_[maxHead_] == next) {
+      maxHead_ = (maxHead_ + 1) % WINDOW_BUCKETS;
+      maxLen_--;
+    }
+  }
+  memset(&old, 0, sizeof(old));
+
+  // Recompute sums once per window span to cancel add/subtract drift
+  if (++sinceResync_ >= WINDOW_BUCKETS)
+    resync();
+}
+
+void WindowAggregate::resync() {
+  uint8_t cur = curSlot_ % WINDOW_BUCKETS;
+  sum_ = 0.0f;
+  sumSq_ = 0.0f;
+  for (uint8_t i = 0; i < WINDOW_BUCKETS; i++) {
+    if (i == cur)
+      continue;
+    sum_ += buckets_[i].sum;
+    sumSq_ += buckets_[i].sumSq;
+  }
+  sinceResync_ = 0;
+}
+
+void WindowAggregate::add(uint32_t nowMs, float value) {
+  advance(nowMs);
+
+  if (!hasShift_) {
+    shift_ = value;
+    hasShift_ = true;
+  }
+
+  WindowBucket &b = buckets_[curSlot_ % WINDOW_BUCKETS];
+  if (b.count == 0) {
+    b.min = value;
+    b.max = value;
+  } else {
+    if (value < b.min)
+      b.min = value;
+    if (value > b.max)
+      b.max = value;
+  }
+
+  float d = value - shift_;
+  b.sum += d;
+  b.sumSq += d * d;
+  b.count++;
+}
+
+bool WindowAggregate::get(Operation op, float &out) const {
+  const WindowBucket &cur = buckets_[curSlot_ % WINDOW_BUCKETS];
+  uint32_t n = count_ + cur.count;
+  if (n == 0)
+    return false;
+
+  switch (op) {
+  case Operation::MIN:
+    out = cur.count ? cur.min : INFINITY;
+    if (minLen_ > 0 && buckets_[minQ_[minHead_]].min < out)
+      out = buckets_[minQ_[minHead_]].min;
+    return true;
+  case Operation::MAX:
+    out = cur.count ? cur.max : -INFINITY;
+    if (maxLen_ > 0 && buckets_[maxQ_[maxHead_]].max > out)
+      out = buckets_[maxQ_[maxHead_]].max;
+    return true;
+  case Operation::AVG:
+    out = (sum_ + cur.sum) / n + shift_;
+    return true;
+  case Operation::STDDEV: {
+    float mean = (sum_ + cur.sum) / n;
+    float var = (sumSq_ + cur.sumSq) / n - mean * mean;
+    out = var > 0.0f ? sqrtf(var) : 0.0f;
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+} // namespace W4RP
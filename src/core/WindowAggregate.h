@@ -0,0 +1,95 @@
+/**
+ * @file WindowAggregate.h
+ * @brief CORE:WindowAggregate - Sliding time-window min/max/avg/stddev
+ * @version 1.0.0
+ *
+ * The window is split into WINDOW_BUCKETS time buckets. Each sample updates
+ * the current bucket; closed buckets feed running sums (mean, variance) and
+ * monotonic deques (min, max), so both update and query are O(1) amortized.
+ * Bucket storage is borrowed from the Engine's per-ruleset arena.
+ */
+#pragma once
+#include "Types.h"
+
+namespace W4RP {
+
+#define WINDOW_BUCKETS 16
+#define WINDOW_MAX_MS 3600000
+
+/**
+ * @struct WindowBucket
+ * @brief Aggregate of samples in one bucket (sums are shifted, see add())
+ */
+struct WindowBucket {
+  float min;
+  float max;
+  float sum;
+  float sumSq;
+  uint32_t count;
+};
+
+/**
+ * @class WindowAggregate
+ * @brief Time-bucketed sliding window over one signal
+ *
+ * Covers the current bucket plus the previous WINDOW_BUCKETS - 1, so the
+ * effective span is windowMs minus up to one bucket.
+ */
+class WindowAggregate {
+public:
+  /**
+   * @brief Attach storage and set span
+   * @param buckets WINDOW_BUCKETS entries from the arena
+   * @param windowMs Window length
+   */
+  void init(WindowBucket *buckets, uint32_t windowMs);
+
+  /**
+   * @brief Add sample (advances window first)
+   * @param nowMs Sample time
+   * @param value Signal value
+   */
+  void add(uint32_t nowMs, float value);
+
+  /// @brief Expire buckets that left the window
+  void advance(uint32_t nowMs);
+
+  /**
+   * @brief Read aggregate
+   * @param op Operation::AVG, MIN, MAX or STDDEV
+   * @param out Result
+   * @return false if the window holds no samples
+   */
+  bool get(Operation op, float &out) const;
+
+  /// @brief Next window on the same signal (-1 = end)
+  int16_t nextForSignal = -1;
+
+private:
+  WindowBucket *buckets_ = nullptr;
+  uint32_t bucketMs_ = 1;
+  uint32_t curSlot_ = 0;
+  bool started_ = false;
+
+  // Sums are taken over (value - shift_) to limit float cancellation
+  float shift_ = 0.0f;
+  bool hasShift_ = false;
+
+  // Closed buckets still inside the window
+  float sum_ = 0.0f;
+  float sumSq_ = 0.0f;
+  uint32_t count_ = 0;
+  uint8_t sinceResync_ = 0;
+
+  // Monotonic deques of bucket positions (ring, oldest at head)
+  uint8_t minQ_[WINDOW_BUCKETS];
+  uint8_t maxQ_[WINDOW_BUCKETS];
+  uint8_t minHead_ = 0, minLen_ = 0;
+  uint8_t maxHead_ = 0, maxLen_ = 0;
+
+  void reset();
+  void step();
+  void resync();
+};
+
+} // namespace W4RP
@@ -10,7 +10,8 @@ static const char *TAG = "NVSStorage";
 
 namespace W4RP {
 
-NVSStorage::NVSStorage(const char *ns) : namespace_(ns) {}
+NVSStorage::NVSStorage(const char *ns, const char *partition)
+    : namespace_(ns), partition_(partition) {}
 
 NVSStorage::~NVSStorage() {
   if (opened_) {
@@ -24,12 +25,18 @@ bool NVSStorage::begin() {
     return true;
 
   // Initialize NVS
-  esp_err_t err = nvs_flash_init();
+  esp_err_t err =
+      partition_ ? nvs_flash_init_partition(partition_) : nvs_flash_init();
   if (err == ESP_ERR_NVS_NO_FREE_PAGES ||
       err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
     ESP_LOGW(TAG, "NVS partition truncated, erasing");
-    nvs_flash_erase();
-    err = nvs_flash_init();
+    if (partition_) {
+      nvs_flash_erase_partition(partition_);
+      err = nvs_flash_init_partition(partition_);
+    } else {
+      nvs_flash_erase();
+      err = nvs_flash_init();
+    }
   }
 
   if (err != ESP_OK) {
@@ -37,7 +44,9 @@ bool NVSStorage::begin() {
     return false;
   }
 
-  err = nvs_open(namespace_, NVS_READWRITE, &handle_);
+  err = partition_ ? nvs_open_from_partition(partition_, namespace_,
+                                             NVS_READWRITE, &handle_)
+                   : nvs_open(namespace_, NVS_READWRITE, &handle_);
   if (err != ESP_OK) {
     ESP_LOGE(TAG, "Failed to open NVS namespace '%s': %s", namespace_,
              esp_err_to_name(err));
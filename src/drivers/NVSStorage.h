@@ -22,8 +22,11 @@ public:
   /**
    * @brief Construct with namespace
    * @param ns NVS namespace (default: "w4rp")
+   * @param partition NVS data partition label (nullptr = default "nvs"),
+   * e.g. a dedicated partition for signal history
    */
-  explicit NVSStorage(const char *ns = "w4rp");
+  explicit NVSStorage(const char *ns = "w4rp",
+                      const char *partition = nullptr);
   ~NVSStorage();
 
   /**
@@ -80,6 +83,7 @@ public:
 
 private:
   const char *namespace_;
+  const char *partition_;
   nvs_handle_t handle_ = 0;
   bool opened_ = false;
 };
@@ -18,6 +18,7 @@ namespace {
 constexpr uint32_t DEFAULT_RX_QUEUE_LEN = 64;
 constexpr uint32_t DEFAULT_TX_QUEUE_LEN = 16;
 constexpr TickType_t DEFAULT_TX_TIMEOUT_MS = 100;
+constexpr uint32_t RECOVERY_HOLDOFF_MS = 100;
 } // namespace
 
 TWAICanBus::TWAICanBus(gpio_num_t txPin, gpio_num_t rxPin,
@@ -45,9 +46,10 @@ bool TWAICanBus::begin(uint32_t rxQueueLen, uint32_t txQueueLen) {
       TWAI_GENERAL_CONFIG_DEFAULT(txPin_, rxPin_, mode_);
   generalConfig.rx_queue_len = rxQueueLen;
   generalConfig.tx_queue_len = txQueueLen;
-  generalConfig.alerts_enabled = TWAI_ALERT_TX_IDLE | TWAI_ALERT_TX_SUCCESS |
-                                 TWAI_ALERT_TX_FAILED | TWAI_ALERT_ERR_PASS |
-                                 TWAI_ALERT_BUS_OFF | TWAI_ALERT_RX_QUEUE_FULL;
+  // Per-frame TX alerts are left off; only fault alerts are read in loop()
+  generalConfig.alerts_enabled = TWAI_ALERT_TX_FAILED | TWAI_ALERT_ERR_PASS |
+                                 TWAI_ALERT_BUS_OFF | TWAI_ALERT_BUS_RECOVERED |
+                                 TWAI_ALERT_RX_QUEUE_FULL;
 
   twai_filter_config_t filterConfig = TWAI_FILTER_CONFIG_ACCEPT_ALL();
 
@@ -71,6 +73,9 @@ bool TWAICanBus::begin(uint32_t rxQueueLen, uint32_t txQueueLen) {
   }
 
   running_ = true;
+  rxQueueLen_ = rxQueueLen;
+  txQueueLen_ = txQueueLen;
+  recovery_ = RecoveryState::NONE;
   ESP_LOGI(TAG, "Started on TX=GPIO%d, RX=GPIO%d", txPin_, rxPin_);
   return true;
 }
@@ -133,6 +138,14 @@ bool TWAICanBus::receive(CanFrame &frame) {
 }
 
 bool TWAICanBus::transmit(const CanFrame &frame) {
+  return queueFrame(frame, pdMS_TO_TICKS(DEFAULT_TX_TIMEOUT_MS));
+}
+
+bool TWAICanBus::tryTransmit(const CanFrame &frame) {
+  return queueFrame(frame, 0);
+}
+
+bool TWAICanBus::queueFrame(const CanFrame &frame, TickType_t timeout) {
   if (!running_) {
     return false;
   }
@@ -151,7 +164,7 @@ bool TWAICanBus::transmit(const CanFrame &frame) {
   const uint8_t copyLen = (frame.dlc > 8) ? 8 : frame.dlc;
   std::memcpy(msg.data, frame.data, copyLen);
 
-  return twai_transmit(&msg, pdMS_TO_TICKS(DEFAULT_TX_TIMEOUT_MS)) == ESP_OK;
+  return twai_transmit(&msg, timeout) == ESP_OK;
 }
 
 bool TWAICanBus::isRunning() const { return running_; }
@@ -200,10 +213,112 @@ bool TWAICanBus::recover() {
     return false;
   }
 
+  recovery_ = RecoveryState::RECOVERING;
   ESP_LOGI(TAG, "Bus recovery initiated");
   return true;
 }
 
+void TWAICanBus::loop() {
+  if (!installed_) {
+    return;
+  }
+
+  uint32_t alerts = 0;
+  if (twai_read_alerts(&alerts, 0) == ESP_OK) {
+    handleAlerts(alerts);
+  }
+
+  switch (recovery_) {
+  case RecoveryState::BUS_OFF:
+    // Hold off briefly so a persistent fault doesn't thrash the bus
+    if (autoRecovery_ && running_ &&
+        millis() - busOffMs_ >= RECOVERY_HOLDOFF_MS) {
+      if (!recover()) {
+        busOffMs_ = millis();
+      }
+    }
+    break;
+
+  case RecoveryState::RECOVERED:
+    // Recovery leaves the controller stopped
+    if (twai_start() == ESP_OK) {
+      stats_.recoveries++;
+      recovery_ = RecoveryState::NONE;
+      ESP_LOGI(TAG, "Bus recovered, restarted");
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  if (growPending_ && recovery_ == RecoveryState::NONE) {
+    growRxQueue();
+  }
+}
+
+void TWAICanBus::handleAlerts(uint32_t alerts) {
+  if (alerts & TWAI_ALERT_RX_QUEUE_FULL) {
+    stats_.rxQueueFull++;
+    if (maxRxQueueLen_ > rxQueueLen_) {
+      growPending_ = true;
+    }
+  }
+
+  if (alerts & TWAI_ALERT_ERR_PASS) {
+    stats_.errorPassive++;
+    ESP_LOGW(TAG, "Error passive");
+  }
+
+  if (alerts & TWAI_ALERT_TX_FAILED) {
+    stats_.txFailed++;
+  }
+
+  if (alerts & TWAI_ALERT_BUS_OFF) {
+    stats_.busOff++;
+    recovery_ = RecoveryState::BUS_OFF;
+    busOffMs_ = millis();
+    ESP_LOGW(TAG, "Bus off");
+  }
+
+  if (alerts & TWAI_ALERT_BUS_RECOVERED) {
+    recovery_ = RecoveryState::RECOVERED;
+  }
+}
+
+void TWAICanBus::growRxQueue() {
+  growPending_ = false;
+
+  uint32_t newLen = rxQueueLen_ * 2;
+  if (newLen > maxRxQueueLen_) {
+    newLen = maxRxQueueLen_;
+  }
+
+  // Reinstall resets driver counters - keep drops seen so far
+  twai_status_info_t status;
+  if (twai_get_status_info(&status) == ESP_OK) {
+    rxMissedBase_ += status.rx_missed_count;
+  }
+
+  uint32_t txLen = txQueueLen_;
+  cleanup();
+  if (begin(newLen, txLen)) {
+    ESP_LOGI(TAG, "RX queue grown to %lu", newLen);
+  }
+}
+
+CanBusStats TWAICanBus::getStats() const {
+  CanBusStats out = stats_;
+  out.rxQueueLen = rxQueueLen_;
+  out.rxDropped = rxMissedBase_;
+
+  twai_status_info_t status;
+  if (installed_ && twai_get_status_info(&status) == ESP_OK) {
+    out.rxDropped += status.rx_missed_count;
+  }
+  return out;
+}
+
 void TWAICanBus::cleanup() {
   if (running_) {
     stop();
@@ -62,6 +62,13 @@ public:
    */
   bool transmit(const CanFrame &frame) override;
 
+  /**
+   * @brief Queue frame without blocking
+   * @param frame Frame to transmit
+   * @return true if queued
+   */
+  bool tryTransmit(const CanFrame &frame) override;
+
   /**
    * @brief Stop bus activity
    */
@@ -78,6 +85,17 @@ public:
    */
   bool isRunning() const override;
 
+  /**
+   * @brief Read alerts, count drops/errors, run bus-off recovery
+   */
+  void loop() override;
+
+  /**
+   * @brief Get drop, error and recovery counters
+   * @return CanBusStats
+   */
+  CanBusStats getStats() const override;
+
   /**
    * @brief Initialize with custom queue lengths
    * @param rxQueueLen RX queue size
@@ -106,15 +124,33 @@ public:
 
   /**
    * @brief Attempt bus recovery
+   * Bus restarts automatically once recovery completes (via loop()).
    * @return true on success
    */
   bool recover();
 
+  /**
+   * @brief Enable automatic bus-off recovery (default: on)
+   * @param enabled Recover and restart from loop()
+   */
+  void setAutoRecovery(bool enabled) { autoRecovery_ = enabled; }
+
+  /**
+   * @brief Grow RX queue on overflow (driver reinstall)
+   * @param maxLen Upper bound for RX queue length (0 = disabled, default)
+   */
+  void setAutoRxQueueGrowth(uint32_t maxLen) { maxRxQueueLen_ = maxLen; }
+
   TWAICanBus(const TWAICanBus &) = delete;
   TWAICanBus &operator=(const TWAICanBus &) = delete;
 
 private:
+  enum class RecoveryState : uint8_t { NONE, BUS_OFF, RECOVERING, RECOVERED };
+
   void cleanup();
+  bool queueFrame(const CanFrame &frame, TickType_t timeout);
+  void handleAlerts(uint32_t alerts);
+  void growRxQueue();
 
   gpio_num_t txPin_;
   gpio_num_t rxPin_;
@@ -122,6 +158,16 @@ private:
   twai_mode_t mode_;
   bool running_ = false;
   bool installed_ = false;
+
+  uint32_t rxQueueLen_ = 0;
+  uint32_t txQueueLen_ = 0;
+  uint32_t maxRxQueueLen_ = 0;
+  bool growPending_ = false;
+  bool autoRecovery_ = true;
+  RecoveryState recovery_ = RecoveryState::NONE;
+  uint32_t busOffMs_ = 0;
+  uint32_t rxMissedBase_ = 0; // Drops counted before last reinstall
+  CanBusStats stats_;
 };
 
 } // namespace W4RP
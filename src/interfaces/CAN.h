@@ -18,6 +18,20 @@ struct CanFrame {
   bool rtr;
 };
 
+/**
+ * @struct CanBusStats
+ * @brief Driver health counters (cumulative since begin)
+ */
+struct CanBusStats {
+  uint32_t rxDropped = 0;    // Frames lost to RX queue/FIFO overrun
+  uint32_t rxQueueFull = 0;  // RX queue full events
+  uint32_t errorPassive = 0; // Error passive transitions
+  uint32_t busOff = 0;       // Bus-off events
+  uint32_t recoveries = 0;   // Completed bus-off recoveries
+  uint32_t txFailed = 0;     // Frames that failed to transmit
+  uint32_t rxQueueLen = 0;   // Current RX queue length (0 if unknown)
+};
+
 /**
  * @interface CAN
  * @brief CAN bus interface
@@ -46,6 +60,13 @@ public:
    */
   virtual bool transmit(const CanFrame &frame) = 0;
 
+  /**
+   * @brief Queue frame without waiting for TX queue space
+   * @param frame Frame to transmit
+   * @return true if queued, false if queue full or bus down
+   */
+  virtual bool tryTransmit(const CanFrame &frame) { return transmit(frame); }
+
   /**
    * @brief Stop bus activity
    */
@@ -61,6 +82,17 @@ public:
    * @return true if running
    */
   virtual bool isRunning() const = 0;
+
+  /**
+   * @brief Service driver events (alerts, recovery) without blocking
+   */
+  virtual void loop() {}
+
+  /**
+   * @brief Get driver health counters
+   * @return Counters (all zero if unsupported)
+   */
+  virtual CanBusStats getStats() const { return CanBusStats(); }
 };
 
 } // namespace W4RP
\ No newline at end of file
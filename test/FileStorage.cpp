@@ -0,0 +1,72 @@
+/**
+ * @file FileStorage.cpp
+ * @brief HOST:FileStorage - POSIX file implementation
+ */
+
+#include "FileStorage.h"
+#include <cstdio>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace host {
+
+bool FileStorage::begin() {
+  mkdir(dir_.c_str(), 0755);
+  struct stat st;
+  return stat(dir_.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool FileStorage::writeBlob(const char *key, const uint8_t *data, size_t len) {
+  FILE *f = fopen(path(key).c_str(), "wb");
+  if (!f)
+    return false;
+  bool ok = fwrite(data, 1, len, f) == len;
+  ok = fclose(f) == 0 && ok;
+  if (ok)
+    bytesWritten_ += len;
+  return ok;
+}
+
+size_t FileStorage::readBlob(const char *key, uint8_t *buffer, size_t maxLen) {
+  FILE *f = fopen(path(key).c_str(), "rb");
+  if (!f)
+    return 0;
+  size_t len;
+  if (!buffer) {
+    fseek(f, 0, SEEK_END);
+    len = (size_t)ftell(f);
+  } else {
+    len = fread(buffer, 1, maxLen, f);
+  }
+  fclose(f);
+  return len;
+}
+
+bool FileStorage::writeString(const char *key, const String &value) {
+  return writeBlob(key, (const uint8_t *)value.c_str(), value.size());
+}
+
+String FileStorage::readString(const char *key) {
+  size_t len = readBlob(key, nullptr, 0);
+  String value(std::string(len, '\0'));
+  readBlob(key, (uint8_t *)&value[0], len);
+  return value;
+}
+
+bool FileStorage::erase(const char *key) {
+  return unlink(path(key).c_str()) == 0;
+}
+
+void FileStorage::wipe() {
+  DIR *d = opendir(dir_.c_str());
+  if (!d)
+    return;
+  while (struct dirent *e = readdir(d)) {
+    if (e->d_name[0] != '.')
+      unlink(path(e->d_name).c_str());
+  }
+  closedir(d);
+}
+
+} // namespace host
@@ -0,0 +1,40 @@
+/**
+ * @file FileStorage.h
+ * @brief HOST:FileStorage - Storage with one file per key in a directory
+ */
+#pragma once
+#include "interfaces/Storage.h"
+#include <string>
+
+namespace host {
+
+/**
+ * @class FileStorage
+ * @brief Linux file-backed Storage (fsync-free, like an unjournaled FS)
+ */
+class FileStorage : public W4RP::Storage {
+public:
+  /// @param dir Directory for the key files, created by begin()
+  explicit FileStorage(const std::string &dir) : dir_(dir) {}
+
+  bool begin() override;
+  bool writeBlob(const char *key, const uint8_t *data, size_t len) override;
+  size_t readBlob(const char *key, uint8_t *buffer, size_t maxLen) override;
+  bool writeString(const char *key, const String &value) override;
+  String readString(const char *key) override;
+  bool erase(const char *key) override;
+
+  /// @brief Delete every key file
+  void wipe();
+
+  /// @brief Bytes handed to writeBlob() / writeString() since construction
+  size_t bytesWritten() const { return bytesWritten_; }
+
+private:
+  std::string dir_;
+  size_t bytesWritten_ = 0;
+
+  std::string path(const char *key) const { return dir_ + "/" + key; }
+};
+
+} // namespace host
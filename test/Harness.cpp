@@ -0,0 +1,102 @@
+/**
+ * @file Harness.cpp
+ * @brief HOST:Harness - File and candump log readers
+ */
+
+#include "Harness.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace host {
+
+namespace {
+int failureCount = 0;
+
+int hexDigit(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+// "(1697540000.123456) can0 0C9#0011223344556677"
+bool parseLine(const char *line, double &seconds, W4RP::CanFrame &frame) {
+  if (line[0] != '(')
+    return false;
+  char *end;
+  seconds = strtod(line + 1, &end);
+  const char *iface = strchr(end, ' ');
+  const char *id = iface ? strchr(iface + 1, ' ') : nullptr;
+  if (!id)
+    return false;
+  id++;
+
+  const char *hash = strchr(id, '#');
+  if (!hash)
+    return false;
+  memset(&frame, 0, sizeof(frame));
+  frame.id = strtoul(id, nullptr, 16);
+  frame.extended = (hash - id) == 8;
+
+  const char *p = hash + 1;
+  if (*p == 'R') {
+    frame.rtr = true;
+    return true;
+  }
+  while (frame.dlc < 8) {
+    int hi = hexDigit(p[0]);
+    int lo = hi < 0 ? -1 : hexDigit(p[1]);
+    if (lo < 0)
+      break;
+    frame.data[frame.dlc++] = (uint8_t)(hi << 4 | lo);
+    p += 2;
+  }
+  return true;
+}
+} // namespace
+
+bool readFile(const char *path, std::vector<uint8_t> &out) {
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return false;
+  out.clear();
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+bool readCandump(const char *path, std::vector<LogFrame> &out) {
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return false;
+  out.clear();
+  char line[256];
+  double first = -1.0;
+  while (fgets(line, sizeof(line), f)) {
+    double seconds;
+    LogFrame entry;
+    if (!parseLine(line, seconds, entry.frame))
+      continue;
+    if (first < 0.0)
+      first = seconds;
+    entry.ms = (uint32_t)((seconds - first) * 1000.0);
+    out.push_back(entry);
+  }
+  fclose(f);
+  return !out.empty();
+}
+
+void fail(const char *file, int line, const char *expr) {
+  failureCount++;
+  fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expr);
+}
+
+int failures() { return failureCount; }
+
+} // namespace host
@@ -0,0 +1,59 @@
+/**
+ * @file Harness.h
+ * @brief HOST:Harness - Fixtures, frame logs and checks for host tests
+ *
+ * Tests and benchmarks link src/core against the stubs in test/stubs.
+ * Frame logs use the candump -L format, so a capture from a real bus
+ * (`candump -L can0 > drive.log`) can replace the committed fixture.
+ */
+#pragma once
+#include "core/Engine.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace host {
+
+/// @brief Frame of a replayed log, with its receive time
+struct LogFrame {
+  uint32_t ms; // Since the first frame of the log
+  W4RP::CanFrame frame;
+};
+
+/**
+ * @brief Read a whole file
+ * @param path File path
+ * @param out File contents
+ * @return false if the file can't be read
+ */
+bool readFile(const char *path, std::vector<uint8_t> &out);
+
+/**
+ * @brief Read a candump -L log ("(sec.usec) iface ID#DATA" per line)
+ * @param path Log file
+ * @param out Frames in file order; 8-digit IDs are extended
+ * @return false if the file can't be read or holds no frames
+ */
+bool readCandump(const char *path, std::vector<LogFrame> &out);
+
+/// @brief Nanoseconds between two steady_clock points
+inline double elapsedNs(std::chrono::steady_clock::time_point start,
+                        std::chrono::steady_clock::time_point end) {
+  return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+/// @brief Record a failed CHECK
+void fail(const char *file, int line, const char *expr);
+
+/// @brief Failed CHECKs so far
+int failures();
+
+} // namespace host
+
+/// @brief Report a failed condition and keep going
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond))                                                               \
+      host::fail(__FILE__, __LINE__, #cond);                                   \
+  } while (0)
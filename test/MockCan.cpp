@@ -0,0 +1,58 @@
+/**
+ * @file MockCan.cpp
+ * @brief HOST:MockCan - Scripted CAN implementation
+ */
+
+#include "MockCan.h"
+
+namespace host {
+
+bool MockCan::begin() {
+  running_ = true;
+  return true;
+}
+
+bool MockCan::receive(W4RP::CanFrame &frame) {
+  if (!running_ || rx_.empty() || (int32_t)(millis() - rx_.front().ms) < 0)
+    return false;
+  frame = rx_.front().frame;
+  rx_.pop_front();
+  return true;
+}
+
+bool MockCan::transmit(const W4RP::CanFrame &frame) {
+  if (!running_)
+    return false;
+  if (txDepth_ > 0) {
+    uint32_t now = millis();
+    uint32_t drained = (now - txDrainedMs_) * txPerMs_;
+    txQueued_ = drained >= txQueued_ ? 0 : txQueued_ - drained;
+    txDrainedMs_ = now;
+  }
+  if (refuse_ > 0 || (txDepth_ > 0 && txQueued_ >= txDepth_)) {
+    if (refuse_ > 0)
+      refuse_--;
+    refused_++;
+    return false;
+  }
+  txQueued_++;
+  sentCount_++;
+  if (record_)
+    sent_.push_back({millis(), frame});
+  if (peer_)
+    peer_(frame);
+  return true;
+}
+
+void MockCan::setTxQueue(uint32_t depth, uint32_t perMs) {
+  txDepth_ = depth;
+  txPerMs_ = perMs;
+  txQueued_ = 0;
+  txDrainedMs_ = millis();
+}
+
+void MockCan::inject(const W4RP::CanFrame &frame, uint32_t atMs) {
+  rx_.push_back({atMs, frame});
+}
+
+} // namespace host
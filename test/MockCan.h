@@ -0,0 +1,88 @@
+/**
+ * @file MockCan.h
+ * @brief HOST:MockCan - Scripted CAN interface for host tests
+ *
+ * Frames injected for a given time come back from receive() once the stub
+ * clock reaches it. Transmitted frames are recorded with their send time
+ * and handed to an optional peer callback, which can answer by injecting
+ * frames (a simulated ECU, the other side of a gateway).
+ */
+#pragma once
+#include "interfaces/CAN.h"
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace host {
+
+/**
+ * @class MockCan
+ * @brief CAN stand-in driven by the stub clock
+ */
+class MockCan : public W4RP::CAN {
+public:
+  /// @brief Frame accepted by transmit() / tryTransmit()
+  struct SentFrame {
+    uint32_t ms;
+    W4RP::CanFrame frame;
+  };
+
+  using Peer = std::function<void(const W4RP::CanFrame &frame)>;
+
+  bool begin() override;
+  bool receive(W4RP::CanFrame &frame) override;
+  bool transmit(const W4RP::CanFrame &frame) override;
+  void stop() override { running_ = false; }
+  void resume() override { running_ = true; }
+  bool isRunning() const override { return running_; }
+
+  /**
+   * @brief Queue a frame for receive()
+   * @param frame Frame to deliver
+   * @param atMs Earliest delivery time (frames stay in injection order)
+   */
+  void inject(const W4RP::CanFrame &frame, uint32_t atMs = 0);
+
+  /// @brief Called with every transmitted frame, after it is recorded
+  void setPeer(Peer peer) { peer_ = std::move(peer); }
+
+  /// @brief Refuse the next count transmits, as a full TX queue would
+  void refuseTransmit(uint32_t count) { refuse_ = count; }
+
+  /**
+   * @brief Model the controller TX queue
+   * @param depth Frames it holds; transmit() refuses when full (0 = no limit)
+   * @param perMs Frames the bus takes off the queue per millisecond
+   */
+  void setTxQueue(uint32_t depth, uint32_t perMs);
+
+  /// @brief Record transmitted frames (off for long benchmarks)
+  void setRecording(bool record) { record_ = record; }
+
+  const std::vector<SentFrame> &sent() const { return sent_; }
+  void clearSent() { sent_.clear(); }
+  uint32_t getSentCount() const { return sentCount_; }
+  uint32_t getRefusedCount() const { return refused_; }
+  size_t pending() const { return rx_.size(); }
+
+private:
+  struct Pending {
+    uint32_t ms;
+    W4RP::CanFrame frame;
+  };
+
+  std::deque<Pending> rx_;
+  std::vector<SentFrame> sent_;
+  Peer peer_;
+  uint32_t refuse_ = 0;
+  uint32_t refused_ = 0;
+  uint32_t sentCount_ = 0;
+  uint32_t txDepth_ = 0;
+  uint32_t txPerMs_ = 1;
+  uint32_t txQueued_ = 0;
+  uint32_t txDrainedMs_ = 0;
+  bool record_ = true;
+  bool running_ = false;
+};
+
+} // namespace host
@@ -0,0 +1,176 @@
+/**
+ * @file bench_busmonitor.cpp
+ * @brief HOST:bench_busmonitor - BusMonitor accuracy and cost per frame
+ *
+ * Replays drive.log, j1939.log and a synthetic trace of 1024 distinct
+ * 29-bit IDs through record() and tick() as Controller::loop() calls them.
+ * Per-ID counts and maximum gaps are checked against a map of the trace
+ * and every closed load window against the nominal frame lengths; the
+ * synthetic trace overflows the table and must stay bounded. The cost is
+ * reported next to Engine::processCanFrame() with drive.wbp.
+ *
+ * Usage: bench_busmonitor fixture_dir drive.log [passes]
+ */
+
+#include "Harness.h"
+#include "core/BusMonitor.h"
+#include <cstdlib>
+#include <map>
+#include <string>
+
+namespace {
+
+struct Reference {
+  uint32_t count = 0;
+  uint32_t lastUs = 0;
+  uint32_t maxGapUs = 0;
+};
+
+/// @brief 1024 extended IDs round-robin, one frame every 400 us
+std::vector<host::LogFrame> manyIds(size_t count) {
+  std::vector<host::LogFrame> log;
+  for (size_t i = 0; i < count; i++) {
+    host::LogFrame entry = {};
+    entry.ms = (uint32_t)(i * 2 / 5);
+    entry.frame.id = 0x18FF0000 | ((i * 7) & 0x3FF);
+    entry.frame.extended = true;
+    entry.frame.dlc = 8;
+    log.push_back(entry);
+  }
+  return log;
+}
+
+/// @brief Replay once, checking every counter the monitor exposes
+void check(const char *name, const std::vector<host::LogFrame> &log) {
+  W4RP::BusMonitor monitor;
+  std::map<std::pair<uint32_t, bool>, Reference> ref;
+  uint32_t windowStartUs = 0, windowBits = 0, windowFrames = 0;
+  size_t windows = 0, wrongLoad = 0;
+
+  for (const host::LogFrame &entry : log) {
+    const W4RP::CanFrame &f = entry.frame;
+    uint32_t nowUs = entry.ms * 1000;
+    monitor.record(f, nowUs);
+    monitor.tick(nowUs);
+
+    Reference &r = ref[{f.id, f.extended}];
+    if (r.count++ > 0)
+      r.maxGapUs = std::max(r.maxGapUs, nowUs - r.lastUs);
+    r.lastUs = nowUs;
+
+    windowBits += (f.extended ? 67 : 47) + 8 * std::min<uint8_t>(f.dlc, 8);
+    windowFrames++;
+    if (nowUs - windowStartUs >= BUS_MONITOR_WINDOW_US) {
+      uint32_t expected = (uint64_t)windowBits * 1000 /
+                          (500000ull * (nowUs - windowStartUs) / 1000000);
+      windows++;
+      wrongLoad += monitor.getLoadPermille() != std::min(expected, 1000u) ||
+                   monitor.getFramesPerWindow() != windowFrames;
+      windowStartUs = nowUs;
+      windowBits = windowFrames = 0;
+    }
+  }
+
+  // Tracked IDs match exactly; the rest are counted as untracked
+  size_t tracked = 0, wrongIds = 0;
+  uint64_t trackedFrames = 0;
+  for (size_t i = 0; i < monitor.getCapacity(); i++) {
+    const W4RP::BusIdStats &e = monitor.getTable()[i];
+    if (e.count == 0)
+      continue;
+    tracked++;
+    trackedFrames += e.count;
+    auto it = ref.find({e.id, e.extended});
+    wrongIds += it == ref.end() || it->second.count != e.count ||
+                it->second.maxGapUs != e.maxGapUs;
+  }
+  CHECK(wrongIds == 0 && wrongLoad == 0);
+  CHECK(tracked == monitor.getIdCount());
+  CHECK(monitor.getTotalFrames() == log.size());
+  CHECK(trackedFrames + monitor.getUntrackedFrames() == log.size());
+  CHECK(windows > 0);
+  if (ref.size() <= BUS_MONITOR_CAPACITY / 2)
+    CHECK(tracked == ref.size() && monitor.getUntrackedFrames() == 0);
+  else
+    CHECK(monitor.getUntrackedFrames() > 0);
+
+  printf("%-9s %7zu frames, %4zu IDs (%3zu tracked, %u frames untracked), "
+         "%zu windows, last load %.1f %%\n",
+         name, log.size(), ref.size(), tracked, monitor.getUntrackedFrames(),
+         windows, monitor.getLoadPermille() / 10.0);
+}
+
+double monitorNs(const std::vector<host::LogFrame> &log, int passes,
+                 bool enabled) {
+  W4RP::BusMonitor monitor;
+  monitor.setEnabled(enabled);
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    uint32_t baseUs = pass * (log.back().ms + 1) * 1000;
+    for (const host::LogFrame &entry : log) {
+      uint32_t nowUs = baseUs + entry.ms * 1000;
+      monitor.record(entry.frame, nowUs);
+      monitor.tick(nowUs);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return host::elapsedNs(start, end) / ((double)passes * log.size());
+}
+
+double engineNs(W4RP::Engine &engine, const std::vector<host::LogFrame> &log,
+                int passes) {
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    for (const host::LogFrame &entry : log)
+      engine.processCanFrame(entry.frame);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return host::elapsedNs(start, end) / ((double)passes * log.size());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s fixture_dir drive.log [passes]\n", argv[0]);
+    return 2;
+  }
+  std::string dir = argv[1];
+  int passes = argc > 3 ? atoi(argv[3]) : 200;
+
+  std::vector<host::LogFrame> drive, j1939;
+  std::vector<uint8_t> wbp;
+  if (!host::readCandump(argv[2], drive) ||
+      !host::readCandump((dir + "/j1939.log").c_str(), j1939) ||
+      !host::readFile((dir + "/drive.wbp").c_str(), wbp)) {
+    fprintf(stderr, "cannot read fixtures\n");
+    return 2;
+  }
+  std::vector<host::LogFrame> many = manyIds(50000);
+
+  host::setMillis(0);
+  check("drive", drive);
+  check("j1939", j1939);
+  check("1024 IDs", many);
+
+  W4RP::Engine engine;
+  for (const char *id : {"warn", "fan", "chime", "display", "brake_light",
+                         "traction", "idle"})
+    engine.registerCapability(id, [](const W4RP::ParamMap &) {});
+  host::setQuiet(true);
+  bool loaded = engine.loadRuleset(wbp.data(), wbp.size());
+  host::setQuiet(false);
+  CHECK(loaded);
+
+  // Per frame, as Controller::loop() runs it: record() + tick()
+  monitorNs(drive, 1, true); // Warm caches
+  printf("record() + tick() per frame:\n");
+  printf("  drive     %6.1f ns\n", monitorNs(drive, passes, true));
+  printf("  j1939     %6.1f ns\n", monitorNs(j1939, passes, true));
+  printf("  1024 IDs  %6.1f ns\n", monitorNs(many, passes / 10 + 1, true));
+  printf("  disabled  %6.1f ns\n", monitorNs(drive, passes, false));
+  engineNs(engine, drive, 1);
+  printf("processCanFrame() on drive.log with drive.wbp: %.1f ns\n",
+         engineNs(engine, drive, passes));
+  return host::failures() ? 1 : 0;
+}
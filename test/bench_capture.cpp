@@ -0,0 +1,207 @@
+/**
+ * @file bench_capture.cpp
+ * @brief HOST:bench_capture - FrameCapture at full 1 Mbit/s bus load
+ *
+ * Generates back-to-back frames at 1 Mbit/s (nominal lengths, no stuff
+ * bits): mostly 8-byte standard frames, some J1939 and short frames.
+ * Each scenario arms a ring, triggers at 8 s and replays until the post
+ * window freezes it. The download stream must decode to an unbroken run
+ * of the input. A ring that holds both windows must have no drops; a
+ * smaller one splits its bytes in the pre:post ratio. Then record() +
+ * tick() is timed against the bus frame rate.
+ *
+ * Usage: bench_capture [passes]
+ */
+
+#include "Harness.h"
+#include "core/BusMonitor.h"
+#include "core/FrameCapture.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+namespace {
+
+constexpr uint32_t BITRATE = 1000000;
+constexpr uint32_t TRIGGER_US = 8000000;
+
+/// @brief Saturated bus: each frame starts when the previous one ends
+std::vector<host::LogFrame> fullLoad(uint32_t durationUs,
+                                     std::vector<uint32_t> &timesUs) {
+  std::mt19937 rng(58);
+  std::vector<host::LogFrame> trace;
+  timesUs.clear();
+  for (uint32_t t = 0; t < durationUs;) {
+    host::LogFrame entry = {};
+    W4RP::CanFrame &f = entry.frame;
+    uint32_t kind = rng() % 10;
+    f.extended = kind >= 7 && kind < 9;
+    f.id = f.extended ? 0x18000000 | (rng() & 0xFFFFFF) : rng() % 0x800;
+    f.dlc = kind == 9 ? rng() % 8 : 8;
+    for (uint8_t i = 0; i < f.dlc; i++)
+      f.data[i] = rng() & 0xFF;
+    entry.ms = t / 1000;
+    trace.push_back(entry);
+    timesUs.push_back(t);
+    t += W4RP::BusMonitor::frameBits(f.dlc, f.extended) * 1000000 / BITRATE;
+  }
+  return trace;
+}
+
+struct Decoded {
+  W4RP::CaptureHeader header;
+  std::vector<uint32_t> timesUs;
+  std::vector<W4RP::CanFrame> frames;
+};
+
+/// @brief Parse the GET:CAPTURE stream
+bool decode(const W4RP::FrameCapture &capture, Decoded &out) {
+  std::vector<uint8_t> stream(capture.getExportSize());
+  // Read in transport-sized chunks, as the Controller does
+  for (size_t off = 0; off < stream.size(); off += 180)
+    capture.readExport(off, stream.data() + off,
+                       std::min<size_t>(180, stream.size() - off));
+
+  memcpy(&out.header, stream.data(), sizeof(out.header));
+  size_t pos = sizeof(out.header);
+  uint32_t t = out.header.startUs;
+  for (uint32_t r = 0; r < out.header.recordCount; r++) {
+    uint32_t delta = 0;
+    for (int shift = 0;; shift += 7) {
+      if (pos >= stream.size())
+        return false;
+      uint8_t b = stream[pos++];
+      delta |= (uint32_t)(b & 0x7F) << shift;
+      if (!(b & 0x80))
+        break;
+    }
+    W4RP::CanFrame f = {};
+    uint8_t flags = stream[pos++];
+    f.dlc = flags & 0x0F;
+    f.extended = flags & CAPTURE_REC_EXTENDED;
+    for (int i = 0; i < (f.extended ? 4 : 2); i++)
+      f.id |= (uint32_t)stream[pos++] << (8 * i);
+    if (pos + f.dlc > stream.size())
+      return false;
+    memcpy(f.data, stream.data() + pos, f.dlc);
+    pos += f.dlc;
+    t += delta;
+    out.timesUs.push_back(t);
+    out.frames.push_back(f);
+  }
+  return pos == stream.size();
+}
+
+bool sameFrame(const W4RP::CanFrame &a, const W4RP::CanFrame &b) {
+  return a.id == b.id && a.extended == b.extended && a.dlc == b.dlc &&
+         memcmp(a.data, b.data, a.dlc) == 0;
+}
+
+void run(const char *name, size_t ringBytes, uint32_t preMs, uint32_t postMs,
+         const std::vector<host::LogFrame> &trace,
+         const std::vector<uint32_t> &timesUs) {
+  W4RP::FrameCapture capture;
+  host::setQuiet(true);
+  CHECK(capture.begin(ringBytes));
+  host::setQuiet(false);
+  capture.setWindow(preMs, postMs);
+  CHECK(capture.arm());
+
+  // Controller::loop() order: record, then tick
+  size_t frozenAt = trace.size();
+  size_t preBytes = 0;
+  for (size_t n = 0; n < trace.size(); n++) {
+    if (timesUs[n] >= TRIGGER_US &&
+        capture.getState() == W4RP::FrameCapture::State::ARMED) {
+      preBytes = capture.getUsedBytes();
+      capture.trigger(timesUs[n]);
+    }
+    capture.record(trace[n].frame, timesUs[n]);
+    if (capture.tick(timesUs[n])) {
+      frozenAt = n;
+      break;
+    }
+  }
+  CHECK(frozenAt < trace.size());
+
+  // The download is an unbroken run of the input (times are unique)
+  Decoded d;
+  CHECK(decode(capture, d) && !d.frames.empty());
+  if (d.frames.empty())
+    return;
+  size_t first = std::lower_bound(timesUs.begin(), timesUs.end(),
+                                  d.timesUs[0]) - timesUs.begin();
+  size_t count = d.frames.size(), wrong = 0;
+  for (size_t i = 0; i < count; i++)
+    wrong += first + i >= trace.size() ||
+             !sameFrame(d.frames[i], trace[first + i].frame) ||
+             d.timesUs[i] != timesUs[first + i];
+  CHECK(wrong == 0);
+  CHECK(d.header.magic == CAPTURE_MAGIC && d.header.triggerUs >= TRIGGER_US);
+  CHECK(d.header.triggerUs - d.header.startUs <=
+        preMs * 1000 + W4RP::BusMonitor::frameBits(8, true));
+
+  // History stays within its share; the post window gets the rest
+  const W4RP::CaptureStats &st = capture.getStats();
+  size_t share = (uint64_t)ringBytes * preMs / (preMs + postMs);
+  size_t postBytes = capture.getUsedBytes() - preBytes;
+  CHECK(preBytes <= share);
+  if (st.dropped == 0) {
+    CHECK(d.header.flags == CAPTURE_FLAG_TRIGGERED);
+    CHECK(first + count - 1 == frozenAt);
+  } else {
+    CHECK(d.header.flags & CAPTURE_FLAG_OVERFLOW);
+    CHECK(postBytes + CAPTURE_MAX_RECORD > ringBytes - preBytes);
+  }
+
+  printf("%s: %zu KB ring, %u ms pre / %u ms post\n", name, ringBytes / 1024,
+         preMs, postMs);
+  printf("  %zu records, %.2f bytes/frame; held %.0f ms before the trigger "
+         "(%zu KB), %.0f ms after (%zu KB); %u evicted, %u dropped\n",
+         count, (double)(capture.getExportSize() - sizeof(d.header)) / count,
+         (d.header.triggerUs - d.header.startUs) / 1000.0, preBytes / 1024,
+         (d.timesUs.back() - d.header.triggerUs) / 1000.0, postBytes / 1024,
+         st.evicted, st.dropped);
+}
+
+/// @brief record() + tick() per frame on an armed, full ring
+double recordNs(const std::vector<host::LogFrame> &trace,
+                const std::vector<uint32_t> &timesUs, int passes) {
+  W4RP::FrameCapture capture;
+  host::setQuiet(true);
+  capture.begin(256 * 1024);
+  host::setQuiet(false);
+  capture.setWindow(5000, 1000);
+  capture.arm();
+  uint32_t spanUs = timesUs.back() + 1000;
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    for (size_t n = 0; n < trace.size(); n++) {
+      uint32_t nowUs = pass * spanUs + timesUs[n];
+      capture.record(trace[n].frame, nowUs);
+      capture.tick(nowUs);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return host::elapsedNs(start, end) / ((double)passes * trace.size());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int passes = argc > 1 ? atoi(argv[1]) : 20;
+
+  std::vector<uint32_t> timesUs;
+  std::vector<host::LogFrame> trace = fullLoad(12000000, timesUs);
+  double framesPerSec = trace.size() / 12.0;
+
+  run("PSRAM", 1024 * 1024, 5000, 1000, trace, timesUs);
+  run("internal RAM", 128 * 1024, 5000, 1000, trace, timesUs);
+
+  double ns = recordNs(trace, timesUs, passes);
+  printf("1 Mbit/s full load: %.0f frames/s; record() + tick() %.1f ns/frame "
+         "(%.2f %% of a core-second)\n",
+         framesPerSec, ns, framesPerSec * ns / 1e7);
+  return host::failures() ? 1 : 0;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file bench_compiled.cpp
+ * @brief HOST:bench_compiled - Frame cost, interpreter vs wbp2cpp backend
+ *
+ * Replays a frame log through processCanFrame() + evaluateRules(), once
+ * interpreted and once through the generated backend, and prints the
+ * average cost per frame. Host numbers show the ratio, not device timing.
+ *
+ * Usage: bench_compiled rules.wbp frames.log [passes]
+ */
+
+#include "Harness.h"
+#include <cstdlib>
+
+W4RP::CompiledRuleset &driveRules(); // Generated from drive.wbp
+
+namespace {
+
+const char *const CAPABILITIES[] = {"warn",     "fan",      "chime", "display",
+                                    "brake_light", "traction", "idle"};
+
+double nsPerFrame(const std::vector<uint8_t> &wbp,
+                  const std::vector<host::LogFrame> &log, int passes,
+                  W4RP::CompiledRuleset *backend) {
+  W4RP::Engine engine;
+  for (const char *id : CAPABILITIES)
+    engine.registerCapability(id, [](const W4RP::ParamMap &) {});
+  engine.setCompiledRuleset(backend);
+  host::setMillis(0);
+  if (!engine.loadRuleset(wbp.data(), wbp.size()) ||
+      engine.isCompiledActive() != (backend != nullptr))
+    return -1.0;
+
+  uint32_t span = log.back().ms + 1;
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    for (const host::LogFrame &entry : log) {
+      host::setMillis(pass * span + entry.ms);
+      engine.processCanFrame(entry.frame);
+      engine.evaluateRules();
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return host::elapsedNs(start, end) / ((double)passes * log.size());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s rules.wbp frames.log [passes]\n", argv[0]);
+    return 2;
+  }
+  int passes = argc > 3 ? atoi(argv[3]) : 200;
+
+  std::vector<uint8_t> wbp;
+  std::vector<host::LogFrame> log;
+  if (!host::readFile(argv[1], wbp) || !host::readCandump(argv[2], log)) {
+    fprintf(stderr, "cannot read %s or %s\n", argv[1], argv[2]);
+    return 2;
+  }
+
+  host::setQuiet(true);
+  nsPerFrame(wbp, log, 1, nullptr); // Warm caches and the allocator
+  double interpreted = nsPerFrame(wbp, log, passes, nullptr);
+  double compiled = nsPerFrame(wbp, log, passes, &driveRules());
+  host::setQuiet(false);
+
+  CHECK(interpreted > 0.0 && compiled > 0.0);
+  printf("%zu frames x %d passes (processCanFrame + evaluateRules)\n",
+         log.size(), passes);
+  printf("  interpreted %8.1f ns/frame\n", interpreted);
+  printf("  compiled    %8.1f ns/frame  (%.2fx)\n", compiled,
+         interpreted / compiled);
+  return host::failures() ? 1 : 0;
+}
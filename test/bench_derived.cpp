@@ -0,0 +1,284 @@
+/**
+ * @file bench_derived.cpp
+ * @brief HOST:bench_derived - Derived signal DAG cost per frame
+ *
+ * Replays drive.log against derived.wbp, whose nodes (wheel average and
+ * slip, filtered acceleration, smoothed load, gear ratio) are listed
+ * consumers first. After every frame each output must match a reference
+ * that recomputes the nodes in dependency order from the decoded inputs.
+ * 64-node chain and fan-out rulesets on rpm check propagation and order at
+ * depth, and a cycle must be rejected at load. processCanFrame() is timed
+ * with each ruleset against the same signals with no nodes.
+ *
+ * Usage: bench_derived fixture_dir drive.log [passes]
+ */
+
+#include "Harness.h"
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+using W4RP::DerivedOp;
+
+// DRIVE_SIGNALS indices; outputs follow in DERIVED_NODES order
+constexpr uint16_t RPM = 0, THROTTLE = 1, SPEED = 3, WHEEL_FL = 12,
+                   WHEEL_FR = 13, DRIVE_COUNT = 16;
+constexpr uint16_t WHEEL_AVG = 16, WHEEL_SUM = 17, WHEEL_SLIP = 18,
+                   ACCEL_FILTERED = 19, ACCEL = 20, LOAD_SMOOTH = 21,
+                   LOAD = 22, RATIO = 23, SIGNAL_COUNT = 24;
+constexpr size_t CHAIN_COUNT = 64; // DERIVED_COUNT in make_ruleset.py
+
+struct Node {
+  uint16_t out;
+  DerivedOp op;
+  uint16_t a, b;
+  float param;
+};
+
+/// @brief DERIVED_NODES in make_ruleset.py, in dependency order
+const Node NODES[] = {
+    {WHEEL_SUM, DerivedOp::ADD, WHEEL_FL, WHEEL_FR, 0.0f},
+    {WHEEL_AVG, DerivedOp::SCALE, WHEEL_SUM, WHEEL_SUM, 0.5f},
+    {WHEEL_SLIP, DerivedOp::SUB, WHEEL_FL, WHEEL_FR, 0.0f},
+    {ACCEL, DerivedOp::DERIVATIVE, SPEED, SPEED, 0.0f},
+    {ACCEL_FILTERED, DerivedOp::LOWPASS, ACCEL, ACCEL, 200.0f},
+    {LOAD, DerivedOp::MUL, RPM, THROTTLE, 0.0f},
+    {LOAD_SMOOTH, DerivedOp::EMA, LOAD, LOAD, 0.1f},
+    {RATIO, DerivedOp::DIV, RPM, SPEED, 0.0f},
+};
+
+/// @brief The node semantics of Engine::updateDerived(), in double
+class Reference {
+public:
+  /// @return false if an output disagrees with the engine's
+  bool step(const W4RP::CanFrame &frame, uint32_t nowMs,
+            const std::vector<W4RP::RuntimeSignal> &signals, double &maxErr) {
+    bool updated[SIGNAL_COUNT] = {};
+    for (uint16_t i = 0; i < DRIVE_COUNT; i++) {
+      if (signals[i].canId == frame.id && signals[i].everSet) {
+        updated[i] = true;
+        set_[i] = true;
+        value_[i] = signals[i].value;
+      }
+    }
+
+    for (size_t n = 0; n < sizeof(NODES) / sizeof(NODES[0]); n++) {
+      const Node &node = NODES[n];
+      State &st = state_[n];
+      if (!(updated[node.a] || updated[node.b]) || !set_[node.a] ||
+          !set_[node.b])
+        continue;
+      double a = value_[node.a], b = value_[node.b], out = 0.0;
+      bool ok = true;
+      uint32_t dtMs = nowMs - st.prevMs;
+      switch (node.op) {
+      case DerivedOp::ADD:
+        out = a + b;
+        break;
+      case DerivedOp::SUB:
+        out = a - b;
+        break;
+      case DerivedOp::MUL:
+        out = a * b;
+        break;
+      case DerivedOp::DIV:
+        ok = fabs(b) >= 1e-9;
+        out = ok ? a / b : 0.0;
+        break;
+      case DerivedOp::SCALE:
+        out = a * node.param;
+        break;
+      case DerivedOp::EMA:
+        out = st.primed ? value_[node.out] + node.param * (a - value_[node.out])
+                        : a;
+        break;
+      case DerivedOp::LOWPASS:
+        out = st.primed ? value_[node.out] + (a - value_[node.out]) * dtMs /
+                                                 (node.param + dtMs)
+                        : a;
+        break;
+      case DerivedOp::DERIVATIVE:
+        ok = st.primed && dtMs > 0;
+        out = ok ? (a - st.prevInput) * 1000.0 / dtMs : 0.0;
+        break;
+      }
+      if (node.op >= DerivedOp::EMA) {
+        st.primed = true;
+        st.prevMs = nowMs;
+        st.prevInput = a;
+      }
+      if (ok) {
+        value_[node.out] = out;
+        set_[node.out] = updated[node.out] = true;
+      }
+    }
+
+    bool match = true;
+    for (uint16_t i = DRIVE_COUNT; i < SIGNAL_COUNT; i++) {
+      if (set_[i] != signals[i].everSet)
+        return false;
+      if (!set_[i])
+        continue;
+      double err =
+          fabs(signals[i].value - value_[i]) / std::max(1.0, fabs(value_[i]));
+      maxErr = std::max(maxErr, err);
+      match = match && err < 1e-3;
+    }
+    return match;
+  }
+
+  size_t setCount() const {
+    size_t count = 0;
+    for (uint16_t i = DRIVE_COUNT; i < SIGNAL_COUNT; i++)
+      count += set_[i];
+    return count;
+  }
+
+private:
+  struct State {
+    double prevInput = 0.0;
+    uint32_t prevMs = 0;
+    bool primed = false;
+  };
+  State state_[sizeof(NODES) / sizeof(NODES[0])];
+  double value_[SIGNAL_COUNT] = {};
+  bool set_[SIGNAL_COUNT] = {};
+};
+
+bool load(W4RP::Engine &engine, const std::string &path) {
+  std::vector<uint8_t> wbp;
+  host::setQuiet(true);
+  bool ok = host::readFile(path.c_str(), wbp) &&
+            engine.loadRuleset(wbp.data(), wbp.size());
+  host::setQuiet(false);
+  return ok;
+}
+
+/// @brief derived.wbp matches the reference after every frame
+void checkDag(const std::string &dir, const std::vector<host::LogFrame> &log) {
+  W4RP::Engine engine;
+  host::setMillis(0);
+  CHECK(load(engine, dir + "/derived.wbp"));
+  CHECK(engine.getSignalCount() == SIGNAL_COUNT);
+
+  Reference ref;
+  double maxErr = 0.0;
+  size_t wrong = 0;
+  for (size_t n = 0; n < log.size(); n++) {
+    host::setMillis(log[n].ms);
+    engine.processCanFrame(log[n].frame);
+    if (!ref.step(log[n].frame, log[n].ms, engine.getSignals(), maxErr) &&
+        wrong++ < 5)
+      fprintf(stderr, "frame %zu (%03X at %u ms): derived output differs\n",
+              n, log[n].frame.id, log[n].ms);
+  }
+  CHECK(wrong == 0);
+  CHECK(ref.setCount() == SIGNAL_COUNT - DRIVE_COUNT);
+  printf("derived.wbp: %zu nodes match the reference on %zu frames "
+         "(max relative error %.2g)\n",
+         sizeof(NODES) / sizeof(NODES[0]), log.size(), maxErr);
+}
+
+/// @brief Chain outputs equal rpm x 2 or x 1; fan outputs rpm x (i + 1)
+void checkRpmNodes(const std::string &dir,
+                   const std::vector<host::LogFrame> &log, bool chain) {
+  W4RP::Engine engine;
+  host::setMillis(0);
+  CHECK(load(engine, dir + (chain ? "/derived_chain.wbp"
+                                  : "/derived_fan.wbp")));
+  const std::vector<W4RP::RuntimeSignal> &signals = engine.getSignals();
+  CHECK(signals.size() == DRIVE_COUNT + CHAIN_COUNT);
+
+  size_t wrong = 0;
+  uint32_t rpmMs = 0;
+  for (const host::LogFrame &entry : log) {
+    host::setMillis(entry.ms);
+    engine.processCanFrame(entry.frame);
+    if (entry.frame.id == signals[RPM].canId)
+      rpmMs = entry.ms;
+    if (!signals[RPM].everSet)
+      continue;
+
+    float rpm = signals[RPM].value;
+    for (size_t i = 0; i < CHAIN_COUNT; i++) {
+      // The chain fixture lists d63 first
+      const W4RP::RuntimeSignal &d =
+          signals[DRIVE_COUNT + (chain ? CHAIN_COUNT - 1 - i : i)];
+      float expected = chain ? (i % 2 == 0 ? rpm * 2.0f : rpm)
+                             : rpm * (float)(i + 1);
+      wrong += d.value != expected || d.lastUpdateMs != rpmMs;
+    }
+  }
+  CHECK(wrong == 0);
+}
+
+double engineNs(const std::string &path, const std::vector<host::LogFrame> &log,
+                int passes) {
+  W4RP::Engine engine;
+  host::setMillis(0);
+  CHECK(load(engine, path));
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    uint32_t baseMs = pass * (log.back().ms + 1);
+    for (const host::LogFrame &entry : log) {
+      host::setMillis(baseMs + entry.ms);
+      engine.processCanFrame(entry.frame);
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return host::elapsedNs(start, end) / ((double)passes * log.size());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s fixture_dir drive.log [passes]\n", argv[0]);
+    return 2;
+  }
+  std::string dir = argv[1];
+  int passes = argc > 3 ? atoi(argv[3]) : 100;
+
+  std::vector<host::LogFrame> log;
+  if (!host::readCandump(argv[2], log)) {
+    fprintf(stderr, "cannot read %s\n", argv[2]);
+    return 2;
+  }
+
+  checkDag(dir, log);
+  checkRpmNodes(dir, log, true);
+  checkRpmNodes(dir, log, false);
+
+  W4RP::Engine cyclic;
+  CHECK(!load(cyclic, dir + "/derived_cycle.wbp"));
+
+  // Frames that feed at least one node of each ruleset
+  size_t dagInputs = 0, rpmFrames = 0;
+  for (const host::LogFrame &entry : log) {
+    uint32_t id = entry.frame.id;
+    rpmFrames += id == 0x0C9;
+    dagInputs += id == 0x0C9 || id == 0x3E9 || id == 0x348;
+  }
+
+  engineNs(dir + "/derived.wbp", log, 1); // Warm caches
+  double noneNs = engineNs(dir + "/derived_none.wbp", log, passes);
+  double dagNs = engineNs(dir + "/derived.wbp", log, passes);
+  double chainNs = engineNs(dir + "/derived_chain.wbp", log, passes);
+  double fanNs = engineNs(dir + "/derived_fan.wbp", log, passes);
+
+  printf("processCanFrame() on drive.log (%zu frames, %zu feed the DAG, "
+         "%zu rpm):\n",
+         log.size(), dagInputs, rpmFrames);
+  printf("  %-10s %6.1f ns/frame\n", "no nodes", noneNs);
+  printf("  %-10s %6.1f ns/frame, +%.1f ns per input frame\n", "8-node DAG",
+         dagNs, (dagNs - noneNs) * log.size() / dagInputs);
+  printf("  %-10s %6.1f ns/frame, +%.1f ns per rpm frame (%.2f ns/node)\n",
+         "64 chain", chainNs, (chainNs - noneNs) * log.size() / rpmFrames,
+         (chainNs - noneNs) * log.size() / rpmFrames / CHAIN_COUNT);
+  printf("  %-10s %6.1f ns/frame, +%.1f ns per rpm frame (%.2f ns/node)\n",
+         "64 fan-out", fanNs, (fanNs - noneNs) * log.size() / rpmFrames,
+         (fanNs - noneNs) * log.size() / rpmFrames / CHAIN_COUNT);
+  return host::failures() ? 1 : 0;
+}
@@ -0,0 +1,284 @@
+/**
+ * @file bench_gateway.cpp
+ * @brief HOST:bench_gateway - Gateway routing between two mock buses
+ *
+ * Routes a seeded mix of 11-bit, 29-bit and J1939 traffic in both
+ * directions through exact, masked and overlapping routes with byte
+ * rewrites. Every frame's output on the destination mock is compared with
+ * a linear scan of the route list, then route() is timed per frame with
+ * the table as configured and padded with unused exact routes.
+ *
+ * Usage: bench_gateway [passes]
+ */
+
+#include "Harness.h"
+#include "MockCan.h"
+#include "core/Gateway.h"
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+
+namespace {
+
+std::vector<W4RP::GatewayRoute> makeRoutes() {
+  std::vector<W4RP::GatewayRoute> routes;
+  W4RP::GatewayRoute r = {};
+
+  // Bus 0 -> 1: exact 11-bit 0x100..0x10F, every fourth forces byte 7
+  for (uint32_t id = 0x100; id < 0x110; id++) {
+    r = {};
+    r.srcBus = 0;
+    r.dstBus = 1;
+    r.canId = id;
+    if (id % 4 == 0) {
+      r.rewriteCount = 1;
+      r.rewrites[0] = {7, 0x00, 0xFF};
+    }
+    routes.push_back(r);
+  }
+
+  // 11-bit range 0x300..0x30F: high nibble of byte 0 replaced
+  r = {};
+  r.srcBus = 0;
+  r.dstBus = 1;
+  r.canId = 0x300;
+  r.mask = 0x7F0;
+  r.rewriteCount = 1;
+  r.rewrites[0] = {0, 0x0F, 0xA0};
+  routes.push_back(r);
+
+  // 0x305 also has an exact route: forwarded twice, patched differently
+  r = {};
+  r.srcBus = 0;
+  r.dstBus = 1;
+  r.canId = 0x305;
+  r.rewriteCount = 4;
+  r.rewrites[0] = {1, 0x00, 0x11};
+  r.rewrites[1] = {2, 0xF0, 0x02};
+  r.rewrites[2] = {1, 0x0F, 0x20}; // Applied after rewrites[0]: 0x21
+  r.rewrites[3] = {6, 0xFF, 0x80};
+  routes.push_back(r);
+
+  // Extended 0x00000100 only; standard 0x100 has its own route above
+  r = {};
+  r.srcBus = 0;
+  r.dstBus = 1;
+  r.canId = 0x100;
+  r.extended = true;
+  routes.push_back(r);
+
+  // Bus 1 -> 0: J1939 CCVS from any source, low nibble of byte 1 cleared
+  r = {};
+  r.srcBus = 1;
+  r.dstBus = 0;
+  r.canId = 0x18FEF100;
+  r.mask = J1939_PGN_MASK_PDU2;
+  r.extended = true;
+  r.rewriteCount = 1;
+  r.rewrites[0] = {1, 0xF0, 0x00};
+  routes.push_back(r);
+
+  // CCVS from SA 0x00 also unpatched
+  r = {};
+  r.srcBus = 1;
+  r.dstBus = 0;
+  r.canId = 0x18FEF100;
+  r.extended = true;
+  routes.push_back(r);
+
+  // TSC1 (PDU1) to any destination from any source
+  r = {};
+  r.srcBus = 1;
+  r.dstBus = 0;
+  r.canId = 0x0C000000;
+  r.mask = J1939_PGN_MASK_PDU1;
+  r.extended = true;
+  routes.push_back(r);
+  return routes;
+}
+
+struct Input {
+  uint8_t srcBus;
+  W4RP::CanFrame frame;
+};
+
+std::vector<Input> makeTraffic(size_t count) {
+  std::mt19937 rng(55);
+  const uint32_t PGNS[] = {0xFEF1, 0xFEEE, 0xF004, 0x0000};
+  std::vector<Input> traffic;
+  for (size_t i = 0; i < count; i++) {
+    Input in = {};
+    W4RP::CanFrame &f = in.frame;
+    f.dlc = 8;
+    for (uint8_t &b : f.data)
+      b = rng() & 0xFF;
+    switch (rng() % 8) {
+    case 0:
+    case 1: // Routed exact IDs and their neighbours
+      f.id = 0x0F8 + rng() % 0x20;
+      break;
+    case 2: // Masked range and just outside it
+      f.id = 0x2F8 + rng() % 0x20;
+      break;
+    case 3: // Extended twin of a routed 11-bit ID
+      f.id = 0x0FE + rng() % 4;
+      f.extended = true;
+      break;
+    case 4: // Unrouted 11-bit
+      f.id = rng() % 0x800;
+      break;
+    default: { // J1939 on bus 1, random priority and source address
+      uint32_t pgn = PGNS[rng() % 4];
+      uint32_t ps = (pgn >> 8) < 240 ? rng() % 256 : 0;
+      f.id = ((rng() % 8) << 26) | (pgn << 8) | (ps << 8) | (rng() % 256);
+      f.extended = true;
+      in.srcBus = 1;
+      break;
+    }
+    }
+    // Frames arriving on the other bus than their routes must not move
+    if (rng() % 16 == 0)
+      in.srcBus ^= 1;
+    traffic.push_back(in);
+  }
+  return traffic;
+}
+
+/// @brief Comparable form of a frame: ID with bit 31 for 29-bit, payload
+std::pair<uint32_t, uint64_t> key(const W4RP::CanFrame &f) {
+  uint64_t data = 0;
+  for (uint8_t b : f.data)
+    data = (data << 8) | b;
+  return {f.id | (f.extended ? 0x80000000 : 0), data};
+}
+
+using Keys = std::vector<std::pair<uint32_t, uint64_t>>;
+
+/// @brief Frames the route list sends to dstBus for one input
+Keys reference(const std::vector<W4RP::GatewayRoute> &routes, const Input &in,
+               uint8_t dstBus) {
+  Keys out;
+  for (const W4RP::GatewayRoute &r : routes) {
+    if (r.srcBus != in.srcBus || r.dstBus != dstBus ||
+        r.extended != in.frame.extended ||
+        (in.frame.id & r.mask) != (r.canId & r.mask))
+      continue;
+    W4RP::CanFrame f = in.frame;
+    for (uint8_t i = 0; i < r.rewriteCount; i++) {
+      const W4RP::GatewayRewrite &rw = r.rewrites[i];
+      f.data[rw.byteIdx] = (f.data[rw.byteIdx] & rw.andMask) | rw.orValue;
+    }
+    out.push_back(key(f));
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+Keys received(host::MockCan &bus) {
+  Keys out;
+  for (const host::MockCan::SentFrame &s : bus.sent())
+    out.push_back(key(s.frame));
+  bus.clearSent();
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+double nsPerFrame(W4RP::Gateway &gw, const std::vector<Input> &traffic,
+                  W4RP::CAN *const *buses, int passes) {
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    for (const Input &in : traffic)
+      gw.route(in.srcBus, in.frame, buses, 2);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return host::elapsedNs(start, end) / ((double)passes * traffic.size());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int passes = argc > 1 ? atoi(argv[1]) : 100;
+
+  host::setMillis(0);
+  host::MockCan busA, busB;
+  busA.begin();
+  busB.begin();
+  host::MockCan *mocks[] = {&busA, &busB};
+  W4RP::CAN *buses[] = {&busA, &busB};
+
+  std::vector<W4RP::GatewayRoute> routes = makeRoutes();
+  W4RP::Gateway gw;
+  for (const W4RP::GatewayRoute &r : routes)
+    CHECK(gw.addRoute(r));
+
+  // Same bus both ends and out-of-range buses are rejected
+  host::setQuiet(true);
+  W4RP::GatewayRoute bad = {};
+  bad.srcBus = 1;
+  bad.dstBus = 1;
+  CHECK(!gw.addRoute(bad));
+  bad.dstBus = GATEWAY_MAX_BUSES;
+  CHECK(!gw.addRoute(bad));
+  host::setQuiet(false);
+
+  // Each input reaches exactly the frames the route list predicts
+  std::vector<Input> traffic = makeTraffic(20000);
+  size_t forwarded = 0, doubled = 0, patched = 0, wrong = 0;
+  for (size_t n = 0; n < traffic.size(); n++) {
+    const Input &in = traffic[n];
+    gw.route(in.srcBus, in.frame, buses, 2);
+    uint8_t dst = in.srcBus ^ 1;
+    Keys expected = reference(routes, in, dst);
+    Keys got = received(*mocks[dst]);
+    if ((got != expected || !mocks[in.srcBus]->sent().empty()) &&
+        wrong++ < 5)
+      fprintf(stderr, "frame %zu (%s %X on bus %u): %zu out, %zu expected\n",
+              n, in.frame.extended ? "ext" : "std", in.frame.id, in.srcBus,
+              got.size(), expected.size());
+    mocks[in.srcBus]->clearSent();
+    forwarded += got.size();
+    doubled += got.size() > 1;
+    for (const auto &k : got)
+      patched += k != key(in.frame);
+  }
+  CHECK(wrong == 0);
+  CHECK(doubled > 0 && patched > 0);
+  CHECK(gw.getStats().forwarded == forwarded && gw.getStats().dropped == 0);
+
+  // A refused transmit is dropped, not retried
+  W4RP::CanFrame f = {};
+  f.id = 0x101;
+  f.dlc = 8;
+  busB.refuseTransmit(1);
+  gw.route(0, f, buses, 2);
+  gw.route(0, f, buses, 2);
+  CHECK(gw.getStats().dropped == 1 && busB.sent().size() == 1);
+
+  // A missing destination counts as dropped
+  W4RP::CAN *onlyA[] = {&busA, nullptr};
+  gw.route(0, f, onlyA, 2);
+  CHECK(gw.getStats().dropped == 2);
+
+  busA.setRecording(false);
+  busB.setRecording(false);
+  nsPerFrame(gw, traffic, buses, 1); // Warm caches
+  double tableNs = nsPerFrame(gw, traffic, buses, passes);
+
+  // Unused exact routes: still one lookup per frame
+  for (uint32_t id = 0x400; id < 0x4F0; id++) {
+    W4RP::GatewayRoute r = {};
+    r.srcBus = 0;
+    r.dstBus = 1;
+    r.canId = id;
+    gw.addRoute(r);
+  }
+  nsPerFrame(gw, traffic, buses, 1);
+  double paddedNs = nsPerFrame(gw, traffic, buses, passes);
+
+  printf("%zu frames x %d passes, %zu forwarded (%zu to two routes, "
+         "%zu patched)\n",
+         traffic.size(), passes, forwarded, doubled, patched);
+  printf("  %3zu routes %8.1f ns/frame\n", routes.size(), tableNs);
+  printf("  %3zu routes %8.1f ns/frame\n", routes.size() + 0xF0, paddedNs);
+  return host::failures() ? 1 : 0;
+}
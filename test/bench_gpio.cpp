@@ -0,0 +1,258 @@
+/**
+ * @file bench_gpio.cpp
+ * @brief HOST:bench_gpio - Built-in GPIO outputs vs capability handlers
+ *
+ * Replays drive.log against gpio.wbp (gpio_set, gpio_pulse and pwm_duty
+ * on GPIO 4, 5 and 18) three ways: the built-in outputs from
+ * enableNativeOutputs(), typed handlers and ParamMap handlers that make
+ * the same pin writes. After every cycle the stub pin levels must match
+ * the rules applied to the decoded signals. A ruleset driving a pin
+ * outside the mask must be rejected. Each way is timed per cycle and per
+ * action.
+ *
+ * Usage: bench_gpio fixture_dir drive.log [passes]
+ */
+
+#include "Harness.h"
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+// GPIO_CONDITIONS / GPIO_RULES in make_ruleset.py
+constexpr uint8_t SET_PIN = 4, PULSE_PIN = 5, PWM_PIN = 18;
+constexpr uint32_t PULSE_MS = 200;
+constexpr uint16_t RPM = 0, SPEED = 3, BRAKE_PRESSURE = 7;
+
+enum class Dispatch { NATIVE, TYPED, PARAM_MAP };
+const char *const DISPATCH_NAMES[] = {"built-in", "typed", "ParamMap"};
+
+/// @brief gpio_pulse for the handlers: restored before each cycle, as the
+/// Engine restores its own pulses at the start of evaluateRules()
+struct HandlerPulse {
+  bool active = false;
+  uint8_t pin = 0;
+  uint8_t restoreLevel = 0;
+  uint32_t endMs = 0;
+
+  void start(int pin_, int level, int widthMs) {
+    if (!active)
+      restoreLevel = level ? LOW : HIGH;
+    active = true;
+    pin = pin_;
+    endMs = millis() + widthMs;
+    digitalWrite(pin, level ? HIGH : LOW);
+  }
+
+  void service(uint32_t nowMs) {
+    if (active && (int32_t)(nowMs - endMs) >= 0) {
+      digitalWrite(pin, restoreLevel);
+      active = false;
+    }
+  }
+};
+
+HandlerPulse handlerPulse;
+uint32_t actions = 0;
+
+void resetPins() {
+  for (uint8_t pin : {SET_PIN, PULSE_PIN, PWM_PIN})
+    digitalWrite(pin, LOW);
+  handlerPulse = HandlerPulse();
+}
+
+/// @brief Same dispatch flags as the built-ins: calls are not coalesced
+W4RP::CapabilityMeta outputMeta(const char *id) {
+  W4RP::CapabilityMeta meta;
+  meta.id = id;
+  meta.coalesce = false;
+  return meta;
+}
+
+bool load(W4RP::Engine &engine, Dispatch dispatch, const std::string &path) {
+  switch (dispatch) {
+  case Dispatch::NATIVE:
+    engine.enableNativeOutputs((1ULL << SET_PIN) | (1ULL << PULSE_PIN) |
+                               (1ULL << PWM_PIN));
+    break;
+  case Dispatch::TYPED:
+    engine.registerCapability<int, int>(
+        "gpio_set",
+        [](int pin, int level) {
+          actions++;
+          digitalWrite(pin, level ? HIGH : LOW);
+        },
+        outputMeta("gpio_set"));
+    engine.registerCapability<int, int, int>(
+        "gpio_pulse",
+        [](int pin, int level, int widthMs) {
+          actions++;
+          handlerPulse.start(pin, level, widthMs);
+        },
+        outputMeta("gpio_pulse"));
+    engine.registerCapability<int, int>(
+        "pwm_duty",
+        [](int pin, int duty) {
+          actions++;
+          analogWrite(pin, duty);
+        },
+        outputMeta("pwm_duty"));
+    break;
+  case Dispatch::PARAM_MAP:
+    engine.registerCapability(
+        "gpio_set",
+        [](const W4RP::ParamMap &p) {
+          actions++;
+          digitalWrite(p.at("p0").toInt(), p.at("p1").toInt() ? HIGH : LOW);
+        },
+        outputMeta("gpio_set"));
+    engine.registerCapability(
+        "gpio_pulse",
+        [](const W4RP::ParamMap &p) {
+          actions++;
+          handlerPulse.start(p.at("p0").toInt(), p.at("p1").toInt(),
+                             p.at("p2").toInt());
+        },
+        outputMeta("gpio_pulse"));
+    engine.registerCapability(
+        "pwm_duty",
+        [](const W4RP::ParamMap &p) {
+          actions++;
+          analogWrite(p.at("p0").toInt(), p.at("p1").toInt());
+        },
+        outputMeta("pwm_duty"));
+    break;
+  }
+
+  std::vector<uint8_t> wbp;
+  host::setQuiet(true);
+  bool ok = host::readFile(path.c_str(), wbp) &&
+            engine.loadRuleset(wbp.data(), wbp.size());
+  host::setQuiet(false);
+  return ok;
+}
+
+/// @brief One Controller::loop() cycle per frame
+void cycle(W4RP::Engine &engine, Dispatch dispatch, const W4RP::CanFrame &f,
+           uint32_t nowMs) {
+  host::setMillis(nowMs);
+  engine.processCanFrame(f);
+  if (dispatch != Dispatch::NATIVE)
+    handlerPulse.service(nowMs);
+  engine.evaluateRules();
+}
+
+/// @brief Pin levels follow the rules after every cycle
+void check(const std::string &dir, const std::vector<host::LogFrame> &log,
+           Dispatch dispatch) {
+  W4RP::Engine engine;
+  host::setMillis(0);
+  resetPins();
+  CHECK(load(engine, dispatch, dir + "/gpio.wbp"));
+  const std::vector<W4RP::RuntimeSignal> &signals = engine.getSignals();
+
+  const int ON[3] = {HIGH, HIGH, 200}, OFF[3] = {LOW, LOW, 30};
+  size_t wrong = 0, on[3] = {}, off[3] = {};
+  bool pulsing = false;
+  uint32_t pulseEndMs = 0;
+  int level = LOW, duty = LOW; // resetPins()
+  for (size_t n = 0; n < log.size(); n++) {
+    uint32_t now = log[n].ms;
+    cycle(engine, dispatch, log[n].frame, now);
+
+    // Reference: conditions on the decoded values; pulses re-trigger
+    const W4RP::RuntimeSignal &rpm = signals[RPM], &speed = signals[SPEED],
+                              &brake = signals[BRAKE_PRESSURE];
+    if (rpm.everSet)
+      level = rpm.value > 3000.0f ? HIGH : LOW;
+    if (speed.everSet)
+      duty = speed.value > 50.0f ? ON[2] : OFF[2];
+    if (pulsing && (int32_t)(now - pulseEndMs) >= 0)
+      pulsing = false;
+    if (brake.everSet && brake.value > 40.0f) {
+      pulsing = true;
+      pulseEndMs = now + PULSE_MS;
+    }
+
+    int expected[3] = {level, pulsing ? HIGH : LOW, duty};
+    int got[3] = {host::pinLevel(SET_PIN), host::pinLevel(PULSE_PIN),
+                  host::pinLevel(PWM_PIN)};
+    for (int i = 0; i < 3; i++) {
+      on[i] += got[i] == ON[i];
+      off[i] += got[i] == OFF[i];
+    }
+    if ((got[0] != expected[0] || got[1] != expected[1] ||
+         got[2] != expected[2]) &&
+        wrong++ < 5)
+      fprintf(stderr, "%s, %u ms: pins %d/%d/%d, expected %d/%d/%d\n",
+              DISPATCH_NAMES[(int)dispatch], now, got[0], got[1], got[2],
+              expected[0], expected[1], expected[2]);
+  }
+  CHECK(wrong == 0);
+  for (int i = 0; i < 3; i++)
+    CHECK(on[i] > 0 && off[i] > 0);
+}
+
+/// @brief ns per cycle; calls gets the actions run over all passes
+double cycleNs(const std::string &dir, const std::vector<host::LogFrame> &log,
+               Dispatch dispatch, int passes, uint64_t &calls) {
+  W4RP::Engine engine;
+  host::setMillis(0);
+  resetPins();
+  CHECK(load(engine, dispatch, dir + "/gpio.wbp"));
+  uint32_t triggered = engine.getRulesTriggered();
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    uint32_t baseMs = pass * (log.back().ms + 1);
+    for (const host::LogFrame &entry : log)
+      cycle(engine, dispatch, entry.frame, baseMs + entry.ms);
+  }
+  auto end = std::chrono::steady_clock::now();
+  calls = engine.getRulesTriggered() - triggered; // One action per rule
+  return host::elapsedNs(start, end) / ((double)passes * log.size());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s fixture_dir drive.log [passes]\n", argv[0]);
+    return 2;
+  }
+  std::string dir = argv[1];
+  int passes = argc > 3 ? atoi(argv[3]) : 200;
+
+  std::vector<host::LogFrame> log;
+  if (!host::readCandump(argv[2], log)) {
+    fprintf(stderr, "cannot read %s\n", argv[2]);
+    return 2;
+  }
+
+  // Pins outside the mask never load
+  W4RP::Engine badPin;
+  CHECK(!load(badPin, Dispatch::NATIVE, dir + "/gpio_bad_pin.wbp"));
+
+  for (Dispatch dispatch :
+       {Dispatch::NATIVE, Dispatch::TYPED, Dispatch::PARAM_MAP}) {
+    actions = 0;
+    check(dir, log, dispatch);
+    CHECK((dispatch == Dispatch::NATIVE) == (actions == 0));
+  }
+
+  uint64_t calls = 0;
+  cycleNs(dir, log, Dispatch::NATIVE, 1, calls); // Warm caches
+  printf("processCanFrame() + evaluateRules() on drive.log with gpio.wbp:\n");
+  double nativeNs = 0.0;
+  for (Dispatch dispatch :
+       {Dispatch::NATIVE, Dispatch::TYPED, Dispatch::PARAM_MAP}) {
+    double ns = cycleNs(dir, log, dispatch, passes, calls);
+    double perCycle = (double)calls / passes / log.size();
+    if (dispatch == Dispatch::NATIVE)
+      nativeNs = ns;
+    printf("  %-9s %7.1f ns/cycle, %.2f actions/cycle, %+6.1f ns/action vs "
+           "built-in\n",
+           DISPATCH_NAMES[(int)dispatch], ns, perCycle,
+           (ns - nativeNs) / perCycle);
+  }
+  return host::failures() ? 1 : 0;
+}
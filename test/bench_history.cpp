@@ -0,0 +1,176 @@
+/**
+ * @file bench_history.cpp
+ * @brief HOST:bench_history - Signal history on file-backed storage
+ *
+ * Logs eight CAN-like signals at 1 s for a span of log time into
+ * FileStorage, then reports bits per sample, segments per hour and the
+ * retention a given segment count buys. Every sample of the first track
+ * must read back unchanged, before and after a simulated reboot.
+ *
+ * Usage: bench_history dir [hours] [segments]
+ */
+
+#include "FileStorage.h"
+#include "Harness.h"
+#include "core/SignalHistory.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+namespace {
+
+constexpr uint16_t PERIOD_MS = 1000;
+
+/// @brief Random walk quantized like a decoded CAN signal
+struct Source {
+  float factor;
+  float offset;
+  float step; // Raw counts per sample (stddev)
+  int64_t lo, hi;
+  int64_t raw;
+};
+
+Source SOURCES[] = {
+    {0.25f, 0.0f, 40.0f, 2800, 26000, 3200},  // Engine speed
+    {0.01f, 0.0f, 30.0f, 0, 20000, 5000},     // Vehicle speed
+    {1.0f, -40.0f, 0.1f, 100, 150, 125},      // Coolant
+    {0.001f, 0.0f, 8.0f, 11000, 15000, 13900}, // Battery
+    {0.4f, 0.0f, 0.02f, 0, 250, 180},         // Fuel level
+    {0.4f, 0.0f, 6.0f, 0, 250, 50},           // Throttle
+    {1.0f, 0.0f, 0.05f, 0, 6, 3},             // Gear
+    {0.1f, 0.0f, 0.0f, 0, 0x7FFFFFFF, 1234567} // Odometer
+};
+constexpr size_t TRACKS = sizeof(SOURCES) / sizeof(SOURCES[0]);
+
+float next(Source &src, std::mt19937 &rng, uint32_t second) {
+  if (src.step == 0.0f) {
+    src.raw += second % 3 == 0; // 0.1 km every ~3 s
+  } else {
+    std::normal_distribution<float> dist(0.0f, src.step);
+    src.raw += (int64_t)lroundf(dist(rng));
+    src.raw = std::min(std::max(src.raw, src.lo), src.hi);
+  }
+  return (float)src.raw * src.factor + src.offset;
+}
+
+struct Sample {
+  uint32_t ms;
+  float value;
+};
+
+std::vector<Sample> readBack(W4RP::SignalHistory &history, uint32_t key) {
+  std::vector<Sample> out;
+  history.query(key, 0, UINT32_MAX, [&](uint32_t ms, float value) {
+    out.push_back({ms, value});
+  });
+  return out;
+}
+
+/// @brief Read-back must be the newest samples, in order, bit for bit
+bool isTail(const std::vector<Sample> &got,
+            const std::vector<Sample> &expected) {
+  if (got.empty() || got.size() > expected.size())
+    return false;
+  size_t skip = expected.size() - got.size();
+  for (size_t i = 0; i < got.size(); i++) {
+    const Sample &e = expected[skip + i];
+    if (got[i].ms != e.ms || memcmp(&got[i].value, &e.value, 4) != 0)
+      return false;
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s dir [hours] [segments]\n", argv[0]);
+    return 2;
+  }
+  double hours = argc > 2 ? atof(argv[2]) : 24.0;
+  size_t segments = argc > 3 ? strtoul(argv[3], nullptr, 10)
+                             : HISTORY_MAX_SEGMENTS;
+
+  host::FileStorage storage(argv[1]);
+  if (!storage.begin()) {
+    fprintf(stderr, "cannot create %s\n", argv[1]);
+    return 2;
+  }
+  storage.wipe();
+  host::setQuiet(true);
+
+  std::vector<W4RP::RuntimeSignal> signals(TRACKS);
+  std::vector<W4RP::RuntimeLogTrack> tracks;
+  for (size_t i = 0; i < TRACKS; i++) {
+    W4RP::RuntimeSignal &sig = signals[i];
+    sig.canId = 0x100 + i;
+    sig.startBit = 0;
+    sig.bitLength = 16;
+    sig.bigEndian = false;
+    sig.isSigned = false;
+    sig.factor = SOURCES[i].factor;
+    sig.offset = SOURCES[i].offset;
+    sig.everSet = true;
+    tracks.push_back({(uint16_t)i, PERIOD_MS});
+  }
+
+  W4RP::SignalHistory history;
+  history.begin(&storage, segments);
+  history.configure(tracks, signals, 1);
+
+  // Log; keep every sample of track 0 for the read-back check
+  std::mt19937 rng(1);
+  std::vector<Sample> expected;
+  uint32_t steps = (uint32_t)(hours * 3600.0);
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t s = 0; s < steps; s++) {
+    for (size_t i = 0; i < TRACKS; i++)
+      signals[i].value = next(SOURCES[i], rng, s);
+    uint32_t nowMs = s * PERIOD_MS;
+    history.service(signals, nowMs);
+    expected.push_back({history.getLogTime(nowMs), signals[0].value});
+  }
+  history.flush();
+  auto end = std::chrono::steady_clock::now();
+
+  const W4RP::SignalHistoryStats &st = history.getStats();
+  double bitsPerSample = st.payloadBytes * 8.0 / st.samples;
+  double segmentsPerHour = st.segmentsWritten / hours;
+  printf("%u samples (%zu tracks at %u ms, %.1f h), %u segments\n",
+         st.samples, TRACKS, PERIOD_MS, hours, st.segmentsWritten);
+  printf("  %.1f bits/sample, %.0f segments/h, %.0f KB/h written\n",
+         bitsPerSample, segmentsPerHour, st.flashBytes / hours / 1024.0);
+  printf("  service+seal %.0f ns/sample\n",
+         host::elapsedNs(start, end) / st.samples);
+  printf("  %4d segments keep %.2f h\n", HISTORY_DEFAULT_SEGMENTS,
+         HISTORY_DEFAULT_SEGMENTS / segmentsPerHour);
+  if (segments != HISTORY_DEFAULT_SEGMENTS)
+    printf("  %4zu segments keep %.2f h\n", segments,
+           segments / segmentsPerHour);
+
+  // Newest samples back (all of them if the segments hold the span)
+  uint32_t key = W4RP::SignalHistory::signalKey(signals[0]);
+  bool fits = st.segmentsWritten <= segments;
+  start = std::chrono::steady_clock::now();
+  std::vector<Sample> got = readBack(history, key);
+  end = std::chrono::steady_clock::now();
+  CHECK(isTail(got, expected));
+  CHECK(!fits || got.size() == expected.size());
+  printf("  track 0 reads back %.2f h in %.2f ms\n",
+         got.size() * PERIOD_MS / 3600000.0,
+         host::elapsedNs(start, end) / 1e6);
+
+  // Reboot: index rebuilt from segment headers
+  W4RP::SignalHistory rebooted;
+  start = std::chrono::steady_clock::now();
+  rebooted.begin(&storage, segments);
+  end = std::chrono::steady_clock::now();
+  std::vector<Sample> again = readBack(rebooted, key);
+  CHECK(again.size() == got.size() && isTail(again, expected));
+  printf("  begin() index rebuild: %.2f ms\n",
+         host::elapsedNs(start, end) / 1e6);
+
+  host::setQuiet(false);
+  return host::failures() ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file bench_hysteresis.cpp
+ * @brief HOST:bench_hysteresis - Rule flapping on a noisy rpm trace
+ *
+ * Resamples rpm from drive.log to 100 Hz with Gaussian noise and replays
+ * it against flap.wbp: on/off rule pairs around 3000 rpm built from GT/LE,
+ * HYSTERESIS, RISING/FALLING and debounced GT/LE. Each pair drives one
+ * capability whose p0 is the commanded state; the bench counts handler
+ * calls and state changes per pair and checks them against the same
+ * logic applied to the decoded values. It also checks that a debounced
+ * rule on an edge condition is rejected at load.
+ *
+ * Usage: bench_hysteresis fixture_dir drive.log [noise_rpm]
+ */
+
+#include "Harness.h"
+#include <cstdlib>
+#include <random>
+#include <string>
+
+namespace {
+
+constexpr uint32_t RPM_ID = 0x0C9;
+constexpr float RPM_FACTOR = 0.25f;
+constexpr float THRESHOLD = 3000.0f;
+constexpr float HYST_ON = 3100.0f;
+constexpr float HYST_OFF = 2900.0f;
+constexpr uint32_t STEP_MS = 10;
+
+/// @brief Commanded on/off state seen by one capability
+struct Relay {
+  const char *name;
+  uint32_t calls = 0;
+  uint32_t changes = 0; // Including the first command
+  int state = -1;
+};
+
+float rpmOf(const W4RP::CanFrame &frame) {
+  return (frame.data[2] | frame.data[3] << 8) * RPM_FACTOR;
+}
+
+/// @brief drive.log rpm frames, resampled every STEP_MS with noise
+std::vector<W4RP::CanFrame> noisyTrace(const std::vector<host::LogFrame> &log,
+                                       float noiseRpm) {
+  std::vector<const host::LogFrame *> rpm;
+  for (const host::LogFrame &entry : log) {
+    if (entry.frame.id == RPM_ID && !entry.frame.extended)
+      rpm.push_back(&entry);
+  }
+
+  std::mt19937 rng(62);
+  std::normal_distribution<float> noise(0.0f, noiseRpm);
+  std::vector<W4RP::CanFrame> trace;
+  for (size_t i = 1; i < rpm.size(); i++) {
+    float from = rpmOf(rpm[i - 1]->frame), to = rpmOf(rpm[i]->frame);
+    uint32_t span = rpm[i]->ms - rpm[i - 1]->ms;
+    for (uint32_t t = 0; t < span; t += STEP_MS) {
+      float value = from + (to - from) * t / span + noise(rng);
+      uint32_t raw = (uint32_t)std::max(0.0f, value / RPM_FACTOR);
+      W4RP::CanFrame frame = rpm[i - 1]->frame;
+      frame.data[2] = raw & 0xFF;
+      frame.data[3] = (raw >> 8) & 0xFF;
+      trace.push_back(frame);
+    }
+  }
+  return trace;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s fixture_dir drive.log [noise_rpm]\n", argv[0]);
+    return 2;
+  }
+  std::string dir = argv[1];
+  float noiseRpm = argc > 3 ? atof(argv[3]) : 40.0f;
+
+  std::vector<host::LogFrame> log;
+  std::vector<uint8_t> wbp, edgeDebounce;
+  if (!host::readCandump(argv[2], log) ||
+      !host::readFile((dir + "/flap.wbp").c_str(), wbp) ||
+      !host::readFile((dir + "/flap_edge_debounce.wbp").c_str(),
+                      edgeDebounce)) {
+    fprintf(stderr, "cannot read fixtures\n");
+    return 2;
+  }
+
+  W4RP::Engine engine;
+  Relay relays[] = {{"gt"}, {"hysteresis"}, {"edge"}, {"gt_debounced"}};
+  for (Relay &relay : relays) {
+    engine.registerCapability(relay.name, [&relay](const W4RP::ParamMap &p) {
+      int state = p.count("p0") && p.at("p0") == "1";
+      relay.calls++;
+      relay.changes += state != relay.state;
+      relay.state = state;
+    });
+  }
+
+  // RISING/FALLING last one cycle: debouncing one can never fire
+  host::setQuiet(true);
+  CHECK(!engine.loadRuleset(edgeDebounce.data(), edgeDebounce.size()));
+  host::setQuiet(false);
+
+  host::setMillis(0);
+  CHECK(engine.loadRuleset(wbp.data(), wbp.size()));
+
+  std::vector<W4RP::CanFrame> trace = noisyTrace(log, noiseRpm);
+  uint32_t crossings = 0, latchChanges = 0;
+  bool above = false, latched = false;
+  float prev = 0.0f;
+  for (size_t n = 0; n < trace.size(); n++) {
+    host::setMillis((uint32_t)(n + 1) * STEP_MS);
+    engine.processCanFrame(trace[n]);
+    engine.evaluateRules();
+
+    // Reference: threshold crossings and the hysteresis latch
+    float rpm = rpmOf(trace[n]);
+    if (n > 0 && (prev <= THRESHOLD) != (rpm <= THRESHOLD))
+      crossings++;
+    above = rpm > THRESHOLD;
+    bool wasLatched = latched;
+    if (!latched && rpm >= HYST_ON)
+      latched = true;
+    else if (latched && rpm <= HYST_OFF)
+      latched = false;
+    latchChanges += latched != wasLatched;
+    prev = rpm;
+  }
+
+  // GT/LE and HYSTERESIS command every cycle; edges only on a crossing
+  const Relay &gt = relays[0], &hyst = relays[1], &edge = relays[2];
+  CHECK(gt.calls == trace.size() && hyst.calls == trace.size());
+  CHECK(gt.changes == crossings + 1 && gt.state == (int)above);
+  CHECK(hyst.changes == latchChanges + 1 && hyst.state == (int)latched);
+  CHECK(edge.calls == crossings && edge.changes == crossings);
+  CHECK(hyst.changes < gt.changes);
+
+  printf("%zu rpm samples at %u ms, noise %.0f rpm; %u crossings of %.0f\n",
+         trace.size(), STEP_MS, noiseRpm, crossings, THRESHOLD);
+  printf("  %-14s %8s %8s\n", "pair", "calls", "changes");
+  for (const Relay &relay : relays)
+    printf("  %-14s %8u %8u\n", relay.name, relay.calls, relay.changes);
+  return host::failures() ? 1 : 0;
+}
@@ -0,0 +1,157 @@
+/**
+ * @file bench_j1939.cpp
+ * @brief HOST:bench_j1939 - PGN-masked signals on a replayed J1939 trace
+ *
+ * j1939.log sends each PGN from several source addresses (TSC1 also to
+ * two destinations) at different priorities, plus unmatched PGNs and
+ * 11-bit frames. j1939.wbp matches six signals on PGN; j1939_exact.wbp
+ * needs one exact-ID copy per sender for the same coverage. The bench
+ * checks that every frame of a signal's PGN updates it, whatever the
+ * source address, and nothing else does, then times processCanFrame().
+ *
+ * Usage: bench_j1939 fixture_dir [passes]
+ */
+
+#include "Harness.h"
+#include <cstdlib>
+#include <set>
+#include <string>
+
+namespace {
+
+/// @brief make_ruleset.py J1939_SIGNALS, in WBP order
+struct J1939Signal {
+  const char *name;
+  uint32_t pgn;
+  uint8_t startByte;
+  uint8_t bytes;
+  float factor;
+  float offset;
+};
+
+const J1939Signal SIGNALS[] = {
+    {"torque", 0xF004, 2, 1, 1.0f, -125.0f},
+    {"engine_speed", 0xF004, 3, 2, 0.125f, 0.0f},
+    {"wheel_speed", 0xFEF1, 1, 2, 1.0f / 256, 0.0f},
+    {"coolant", 0xFEEE, 0, 1, 1.0f, -40.0f},
+    {"brake_pedal", 0xF001, 1, 1, 0.4f, 0.0f},
+    {"requested_speed", 0x0000, 1, 2, 0.125f, 0.0f},
+};
+constexpr size_t SIGNAL_COUNT = sizeof(SIGNALS) / sizeof(SIGNALS[0]);
+
+/// @brief PGN of a 29-bit ID; PDU1 (PF < 240) drops the destination
+uint32_t pgnOf(uint32_t id) {
+  uint32_t pf = (id >> 16) & 0xFF;
+  return (id >> 8) & (pf < 240 ? 0x3FF00 : 0x3FFFF);
+}
+
+float decode(const J1939Signal &sig, const uint8_t *data) {
+  uint32_t raw = data[sig.startByte];
+  if (sig.bytes == 2)
+    raw |= data[sig.startByte + 1] << 8;
+  return (float)raw * sig.factor + sig.offset;
+}
+
+bool load(W4RP::Engine &engine, const std::string &path) {
+  std::vector<uint8_t> wbp;
+  return host::readFile(path.c_str(), wbp) &&
+         engine.loadRuleset(wbp.data(), wbp.size());
+}
+
+/// @brief Signal updates caused by one frame (lastUpdateMs == nowMs)
+size_t updatesAt(const W4RP::Engine &engine, uint32_t nowMs) {
+  size_t n = 0;
+  for (const W4RP::RuntimeSignal &sig : engine.getSignals())
+    n += sig.everSet && sig.lastUpdateMs == nowMs;
+  return n;
+}
+
+double nsPerFrame(W4RP::Engine &engine, const std::vector<host::LogFrame> &log,
+                  int passes) {
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    for (const host::LogFrame &entry : log)
+      engine.processCanFrame(entry.frame);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return host::elapsedNs(start, end) / ((double)passes * log.size());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s fixture_dir [passes]\n", argv[0]);
+    return 2;
+  }
+  std::string dir = argv[1];
+  int passes = argc > 2 ? atoi(argv[2]) : 200;
+
+  std::vector<host::LogFrame> log;
+  if (!host::readCandump((dir + "/j1939.log").c_str(), log)) {
+    fprintf(stderr, "cannot read %s/j1939.log\n", dir.c_str());
+    return 2;
+  }
+
+  host::setQuiet(true);
+  W4RP::Engine masked, exact;
+  bool loaded = load(masked, dir + "/j1939.wbp") &&
+                load(exact, dir + "/j1939_exact.wbp");
+  host::setQuiet(false);
+  CHECK(loaded);
+  CHECK(masked.getSignalCount() == SIGNAL_COUNT);
+  if (!loaded || masked.getSignalCount() != SIGNAL_COUNT)
+    return 1;
+
+  // Frame n is replayed at n + 1 ms, so lastUpdateMs names the frame
+  std::set<uint8_t> sources[SIGNAL_COUNT];
+  size_t maskedUpdates = 0, exactUpdates = 0, foreign = 0, wrong = 0;
+  for (size_t n = 0; n < log.size(); n++) {
+    const W4RP::CanFrame &frame = log[n].frame;
+    uint32_t now = (uint32_t)n + 1;
+    host::setMillis(now);
+    masked.processCanFrame(frame);
+    exact.processCanFrame(frame);
+
+    bool anyMatch = false;
+    for (size_t s = 0; s < SIGNAL_COUNT; s++) {
+      const J1939Signal &def = SIGNALS[s];
+      const W4RP::RuntimeSignal &sig = masked.getSignals()[s];
+      bool match = frame.extended && pgnOf(frame.id) == def.pgn;
+      bool updated = sig.everSet && sig.lastUpdateMs == now;
+      anyMatch |= match;
+      if (updated != match && wrong++ < 5)
+        fprintf(stderr, "frame %zu (%08X): %s %s\n", n, frame.id, def.name,
+                match ? "missed" : "matched a foreign frame");
+      if (!match || !updated)
+        continue;
+      CHECK(fabsf(sig.value - decode(def, frame.data)) <= 1e-3f);
+      sources[s].insert(frame.id & 0xFF);
+      maskedUpdates++;
+    }
+    foreign += !anyMatch;
+    exactUpdates += updatesAt(exact, now);
+  }
+
+  // Every sender of a PGN reaches its signals; both tables agree
+  CHECK(wrong == 0);
+  for (size_t s = 0; s < SIGNAL_COUNT; s++)
+    CHECK(!sources[s].empty());
+  CHECK(sources[1].size() == 2); // EEC1 from 0x00 and 0x01
+  CHECK(sources[2].size() == 3); // CCVS from 0x00, 0x0B (prio 6), 0x17 (7)
+  CHECK(sources[5].size() == 2); // TSC1 from 0x03 and 0x27, to 0x00/0x0F
+  CHECK(maskedUpdates == exactUpdates);
+  CHECK(foreign > 0);
+
+  nsPerFrame(masked, log, 1); // Warm caches
+  double maskedNs = nsPerFrame(masked, log, passes);
+  double exactNs = nsPerFrame(exact, log, passes);
+
+  printf("%zu frames (%zu without a matching PGN) x %d passes\n", log.size(),
+         foreign, passes);
+  printf("  PGN-masked %3zu signals %8.1f ns/frame\n", masked.getSignalCount(),
+         maskedNs);
+  printf("  exact IDs  %3zu signals %8.1f ns/frame\n", exact.getSignalCount(),
+         exactNs);
+  return host::failures() ? 1 : 0;
+}
@@ -0,0 +1,201 @@
+/**
+ * @file bench_tx.cpp
+ * @brief HOST:bench_tx - TxScheduler jitter on a mock bus
+ *
+ * First checks ordering: equal deadlines go out by priority, an earlier
+ * deadline beats a higher priority, and a refused transmit keeps the head
+ * frame. Then runs eight periodic frames plus one-shots for a minute of
+ * stub time per scenario (loop rate, loop stalls, congested bus) and
+ * reports TxSchedulerStats lateness and the period jitter seen on the bus.
+ *
+ * Usage: bench_tx [seconds]
+ */
+
+#include "Harness.h"
+#include "MockCan.h"
+#include <cstdlib>
+#include <map>
+#include <random>
+
+namespace {
+
+W4RP::CanFrame frameFor(uint32_t id) {
+  W4RP::CanFrame frame = {};
+  frame.id = id;
+  frame.dlc = 8;
+  return frame;
+}
+
+std::vector<uint32_t> sentIds(const host::MockCan &bus) {
+  std::vector<uint32_t> ids;
+  for (const host::MockCan::SentFrame &s : bus.sent())
+    ids.push_back(s.frame.id);
+  return ids;
+}
+
+void checkOrdering() {
+  host::MockCan bus;
+  bus.begin();
+  W4RP::TxScheduler tx;
+
+  // Equal deadlines: priority order, TX_SCHEDULER_MAX_PER_SERVICE per call
+  host::setMillis(0);
+  const uint8_t priorities[] = {3, 1, 5, 0, 2, 4};
+  for (uint8_t p : priorities)
+    tx.sendOnce(frameFor(0x100 + p), p);
+  tx.service(bus, 0);
+  CHECK((sentIds(bus) == std::vector<uint32_t>{0x100, 0x101, 0x102, 0x103}));
+  tx.service(bus, 0);
+  CHECK(sentIds(bus).size() == 6 && sentIds(bus)[4] == 0x104 &&
+        sentIds(bus)[5] == 0x105);
+  CHECK(tx.getActiveCount() == 0);
+
+  // A (10 ms, priority 5) and B (15 ms, priority 0), both due at 0
+  bus.clearSent();
+  tx.schedulePeriodic(frameFor(0xA), 10, 5);
+  tx.schedulePeriodic(frameFor(0xB), 15, 0);
+  tx.service(bus, 0);
+  CHECK((sentIds(bus) == std::vector<uint32_t>{0xB, 0xA}));
+
+  // Backlog at 25: A@10, B@15, A@20 - deadline first, whatever the priority
+  bus.clearSent();
+  tx.service(bus, 25);
+  CHECK((sentIds(bus) == std::vector<uint32_t>{0xA, 0xB, 0xA}));
+
+  // A@30 and B@30 tie: priority decides
+  bus.clearSent();
+  tx.service(bus, 30);
+  CHECK((sentIds(bus) == std::vector<uint32_t>{0xB, 0xA}));
+
+  // Refused at 40: A stays at the head and goes out one loop later
+  bus.clearSent();
+  bus.refuseTransmit(1);
+  uint32_t deferred = tx.getStats().deferred;
+  tx.service(bus, 40);
+  CHECK(bus.sent().empty() && tx.getStats().deferred == deferred + 1);
+  tx.service(bus, 41);
+  CHECK((sentIds(bus) == std::vector<uint32_t>{0xA}));
+}
+
+struct Scenario {
+  const char *name;
+  uint32_t loopMs;   // service() interval
+  uint32_t stallMs;  // Extra loop stall, once per stallEveryMs
+  uint32_t stallEveryMs;
+  uint32_t txDepth;  // Controller TX queue
+  uint32_t txPerMs;  // Frames the bus drains per ms
+};
+
+// TWAICanBus default TX queue: 16 frames; 500 kbit/s drains about 4/ms
+const Scenario SCENARIOS[] = {
+    {"500 kbit/s, 1 ms loop", 1, 0, 0, 16, 4},
+    {"500 kbit/s, 5 ms loop", 5, 0, 0, 16, 4},
+    {"500 kbit/s, 1 ms loop, 20 ms stall every 500 ms", 1, 20, 500, 16, 4},
+    {"congested: 1 frame/ms free, 2-deep queue", 1, 0, 0, 2, 1},
+};
+
+const uint32_t PERIODS[] = {10, 10, 20, 50, 100, 100, 200, 1000};
+constexpr size_t PERIODIC_COUNT = sizeof(PERIODS) / sizeof(PERIODS[0]);
+constexpr uint32_t PERIODIC_BASE = 0x500;
+constexpr uint32_t ONESHOT_ID = 0x600;
+
+void run(const Scenario &sc, uint32_t seconds) {
+  host::setMillis(0);
+  host::MockCan bus;
+  bus.begin();
+  bus.setTxQueue(sc.txDepth, sc.txPerMs);
+  W4RP::TxScheduler tx;
+  for (size_t i = 0; i < PERIODIC_COUNT; i++)
+    tx.schedulePeriodic(frameFor(PERIODIC_BASE + i), PERIODS[i], i % 4);
+
+  std::mt19937 rng(54);
+  std::vector<uint32_t> oneShotQueuedMs;
+  uint32_t endMs = seconds * 1000;
+  uint32_t nextOneShot = 37;
+  double serviceNs = 0.0;
+  uint32_t services = 0;
+  for (uint32_t now = 0; now < endMs; now += sc.loopMs) {
+    if (sc.stallEveryMs && now % sc.stallEveryMs == 0 && now > 0)
+      now += sc.stallMs;
+    host::setMillis(now);
+    while (now >= nextOneShot) {
+      // Stamped with the time it is handed over (after any stall)
+      if (tx.sendOnce(frameFor(ONESHOT_ID), 0) >= 0)
+        oneShotQueuedMs.push_back(now);
+      nextOneShot += 20 + rng() % 40;
+    }
+    auto start = std::chrono::steady_clock::now();
+    tx.service(bus, now);
+    auto end = std::chrono::steady_clock::now();
+    serviceNs += host::elapsedNs(start, end);
+    services++;
+  }
+
+  // Period jitter per ID from the bus side; one-shot queueing delay
+  std::map<uint32_t, uint32_t> lastMs, count;
+  uint32_t maxJitter = 0, maxOneShotDelay = 0;
+  size_t oneShots = 0;
+  for (const host::MockCan::SentFrame &s : bus.sent()) {
+    uint32_t id = s.frame.id;
+    if (id == ONESHOT_ID) {
+      if (oneShots < oneShotQueuedMs.size())
+        maxOneShotDelay = std::max(maxOneShotDelay,
+                                   s.ms - oneShotQueuedMs[oneShots]);
+      oneShots++;
+      continue;
+    }
+    uint32_t period = PERIODS[id - PERIODIC_BASE];
+    if (count[id]++ > 0) {
+      uint32_t interval = s.ms - lastMs[id];
+      uint32_t jitter = interval > period ? interval - period
+                                          : period - interval;
+      maxJitter = std::max(maxJitter, jitter);
+    }
+    lastMs[id] = s.ms;
+  }
+
+  // Every periodic frame keeps its rate, except that a stall of two periods
+  // or more resyncs the slot and skips the frames it spans; every one-shot
+  // goes out
+  const W4RP::TxSchedulerStats &st = tx.getStats();
+  uint32_t stalls = sc.stallEveryMs ? (endMs - 1) / sc.stallEveryMs : 0;
+  for (size_t i = 0; i < PERIODIC_COUNT; i++) {
+    uint32_t expected = endMs / PERIODS[i];
+    if (sc.stallMs >= 2 * PERIODS[i])
+      expected -= stalls * (sc.stallMs / PERIODS[i]);
+    uint32_t got = count[PERIODIC_BASE + i];
+    CHECK(got + 2 >= expected && got <= expected + 1);
+  }
+  CHECK(oneShots == oneShotQueuedMs.size());
+  CHECK(st.rejected == 0);
+  CHECK(st.sent == bus.getSentCount());
+  CHECK(st.deferred == bus.getRefusedCount());
+
+  printf("%s\n", sc.name);
+  printf("  sent %u, deferred %u; lateness max %u ms, mean %.3f ms\n",
+         st.sent, st.deferred, st.maxLatenessMs,
+         st.sent ? (double)st.totalLatenessMs / st.sent : 0.0);
+  printf("  period jitter max %u ms; one-shot delay max %u ms; "
+         "service() %.0f ns\n",
+         maxJitter, maxOneShotDelay, serviceNs / services);
+
+  // 1 ms loop, free bus: lateness only from TX_SCHEDULER_MAX_PER_SERVICE,
+  // when every periodic (plus a one-shot) falls due on the same ms
+  if (sc.loopMs == 1 && sc.stallMs == 0 && sc.txPerMs >= 4) {
+    uint32_t burstMs = PERIODIC_COUNT / TX_SCHEDULER_MAX_PER_SERVICE;
+    CHECK(st.deferred == 0);
+    CHECK(st.maxLatenessMs <= burstMs);
+    CHECK(maxJitter <= burstMs);
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  uint32_t seconds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 60;
+
+  checkOrdering();
+  for (const Scenario &sc : SCENARIOS)
+    run(sc, seconds);
+  return host::failures() ? 1 : 0;
+}
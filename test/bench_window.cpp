@@ -0,0 +1,294 @@
+/**
+ * @file bench_window.cpp
+ * @brief HOST:bench_window - Window aggregates on high-rate signals
+ *
+ * Feeds a noisy wheel-speed signal at 100 Hz to 5 kHz into WindowAggregate
+ * for windows of 100 ms to 10 s, checking AVG, MIN, MAX and STDDEV after
+ * every sample against a double-precision reference over the same buckets,
+ * and times add() and get(). Then replays the signal at 1 kHz through the
+ * Engine with window.wbp (one window per operator) and window_plain.wbp
+ * (the same comparisons on the raw value): each rule must fire exactly
+ * when its reference aggregate passes, and the per-frame cost is compared.
+ *
+ * Usage: bench_window fixture_dir [seconds]  (at least 20: one full sweep)
+ */
+
+#include "Harness.h"
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <set>
+#include <string>
+
+namespace {
+
+constexpr uint32_t WHEEL_ID = 0x200;
+constexpr float WHEEL_FACTOR = 0.01f;
+
+/// @brief 75 km/h +- 60 over 20 s, Gaussian noise, rare spikes
+struct WheelSpeed {
+  std::mt19937 rng{60};
+  std::normal_distribution<float> noise{0.0f, 3.0f};
+
+  float at(uint32_t us) {
+    float v = 75.0f + 60.0f * sinf(2.0f * (float)M_PI * us / 20e6f);
+    v += noise(rng);
+    if (rng() % 2000 == 0)
+      v += 40.0f;
+    // Quantized as the CAN signal is, so both paths see the same values
+    return roundf(std::max(0.0f, std::min(v, 655.0f)) / WHEEL_FACTOR) *
+           WHEEL_FACTOR;
+  }
+};
+
+/// @brief Samples of the current bucket and the previous WINDOW_BUCKETS - 1
+class Reference {
+public:
+  explicit Reference(uint32_t windowMs)
+      : bucketMs_((windowMs + WINDOW_BUCKETS - 1) / WINDOW_BUCKETS) {}
+
+  void add(uint32_t nowMs, float value) {
+    uint32_t slot = nowMs / bucketMs_;
+    while (!samples_.empty() &&
+           samples_.front().first + WINDOW_BUCKETS <= slot) {
+      remove(samples_.front().second);
+      samples_.pop_front();
+    }
+    samples_.push_back({slot, value});
+    sum_ += value;
+    sumSq_ += (double)value * value;
+    values_.insert(value);
+  }
+
+  double avg() const { return sum_ / samples_.size(); }
+  double stddev() const {
+    double mean = avg();
+    double var = sumSq_ / samples_.size() - mean * mean;
+    return var > 0.0 ? sqrt(var) : 0.0;
+  }
+  float min() const { return *values_.begin(); }
+  float max() const { return *values_.rbegin(); }
+
+private:
+  uint32_t bucketMs_;
+  std::deque<std::pair<uint32_t, float>> samples_;
+  std::multiset<float> values_;
+  double sum_ = 0.0, sumSq_ = 0.0;
+
+  void remove(float value) {
+    sum_ -= value;
+    sumSq_ -= (double)value * value;
+    values_.erase(values_.find(value));
+  }
+};
+
+/// @brief Check every query of one rate/window pair
+void checkWindow(uint32_t rateHz, uint32_t windowMs, uint32_t seconds) {
+  std::vector<W4RP::WindowBucket> arena(WINDOW_BUCKETS);
+  W4RP::WindowAggregate window;
+  window.init(arena.data(), windowMs);
+  Reference ref(windowMs);
+  WheelSpeed wheel;
+
+  double avgErr = 0.0, sdErr = 0.0;
+  size_t extremeErr = 0;
+  uint32_t samples = rateHz * seconds;
+  for (uint32_t i = 0; i < samples; i++) {
+    uint32_t us = (uint32_t)((uint64_t)i * 1000000 / rateHz);
+    float value = wheel.at(us);
+    window.add(us / 1000, value);
+    ref.add(us / 1000, value);
+
+    float avg, mn, mx, sd;
+    window.get(W4RP::Operation::AVG, avg);
+    window.get(W4RP::Operation::MIN, mn);
+    window.get(W4RP::Operation::MAX, mx);
+    window.get(W4RP::Operation::STDDEV, sd);
+    avgErr = std::max(avgErr, fabs(avg - ref.avg()));
+    sdErr = std::max(sdErr, fabs(sd - ref.stddev()));
+    extremeErr += mn != ref.min() || mx != ref.max();
+  }
+
+  // MIN/MAX are exact; sums stay within float resolution of the signal
+  CHECK(extremeErr == 0);
+  CHECK(avgErr < 0.01);
+  CHECK(sdErr < 0.01);
+  printf("  %5u Hz %6u ms: %7u samples, max error avg %.5f stddev %.5f\n",
+         rateHz, windowMs, samples, avgErr, sdErr);
+}
+
+/// @brief add() per sample and get() per query, in ns
+void timeWindow(uint32_t rateHz, uint32_t windowMs, uint32_t seconds) {
+  std::vector<W4RP::WindowBucket> arena(WINDOW_BUCKETS);
+  W4RP::WindowAggregate window;
+  window.init(arena.data(), windowMs);
+  WheelSpeed wheel;
+  uint32_t samples = rateHz * seconds;
+  std::vector<float> values(samples);
+  for (uint32_t i = 0; i < samples; i++)
+    values[i] = wheel.at((uint32_t)((uint64_t)i * 1000000 / rateHz));
+
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < samples; i++)
+    window.add((uint32_t)((uint64_t)i * 1000 / rateHz), values[i]);
+  auto mid = std::chrono::steady_clock::now();
+  volatile float sink = 0.0f;
+  float out;
+  for (uint32_t i = 0; i < samples; i++) {
+    window.advance(seconds * 1000 + i % 16);
+    for (W4RP::Operation op :
+         {W4RP::Operation::AVG, W4RP::Operation::MIN, W4RP::Operation::MAX,
+          W4RP::Operation::STDDEV})
+      sink = sink + (window.get(op, out) ? out : 0.0f);
+  }
+  auto end = std::chrono::steady_clock::now();
+  printf("  %5u Hz %6u ms: add() %5.1f ns, advance() + 4 x get() %5.1f ns\n",
+         rateHz, windowMs, host::elapsedNs(start, mid) / samples,
+         host::elapsedNs(mid, end) / samples);
+}
+
+/// @brief WINDOW_CONDITIONS in make_ruleset.py
+struct WindowRule {
+  W4RP::Operation op;
+  float threshold;
+  uint32_t windowMs;
+  const char *cap;
+};
+
+const WindowRule RULES[] = {
+    {W4RP::Operation::AVG, 80.0f, 1000, "avg"},       // > 80
+    {W4RP::Operation::MIN, 20.0f, 1000, "min"},       // < 20
+    {W4RP::Operation::MAX, 140.0f, 10000, "max"},     // >= 140
+    {W4RP::Operation::STDDEV, 5.0f, 100, "stddev"},   // > 5
+};
+constexpr size_t RULE_COUNT = sizeof(RULES) / sizeof(RULES[0]);
+
+std::vector<W4RP::CanFrame> wheelFrames(uint32_t seconds) {
+  WheelSpeed wheel;
+  std::vector<W4RP::CanFrame> frames;
+  for (uint32_t ms = 0; ms < seconds * 1000; ms++) {
+    uint32_t raw = lroundf(wheel.at(ms * 1000) / WHEEL_FACTOR);
+    W4RP::CanFrame f = {};
+    f.id = WHEEL_ID;
+    f.dlc = 8;
+    f.data[0] = raw & 0xFF;
+    f.data[1] = raw >> 8;
+    frames.push_back(f);
+  }
+  return frames;
+}
+
+bool load(W4RP::Engine &engine, const std::string &path,
+          uint32_t (&calls)[RULE_COUNT]) {
+  for (size_t r = 0; r < RULE_COUNT; r++)
+    engine.registerCapability(RULES[r].cap,
+                              [&calls, r](const W4RP::ParamMap &) {
+                                calls[r]++;
+                              });
+  std::vector<uint8_t> wbp;
+  host::setQuiet(true);
+  bool ok = host::readFile(path.c_str(), wbp) &&
+            engine.loadRuleset(wbp.data(), wbp.size());
+  host::setQuiet(false);
+  return ok;
+}
+
+/// @brief Rules fire exactly when the reference passes (away from the edge)
+void checkEngine(const std::string &dir,
+                 const std::vector<W4RP::CanFrame> &frames) {
+  uint32_t calls[RULE_COUNT] = {};
+  W4RP::Engine engine;
+  host::setMillis(0);
+  CHECK(load(engine, dir + "/window.wbp", calls));
+
+  std::vector<Reference> refs;
+  for (const WindowRule &rule : RULES)
+    refs.emplace_back(rule.windowMs);
+
+  size_t wrong = 0, nearEdge = 0, fired[RULE_COUNT] = {};
+  for (size_t n = 0; n < frames.size(); n++) {
+    uint32_t now = (uint32_t)n;
+    host::setMillis(now);
+    uint32_t before[RULE_COUNT];
+    std::copy(calls, calls + RULE_COUNT, before);
+    engine.processCanFrame(frames[n]);
+    engine.evaluateRules();
+
+    float value = (frames[n].data[0] | frames[n].data[1] << 8) * WHEEL_FACTOR;
+    for (size_t r = 0; r < RULE_COUNT; r++) {
+      refs[r].add(now, value);
+      double agg = RULES[r].op == W4RP::Operation::AVG ? refs[r].avg()
+                   : RULES[r].op == W4RP::Operation::MIN ? refs[r].min()
+                   : RULES[r].op == W4RP::Operation::MAX ? refs[r].max()
+                                                          : refs[r].stddev();
+      bool expected = RULES[r].op == W4RP::Operation::MIN
+                          ? agg < RULES[r].threshold
+                      : RULES[r].op == W4RP::Operation::MAX
+                          ? agg >= RULES[r].threshold
+                          : agg > RULES[r].threshold;
+      bool got = calls[r] != before[r];
+      fired[r] += got;
+      if (fabs(agg - RULES[r].threshold) < 1e-3) {
+        nearEdge++;
+        continue;
+      }
+      if (got != expected && wrong++ < 5)
+        fprintf(stderr, "%u ms: %s %s (reference %.4f)\n", now,
+                RULES[r].cap, got ? "fired" : "missed", agg);
+    }
+  }
+  CHECK(wrong == 0);
+  for (size_t r = 0; r < RULE_COUNT; r++)
+    CHECK(fired[r] > 0 && fired[r] < frames.size());
+  printf("Engine, 1 kHz: rules fired avg %zu, min %zu, max %zu, stddev %zu "
+         "of %zu frames (%zu comparisons at the threshold skipped)\n",
+         fired[0], fired[1], fired[2], fired[3], frames.size(), nearEdge);
+}
+
+double engineNs(const std::string &path,
+                const std::vector<W4RP::CanFrame> &frames) {
+  uint32_t calls[RULE_COUNT] = {};
+  W4RP::Engine engine;
+  host::setMillis(0);
+  CHECK(load(engine, path, calls));
+  auto start = std::chrono::steady_clock::now();
+  for (size_t n = 0; n < frames.size(); n++) {
+    host::setMillis((uint32_t)n);
+    engine.processCanFrame(frames[n]);
+    engine.evaluateRules();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return host::elapsedNs(start, end) / frames.size();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s fixture_dir [seconds]\n", argv[0]);
+    return 2;
+  }
+  std::string dir = argv[1];
+  uint32_t seconds = argc > 2 ? strtoul(argv[2], nullptr, 10) : 60;
+
+  const uint32_t RATES[] = {100, 1000, 5000};
+  const uint32_t WINDOWS[] = {100, 1000, 10000};
+  printf("WindowAggregate vs double reference, %u s:\n", seconds);
+  for (uint32_t rate : RATES)
+    for (uint32_t windowMs : WINDOWS)
+      checkWindow(rate, windowMs, seconds);
+  printf("WindowAggregate cost:\n");
+  for (uint32_t windowMs : WINDOWS)
+    timeWindow(5000, windowMs, seconds);
+
+  std::vector<W4RP::CanFrame> frames = wheelFrames(seconds);
+  checkEngine(dir, frames);
+  engineNs(dir + "/window.wbp", frames); // Warm caches
+  double windowNs = engineNs(dir + "/window.wbp", frames);
+  double plainNs = engineNs(dir + "/window_plain.wbp", frames);
+  printf("processCanFrame() + evaluateRules() per frame: 4 windows %.1f ns, "
+         "raw comparisons %.1f ns\n",
+         windowNs, plainNs);
+  return host::failures() ? 1 : 0;
+}
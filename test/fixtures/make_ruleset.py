@@ -0,0 +1,453 @@
+#!/usr/bin/env python3
+"""make_ruleset - Write the WBP v2 rulesets used by the host harness.
+
+Usage: make_ruleset.py OUTDIR
+
+drive.wbp    Passenger car rules over the IDs in drive.log: aligned and
+             unaligned layouts, both byte orders, signed fields, signal
+             operands, debounce and cooldown. wbp2cpp compiles it.
+decode_<layout>.wbp, decode_<layout>_shift.wbp
+             One signal per ID on 0x100-0x10F, on a byte boundary or one
+             bit later (generic decoder), for bench_decode.
+j1939.log    10 s of J1939 traffic: the same PGNs from several source
+             addresses (and destinations for PDU1), priorities that differ
+             per sender, unmatched PGNs and 11-bit frames, candump -L.
+j1939.wbp    J1939 signals matched on PGN (signal flag bit 2).
+j1939_exact.wbp
+             The same signals, one exact-ID copy per ID in j1939.log.
+diag.wbp     Diagnostic polls (DIAG_POLLS) answered by test_diag's
+             simulated ECU: single frame, multi-frame past the sequence
+             wrap, response pending, silence, oversize, negative response,
+             a full buffer and 29-bit IDs.
+flap.wbp     rpm from drive.log against 3000 rpm as GT/LE, HYSTERESIS,
+             RISING/FALLING and debounced GT/LE on-off pairs, for
+             bench_hysteresis.
+flap_edge_debounce.wbp
+             A debounced RISING rule, which the loader must reject.
+window.wbp   AVG, MIN, MAX and STDDEV windows on one signal, for
+             bench_window; window_plain.wbp compares the raw value.
+derived.wbp  drive.wbp signals plus a derived signal DAG over them
+             (DERIVED_NODES), listed out of order so the loader must sort
+             it; derived_none.wbp has the signals only, for bench_derived.
+derived_chain.wbp, derived_fan.wbp
+             drive.wbp signals plus 64 SCALE nodes on rpm, chained or all
+             reading rpm.
+derived_cycle.wbp
+             Two nodes reading each other, which the loader must reject.
+gpio.wbp     gpio_set, gpio_pulse and pwm_duty rules on drive.wbp signals,
+             for bench_gpio; gpio_bad_pin.wbp drives a pin outside the mask.
+"""
+
+import os
+import random
+import struct
+import sys
+import zlib
+
+WBP_MAGIC_RULES = 0xC0DE5702
+WBP_VERSION = 0x02
+BE = 0x01
+SIGNED = 0x02
+J1939 = 0x04
+OPERAND = 0x80
+HAS_EXT = 0x04
+EXT_DIAG_POLLS = 0x03
+EXT_DERIVED = 0x05
+
+EQ, NE, GT, GE, LT, LE, WITHIN, OUTSIDE = range(8)
+W_AVG, W_MIN, W_MAX, W_STDDEV = range(9, 13)
+HYSTERESIS, RISING, FALLING = 13, 14, 15
+INT, FLOAT, STRING = 0, 1, 2
+ADD, SUB, MUL, DIV, SCALE, EMA, LOWPASS, DERIVATIVE = range(8)
+
+# name: (can_id, start, length, flags, factor, offset)
+DRIVE_SIGNALS = [
+    ("rpm", 0x0C9, 16, 16, 0, 0.25, 0.0),
+    ("throttle", 0x0C9, 8, 8, 0, 0.4, 0.0),
+    ("coolant", 0x4C1, 0, 8, 0, 1.0, -40.0),
+    ("speed", 0x3E9, 0, 16, 0, 0.01, 0.0),
+    ("gear", 0x3E9, 20, 4, 0, 1.0, 0.0),
+    ("steering", 0x1E5, 15, 16, BE | SIGNED, 0.1, 0.0),
+    ("yaw", 0x1E5, 29, 12, BE | SIGNED, 0.05, 0.0),
+    ("brake_pressure", 0x0F1, 3, 10, 0, 0.2, 0.0),
+    ("brake_switch", 0x0F1, 0, 1, 0, 1.0, 0.0),
+    ("battery", 0x3D1, 32, 32, 0, 0.001, 0.0),
+    ("ambient", 0x4C1, 8, 8, SIGNED, 0.5, 0.0),
+    ("fuel", 0x4C1, 16, 8, 0, 0.4, 0.0),
+    ("wheel_fl", 0x348, 0, 16, 0, 0.01, 0.0),
+    ("wheel_fr", 0x348, 16, 16, 0, 0.01, 0.0),
+    ("lat_accel", 0x1E5, 32, 16, SIGNED, 0.001, 0.0),
+    ("odometer", 0x3D1, 0, 32, 0, 0.1, 0.0),
+]
+
+# (signal, op, value1, value2) or (signal, op | OPERAND, offset, signal2);
+# window ops: (signal, op, value1, window ms, compare)
+DRIVE_CONDITIONS = [
+    ("rpm", GT, 3000.0, 0.0),              # 0
+    ("throttle", GE, 80.0, 0.0),           # 1
+    ("coolant", GT, 100.0, 0.0),           # 2
+    ("speed", GT, 120.0, 0.0),             # 3
+    ("gear", EQ, 0.0, 0.0),                # 4
+    ("steering", OUTSIDE, -90.0, 90.0),    # 5
+    ("yaw", WITHIN, -5.0, 5.0),            # 6
+    ("brake_pressure", GT, 40.0, 0.0),     # 7
+    ("brake_switch", EQ, 1.0, 0.0),        # 8
+    ("battery", LT, 11.8, 0.0),            # 9
+    ("ambient", LE, 3.0, 0.0),             # 10
+    ("fuel", LT, 15.0, 0.0),               # 11
+    ("wheel_fl", GT | OPERAND, 2.0, "wheel_fr"),  # 12
+    ("wheel_fr", GT | OPERAND, 2.0, "wheel_fl"),  # 13
+    ("lat_accel", OUTSIDE, -0.4, 0.4),     # 14
+    ("speed", LT, 5.0, 0.0),               # 15
+    ("rpm", LT, 900.0, 0.0),               # 16
+    ("speed", NE, 0.0, 0.0),               # 17
+    ("throttle", LE, 2.0, 0.0),            # 18
+    ("gear", GE, 5.0, 0.0),                # 19
+    ("rpm", LT, 1300.0, 0.0),              # 20
+]
+
+# (conditions, debounce ms, cooldown ms, actions); v2 times stop at 2550 ms
+DRIVE_RULES = [
+    ([0, 1], 200, 1000, [("warn", [(INT, 1)])]),
+    ([2], 2000, 0, [("warn", [(INT, 2)]), ("fan", [(FLOAT, 75.5)])]),
+    ([3], 0, 2500, [("chime", [(INT, 1)]),
+                    ("display", [(STRING, "SLOW DOWN")])]),
+    ([7, 8, 17], 0, 0, [("brake_light", [(INT, 1)])]),
+    ([5, 17], 0, 500, [("warn", [(INT, 5)])]),
+    ([9], 2500, 0, [("warn", [(INT, 6)])]),
+    ([10], 0, 2500, [("chime", [(INT, 2)])]),
+    ([11], 0, 2500, [("warn", [(INT, 7)])]),
+    ([12], 100, 0, [("traction", [(INT, 0)])]),
+    ([13], 100, 0, [("traction", [(INT, 1)])]),
+    ([6, 14, 17], 0, 0, [("warn", [(INT, 10)])]),
+    ([15, 16, 18, 4], 2500, 0, [("idle", [(INT, 1)])]),
+    ([19, 20, 17], 500, 2000, [("warn", [(INT, 12)])]),
+]
+
+
+def build(signals, conditions, rules, ext=()):
+    """WBP v2 binary: header, tables, extensions, string table (no META).
+
+    ext holds (section type, payload) pairs.
+    """
+    index = {s[0]: i for i, s in enumerate(signals)}
+    strings = b"\0"
+    string_offsets = {}
+
+    def string(s):
+        nonlocal strings
+        if s not in string_offsets:
+            string_offsets[s] = len(strings)
+            strings += s.encode() + b"\0"
+        return string_offsets[s]
+
+    body = b"".join(struct.pack("<IHBBff", *s[1:]) for s in signals)
+    for sig, op, v1, v2, *compare in conditions:
+        sig2 = 0
+        if op & OPERAND:
+            sig2, v2 = index[v2], 0.0
+        body += struct.pack("<BBBBff", index[sig], op, compare[0] if compare
+                            else 0, sig2, v1, v2)
+
+    actions = b""
+    params = []
+    action_count = 0
+    rule_table = b""
+    for conds, debounce, cooldown, rule_actions in rules:
+        mask = sum(1 << c for c in conds)
+        rule_table += struct.pack("<HIBBBB", 0, mask, action_count,
+                                  len(rule_actions), debounce // 10,
+                                  cooldown // 10)
+        for cap, cap_params in rule_actions:
+            actions += struct.pack("<HBBI", string(cap), len(cap_params),
+                                   len(params), 0)
+            for ptype, value in cap_params:
+                if ptype == FLOAT:
+                    value = int(round(value * 100))
+                elif ptype == STRING:
+                    value = string(value)
+                params.append(struct.pack("<BBH", ptype, 0, value))
+            action_count += 1
+    body += actions + b"".join(params) + rule_table
+    for ext_type, payload in ext:
+        body += struct.pack("<BBH", ext_type, 0, len(payload)) + payload
+
+    string_offset = 24 + len(body)
+    body += strings
+    flags = HAS_EXT if ext else 0
+    header = struct.pack("<IBBHBBBBHHHHI", WBP_MAGIC_RULES, WBP_VERSION,
+                         flags, 24 + len(body), len(signals), len(conditions),
+                         action_count, len(rules), len(params), 0,
+                         string_offset, 0, zlib.crc32(body))
+    return header + body
+
+# name: (length, flags); "u12" is never byte-aligned
+DECODE_LAYOUTS = {"u8": (8, 0), "s8": (8, SIGNED), "u16": (16, 0),
+                  "s16": (16, SIGNED), "u32": (32, 0), "s32": (32, SIGNED),
+                  "u12": (12, 0)}
+DECODE_IDS = range(0x100, 0x110)
+
+
+def decode_ruleset(length, flags, shift):
+    signals = [("s%X" % can_id, can_id, shift, length, flags, 1.0, 0.0)
+               for can_id in DECODE_IDS]
+    return build(signals, [], [])
+
+
+# name: (pgn, start, length, factor, offset); all little-endian unsigned
+J1939_SIGNALS = [
+    ("torque", 0xF004, 16, 8, 1.0, -125.0),            # EEC1
+    ("engine_speed", 0xF004, 24, 16, 0.125, 0.0),      # EEC1
+    ("wheel_speed", 0xFEF1, 8, 16, 1.0 / 256, 0.0),    # CCVS
+    ("coolant", 0xFEEE, 0, 8, 1.0, -40.0),             # ET1
+    ("brake_pedal", 0xF001, 8, 8, 0.4, 0.0),           # EBC1
+    ("requested_speed", 0x0000, 8, 16, 0.125, 0.0),    # TSC1 (PDU1)
+]
+
+# (pgn, priority, period ms, sources, destinations (PDU1 only))
+J1939_SENDERS = [
+    (0xF004, 3, 10, [0x00, 0x01], None),
+    (0xFEF1, 6, 100, [0x00, 0x0B], None),
+    (0xFEF1, 7, 100, [0x17], None),
+    (0xFEEE, 6, 1000, [0x00, 0x3D], None),
+    (0xF001, 6, 100, [0x0B], None),
+    (0x0000, 3, 10, [0x03, 0x27], [0x00, 0x0F]),
+    (0xFECA, 6, 1000, [0x00, 0x0B, 0x3D], None),       # DM1, no signals
+    (0xFF21, 6, 50, [0x21], None),                     # Proprietary B
+]
+J1939_STANDARD_IDS = [0x0F0, 0x1F0, 0x3C0]             # 11-bit, 20 ms
+J1939_SECONDS = 10
+
+
+def j1939_id(pgn, priority, source, destination=None):
+    if destination is not None:
+        pgn |= destination
+    return priority << 26 | pgn << 8 | source
+
+
+def j1939_ids():
+    """Every 29-bit ID j1939.log sends, per PGN."""
+    ids = {}
+    for pgn, priority, _, sources, destinations in J1939_SENDERS:
+        for source in sources:
+            for destination in destinations or [None]:
+                ids.setdefault(pgn, []).append(
+                    j1939_id(pgn, priority, source, destination))
+    return ids
+
+
+def j1939_log():
+    """candump -L lines; payloads are random, times in order."""
+    rng = random.Random(1939)
+    events = []
+    for pgn, priority, period, sources, destinations in J1939_SENDERS:
+        for n, source in enumerate(sources):
+            phase = rng.randrange(period)
+            for i, ms in enumerate(range(phase, J1939_SECONDS * 1000,
+                                         period)):
+                dest = destinations[i % len(destinations)] \
+                    if destinations else None
+                events.append((ms, n, "%08X" % j1939_id(pgn, priority,
+                                                         source, dest)))
+    for n, can_id in enumerate(J1939_STANDARD_IDS):
+        for ms in range(n * 3, J1939_SECONDS * 1000, 20):
+            events.append((ms, n, "%03X" % can_id))
+    events.sort()
+    lines = []
+    for ms, n, can_id in events:
+        usec = ms * 1000 + n * 137
+        data = "".join("%02X" % rng.randrange(256) for _ in range(8))
+        lines.append("(%d.%06d) can0 %s#%s\n" % (
+            1697540000 + usec // 1000000, usec % 1000000, can_id, data))
+    return "".join(lines).encode()
+
+
+def j1939_ruleset(exact):
+    ids = j1939_ids()
+    signals = []
+    for name, pgn, start, length, factor, offset in J1939_SIGNALS:
+        if exact:
+            signals += [("%s_%08X" % (name, i), i, start, length, 0,
+                         factor, offset) for i in ids[pgn]]
+        else:
+            signals.append((name, ids[pgn][0], start, length, J1939,
+                            factor, offset))
+    return build(signals, [], [])
+
+
+# Polled signals: start bits count from the first byte after the echo
+DIAG_SIGNALS = [
+    ("rpm", 0, 0, 16, 0, 0.25, 0.0),           # 0  PID 0x0C
+    ("soc", 0, 0, 8, 0, 0.5, 0.0),             # 1  DID 0x0101, 120 bytes
+    ("odometer", 0, 480, 32, 0, 0.1, 0.0),     # 2    bytes 60-63
+    ("dtc_count", 0, 952, 8, 0, 1.0, 0.0),     # 3    byte 119
+    ("coolant", 0, 0, 8, 0, 1.0, -40.0),       # 4  DID 0x0202, NRC 0x78
+    ("silent", 0, 0, 8, 0, 1.0, 0.0),          # 5  DID 0x0303, no answer
+    ("oversize", 0, 0, 8, 0, 1.0, 0.0),        # 6  DID 0x0404, 303 bytes
+    ("refused", 0, 0, 8, 0, 1.0, 0.0),         # 7  DID 0x0505, NRC 0x31
+    ("buffer_tail", 0, 2016, 8, 0, 1.0, 0.0),  # 8  DID 0x0606, 256 bytes
+    ("voltage", 0, 0, 16, 0, 0.001, 0.0),      # 9  PID 0x42, 29-bit IDs
+]
+
+# (request ID, response ID, service, extended, PID/DID, period, first, n)
+DIAG_POLLS = [
+    (0x7DF, 0x7E8, 0x01, 0, 0x0C, 100, 0, 1),
+    (0x7E0, 0x7E8, 0x22, 0, 0x0101, 250, 1, 3),
+    (0x7E0, 0x7E8, 0x22, 0, 0x0202, 500, 4, 1),
+    (0x7E0, 0x7E8, 0x22, 0, 0x0303, 1000, 5, 1),
+    (0x7DF, 0x7E8, 0x22, 0, 0x0404, 1000, 6, 1),
+    (0x7E0, 0x7E8, 0x22, 0, 0x0505, 1000, 7, 1),
+    (0x7E0, 0x7E8, 0x22, 0, 0x0606, 1000, 8, 1),
+    (0x18DA10F1, 0x18DAF110, 0x01, 1, 0x42, 200, 9, 1),
+]
+
+
+def diag_ruleset():
+    polls = b"".join(struct.pack("<IIBBHHBB", *p) for p in DIAG_POLLS)
+    return build(DIAG_SIGNALS, [], [], [(EXT_DIAG_POLLS, polls)])
+
+
+FLAP_SIGNALS = [DRIVE_SIGNALS[0]]  # rpm
+
+FLAP_CONDITIONS = [
+    ("rpm", GT, 3000.0, 0.0),                 # 0
+    ("rpm", LE, 3000.0, 0.0),                 # 1
+    ("rpm", HYSTERESIS, 3100.0, 2900.0),      # 2 on >= 3100, off <= 2900
+    ("rpm", HYSTERESIS, 2900.0, 3100.0),      # 3 its complement
+    ("rpm", RISING, 3000.0, 0.0),             # 4
+    ("rpm", FALLING, 3000.0, 0.0),            # 5
+]
+
+# One on/off pair per capability; p0 is the commanded state
+FLAP_RULES = [
+    ([0], 0, 0, [("gt", [(INT, 1)])]),
+    ([1], 0, 0, [("gt", [(INT, 0)])]),
+    ([2], 0, 0, [("hysteresis", [(INT, 1)])]),
+    ([3], 0, 0, [("hysteresis", [(INT, 0)])]),
+    ([4], 0, 0, [("edge", [(INT, 1)])]),
+    ([5], 0, 0, [("edge", [(INT, 0)])]),
+    ([0], 200, 0, [("gt_debounced", [(INT, 1)])]),
+    ([1], 200, 0, [("gt_debounced", [(INT, 0)])]),
+]
+
+
+WINDOW_SIGNALS = [("wheel", 0x200, 0, 16, 0, 0.01, 0.0)]
+
+# aggregate(wheel, window) <compare> value1; bench_window keeps a copy
+WINDOW_CONDITIONS = [
+    ("wheel", W_AVG, 80.0, 1000.0, GT),
+    ("wheel", W_MIN, 20.0, 1000.0, LT),
+    ("wheel", W_MAX, 140.0, 10000.0, GE),
+    ("wheel", W_STDDEV, 5.0, 100.0, GT),
+]
+WINDOW_CAPS = ["avg", "min", "max", "stddev"]
+
+
+def window_ruleset(plain):
+    """The four window conditions, or the same comparisons on the raw value
+    for a baseline.
+    """
+    conds = WINDOW_CONDITIONS
+    if plain:
+        conds = [(sig, compare, v1, 0.0)
+                 for sig, _, v1, _, compare in conds]
+    rules = [([i], 0, 0, [(cap, [])]) for i, cap in enumerate(WINDOW_CAPS)]
+    return build(WINDOW_SIGNALS, conds, rules)
+
+
+# (output, op, input a, input b, param) over DRIVE_SIGNALS; bench_derived
+# keeps a copy. Consumers come before their producers.
+DERIVED_NODES = [
+    ("wheel_avg", SCALE, "wheel_sum", None, 0.5),
+    ("wheel_sum", ADD, "wheel_fl", "wheel_fr", 0.0),
+    ("wheel_slip", SUB, "wheel_fl", "wheel_fr", 0.0),
+    ("accel_filtered", LOWPASS, "accel", None, 200.0),
+    ("accel", DERIVATIVE, "speed", None, 0.0),
+    ("load_smooth", EMA, "load", None, 0.1),
+    ("load", MUL, "rpm", "throttle", 0.0),
+    ("ratio", DIV, "rpm", "speed", 0.0),
+]
+DERIVED_COUNT = 64
+
+
+def derived_ruleset(signals, nodes):
+    """signals plus one output signal per node; nodes name their inputs."""
+    signals = signals + [(node[0], 0, 0, 16, 0, 1.0, 0.0) for node in nodes]
+    index = {s[0]: i for i, s in enumerate(signals)}
+    payload = b"".join(
+        struct.pack("<BBBBf", index[out], op, index[a], index[b or a], param)
+        for out, op, a, b, param in nodes)
+    return build(signals, [], [], [(EXT_DERIVED, payload)])
+
+
+def derived_chain():
+    """rpm -> d0 -> ... -> d63, x2 and x0.5 alternately; written last first.
+    """
+    nodes = [("d%d" % i, SCALE, "d%d" % (i - 1) if i else "rpm", None,
+              2.0 if i % 2 == 0 else 0.5) for i in range(DERIVED_COUNT)]
+    return derived_ruleset(DRIVE_SIGNALS, nodes[::-1])
+
+
+def derived_fan():
+    """d0..d63 = rpm * (i + 1)."""
+    nodes = [("d%d" % i, SCALE, "rpm", None, float(i + 1))
+             for i in range(DERIVED_COUNT)]
+    return derived_ruleset(DRIVE_SIGNALS, nodes)
+
+
+# Built-in outputs on GPIO 4, 5 and 18; bench_gpio keeps a copy
+GPIO_CONDITIONS = [
+    ("rpm", GT, 3000.0, 0.0),             # 0
+    ("rpm", LE, 3000.0, 0.0),             # 1
+    ("brake_pressure", GT, 40.0, 0.0),    # 2
+    ("speed", GT, 50.0, 0.0),             # 3
+    ("speed", LE, 50.0, 0.0),             # 4
+]
+
+GPIO_RULES = [
+    ([0], 0, 0, [("gpio_set", [(INT, 4), (INT, 1)])]),
+    ([1], 0, 0, [("gpio_set", [(INT, 4), (INT, 0)])]),
+    ([2], 0, 0, [("gpio_pulse", [(INT, 5), (INT, 1), (INT, 200)])]),
+    ([3], 0, 0, [("pwm_duty", [(INT, 18), (INT, 200)])]),
+    ([4], 0, 0, [("pwm_duty", [(INT, 18), (INT, 30)])]),
+]
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit("usage: make_ruleset.py OUTDIR")
+    out = sys.argv[1]
+    os.makedirs(out, exist_ok=True)
+    files = {
+        "drive.wbp": build(DRIVE_SIGNALS, DRIVE_CONDITIONS, DRIVE_RULES),
+    }
+    for name, (length, flags) in DECODE_LAYOUTS.items():
+        files["decode_%s.wbp" % name] = decode_ruleset(length, flags, 0)
+        files["decode_%s_shift.wbp" % name] = decode_ruleset(length, flags, 1)
+    files["j1939.log"] = j1939_log()
+    files["j1939.wbp"] = j1939_ruleset(False)
+    files["j1939_exact.wbp"] = j1939_ruleset(True)
+    files["diag.wbp"] = diag_ruleset()
+    files["flap.wbp"] = build(FLAP_SIGNALS, FLAP_CONDITIONS, FLAP_RULES)
+    files["flap_edge_debounce.wbp"] = build(
+        FLAP_SIGNALS, FLAP_CONDITIONS, [([4], 100, 0, [("edge", [])])])
+    files["window.wbp"] = window_ruleset(False)
+    files["window_plain.wbp"] = window_ruleset(True)
+    files["derived.wbp"] = derived_ruleset(DRIVE_SIGNALS, DERIVED_NODES)
+    files["derived_none.wbp"] = build(DRIVE_SIGNALS, [], [])
+    files["derived_chain.wbp"] = derived_chain()
+    files["derived_fan.wbp"] = derived_fan()
+    files["derived_cycle.wbp"] = derived_ruleset(
+        [DRIVE_SIGNALS[0]], [("a", SCALE, "b", None, 1.0),
+                             ("b", SCALE, "a", None, 1.0)])
+    files["gpio.wbp"] = build(DRIVE_SIGNALS, GPIO_CONDITIONS, GPIO_RULES)
+    files["gpio_bad_pin.wbp"] = build(
+        DRIVE_SIGNALS, GPIO_CONDITIONS,
+        [([0], 0, 0, [("gpio_set", [(INT, 6), (INT, 1)])])])
+    for name, data in files.items():
+        with open(os.path.join(out, name), "wb") as f:
+            f.write(data)
+
+
+if __name__ == "__main__":
+    main()
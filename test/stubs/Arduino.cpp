@@ -0,0 +1,56 @@
+/**
+ * @file Arduino.cpp
+ * @brief HOST:Arduino - Host clock, console and GPIO stubs
+ */
+
+#include "Arduino.h"
+
+HardwareSerial Serial;
+
+namespace {
+uint32_t nowMs = 0;
+bool quiet = false;
+int pinLevels[64];
+} // namespace
+
+void HardwareSerial::print(const char *s) {
+  if (!quiet)
+    fputs(s, stderr);
+}
+
+void HardwareSerial::println(const char *s) {
+  if (!quiet)
+    fprintf(stderr, "%s\n", s);
+}
+
+void HardwareSerial::printf(const char *fmt, ...) {
+  if (quiet)
+    return;
+  va_list args;
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+}
+
+uint32_t millis() { return nowMs; }
+uint32_t micros() { return nowMs * 1000; }
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  if (pin < 64)
+    pinLevels[pin] = level;
+}
+
+void analogWrite(uint8_t pin, int value) {
+  if (pin < 64)
+    pinLevels[pin] = value;
+}
+
+namespace host {
+
+void setMillis(uint32_t ms) { nowMs = ms; }
+void setQuiet(bool q) { quiet = q; }
+int pinLevel(uint8_t pin) { return pin < 64 ? pinLevels[pin] : 0; }
+
+} // namespace host
@@ -0,0 +1,113 @@
+/**
+ * @file Arduino.h
+ * @brief HOST:Arduino - Subset of the Arduino core used by src/core
+ *
+ * Lets the core modules build natively for the host harness. millis() and
+ * micros() read a clock the test drives through host::setMillis(), so
+ * replays are deterministic. GPIO writes only record the last level.
+ */
+#pragma once
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+/**
+ * @class String
+ * @brief Arduino String over std::string
+ */
+class String : public std::string {
+public:
+  String() = default;
+  String(const char *s) : std::string(s ? s : "") {}
+  String(const char *s, size_t len) : std::string(s, len) {}
+  String(const std::string &s) : std::string(s) {}
+  explicit String(char c) : std::string(1, c) {}
+  explicit String(int v) : std::string(std::to_string(v)) {}
+  explicit String(unsigned v) : std::string(std::to_string(v)) {}
+  explicit String(long v) : std::string(std::to_string(v)) {}
+  explicit String(unsigned long v) : std::string(std::to_string(v)) {}
+  explicit String(float v, unsigned decimals = 2) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+    assign(buf);
+  }
+
+  bool isEmpty() const { return empty(); }
+  unsigned length() const { return (unsigned)size(); }
+  long toInt() const { return strtol(c_str(), nullptr, 10); }
+  float toFloat() const { return strtof(c_str(), nullptr); }
+
+  int indexOf(char c, unsigned from = 0) const {
+    size_t pos = find(c, from);
+    return pos == npos ? -1 : (int)pos;
+  }
+  int indexOf(const char *s, unsigned from = 0) const {
+    size_t pos = find(s, from);
+    return pos == npos ? -1 : (int)pos;
+  }
+
+  String substring(unsigned from) const {
+    return from >= size() ? String() : String(substr(from));
+  }
+  String substring(unsigned from, unsigned to) const {
+    if (from > to)
+      std::swap(from, to);
+    if (from >= size())
+      return String();
+    return String(substr(from, to - from));
+  }
+
+  void trim() {
+    size_t first = find_first_not_of(" \t\r\n");
+    if (first == npos) {
+      clear();
+      return;
+    }
+    size_t last = find_last_not_of(" \t\r\n");
+    assign(substr(first, last - first + 1));
+  }
+};
+
+/**
+ * @class HardwareSerial
+ * @brief Console output (stderr), silenced by host::setQuiet()
+ */
+class HardwareSerial {
+public:
+  void print(const char *s);
+  void print(const String &s) { print(s.c_str()); }
+  void println(const char *s = "");
+  void println(const String &s) { println(s.c_str()); }
+  void printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HardwareSerial Serial;
+
+uint32_t millis();
+uint32_t micros();
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+void analogWrite(uint8_t pin, int value);
+
+namespace host {
+
+/// @brief Set the clock read by millis() and micros()
+void setMillis(uint32_t ms);
+
+/// @brief Suppress Serial output (benchmarks, expected errors)
+void setQuiet(bool quiet);
+
+/// @brief Last level written to a pin by digitalWrite() or analogWrite()
+int pinLevel(uint8_t pin);
+
+} // namespace host
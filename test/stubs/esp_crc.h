@@ -0,0 +1,17 @@
+/**
+ * @file esp_crc.h
+ * @brief HOST:esp_crc - Bitwise CRC32 matching the ESP-IDF ROM routine
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+inline uint32_t esp_crc32_le(uint32_t crc, const uint8_t *buf, size_t len) {
+  crc = ~crc;
+  while (len--) {
+    crc ^= *buf++;
+    for (int k = 0; k < 8; k++)
+      crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+  }
+  return ~crc;
+}
@@ -0,0 +1,12 @@
+/**
+ * @file esp_heap_caps.h
+ * @brief HOST:esp_heap_caps - Capability allocator on malloc()
+ */
+#pragma once
+#include <cstdlib>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+
+inline void *heap_caps_malloc(size_t size, unsigned) { return malloc(size); }
+inline void heap_caps_free(void *ptr) { free(ptr); }
@@ -0,0 +1,17 @@
+/**
+ * @file FreeRTOS.h
+ * @brief HOST:FreeRTOS - Types and constants used by src/core
+ */
+#pragma once
+#include <cstdint>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFFu
+#define tskIDLE_PRIORITY 0
@@ -0,0 +1,43 @@
+/**
+ * @file queue.h
+ * @brief HOST:FreeRTOS - Single-threaded fixed-size item queue
+ *
+ * Never blocks: a full send or an empty receive fails at once, whatever
+ * the wait time.
+ */
+#pragma once
+#include "FreeRTOS.h"
+#include <cstring>
+#include <deque>
+#include <vector>
+
+struct HostQueue {
+  UBaseType_t length;
+  UBaseType_t itemSize;
+  std::deque<std::vector<uint8_t>> items;
+};
+
+typedef HostQueue *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  return new HostQueue{length, itemSize, {}};
+}
+
+inline void vQueueDelete(QueueHandle_t queue) { delete queue; }
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item,
+                             TickType_t) {
+  if (queue->items.size() >= queue->length)
+    return pdFALSE;
+  const uint8_t *bytes = static_cast<const uint8_t *>(item);
+  queue->items.emplace_back(bytes, bytes + queue->itemSize);
+  return pdTRUE;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t) {
+  if (queue->items.empty())
+    return pdFALSE;
+  memcpy(item, queue->items.front().data(), queue->itemSize);
+  queue->items.pop_front();
+  return pdTRUE;
+}
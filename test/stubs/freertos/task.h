@@ -0,0 +1,19 @@
+/**
+ * @file task.h
+ * @brief HOST:FreeRTOS - Task creation (always fails on the host)
+ *
+ * Without a task, async capabilities fall back to running inline, as on a
+ * device that is out of memory.
+ */
+#pragma once
+#include "FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+inline BaseType_t xTaskCreate(TaskFunction_t, const char *, uint32_t, void *,
+                              UBaseType_t, TaskHandle_t *) {
+  return pdFAIL;
+}
+
+inline void vTaskDelete(TaskHandle_t) {}
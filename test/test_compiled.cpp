@@ -0,0 +1,144 @@
+/**
+ * @file test_compiled.cpp
+ * @brief HOST:test_compiled - wbp2cpp backend against the interpreter
+ *
+ * Replays a frame log through two Engines running the same WBP ruleset,
+ * one interpreted and one with the generated backend. After every frame
+ * the signal tables must match bit for bit, and both must make the same
+ * capability calls at the same times.
+ *
+ * Usage: test_compiled rules.wbp frames.log
+ */
+
+#include "Harness.h"
+#include <cstring>
+
+W4RP::CompiledRuleset &driveRules(); // Generated from drive.wbp
+
+namespace {
+
+const char *const CAPABILITIES[] = {"warn",     "fan",      "chime", "display",
+                                    "brake_light", "traction", "idle"};
+
+/// @brief Everything observable from one replay
+struct Trace {
+  bool loaded = false;
+  bool compiled = false;
+  std::vector<W4RP::RuntimeSignal> signals; // Snapshot after each frame
+  std::vector<std::string> calls;           // "ms capability p0=.. p1=.."
+  uint32_t rulesTriggered = 0;
+};
+
+Trace replay(const std::vector<uint8_t> &wbp,
+             const std::vector<host::LogFrame> &log,
+             W4RP::CompiledRuleset *backend) {
+  Trace trace;
+  W4RP::Engine engine;
+  for (const char *id : CAPABILITIES) {
+    String name(id);
+    engine.registerCapability(name, [&trace, name](const W4RP::ParamMap &p) {
+      std::string call = std::to_string(millis()) + " " + name;
+      for (const auto &kv : p)
+        call += " " + kv.first + "=" + kv.second;
+      trace.calls.push_back(call);
+    });
+  }
+  engine.setCompiledRuleset(backend);
+
+  host::setMillis(0);
+  trace.loaded = engine.loadRuleset(wbp.data(), wbp.size());
+  trace.compiled = engine.isCompiledActive();
+  if (!trace.loaded)
+    return trace;
+
+  for (const host::LogFrame &entry : log) {
+    host::setMillis(entry.ms);
+    engine.processCanFrame(entry.frame);
+    engine.evaluateRules();
+    const std::vector<W4RP::RuntimeSignal> &signals = engine.getSignals();
+    trace.signals.insert(trace.signals.end(), signals.begin(), signals.end());
+  }
+  trace.rulesTriggered = engine.getRulesTriggered();
+  return trace;
+}
+
+bool sameState(const W4RP::RuntimeSignal &a, const W4RP::RuntimeSignal &b) {
+  return memcmp(&a.value, &b.value, sizeof(float)) == 0 &&
+         memcmp(&a.lastValue, &b.lastValue, sizeof(float)) == 0 &&
+         a.lastUpdateMs == b.lastUpdateMs && a.everSet == b.everSet;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s rules.wbp frames.log\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<uint8_t> wbp;
+  std::vector<host::LogFrame> log;
+  if (!host::readFile(argv[1], wbp) || !host::readCandump(argv[2], log)) {
+    fprintf(stderr, "cannot read %s or %s\n", argv[1], argv[2]);
+    return 2;
+  }
+
+  host::setQuiet(true);
+  Trace interpreted = replay(wbp, log, nullptr);
+  Trace compiled = replay(wbp, log, &driveRules());
+  host::setQuiet(false);
+
+  CHECK(interpreted.loaded && compiled.loaded);
+  CHECK(!interpreted.compiled);
+  CHECK(compiled.compiled);
+  if (host::failures())
+    return 1;
+
+  // Signal tables after every frame
+  size_t perFrame = interpreted.signals.size() / log.size();
+  CHECK(interpreted.signals.size() == compiled.signals.size());
+  size_t mismatches = 0;
+  for (size_t i = 0; i < interpreted.signals.size() &&
+                     i < compiled.signals.size();
+       i++) {
+    if (sameState(interpreted.signals[i], compiled.signals[i]))
+      continue;
+    if (mismatches++ < 5)
+      fprintf(stderr, "frame %zu signal %zu: %.9g != %.9g\n", i / perFrame,
+              i % perFrame, interpreted.signals[i].value,
+              compiled.signals[i].value);
+  }
+  CHECK(mismatches == 0);
+
+  // Capability calls, in order
+  CHECK(interpreted.rulesTriggered == compiled.rulesTriggered);
+  CHECK(interpreted.calls.size() == compiled.calls.size());
+  for (size_t i = 0;
+       i < interpreted.calls.size() && i < compiled.calls.size(); i++) {
+    if (interpreted.calls[i] != compiled.calls[i]) {
+      fprintf(stderr, "call %zu: '%s' != '%s'\n", i,
+              interpreted.calls[i].c_str(), compiled.calls[i].c_str());
+      CHECK(interpreted.calls[i] == compiled.calls[i]);
+      break;
+    }
+  }
+
+  // The log must exercise every signal and capability, or the test is weak
+  const std::vector<W4RP::RuntimeSignal> last(
+      interpreted.signals.end() - perFrame, interpreted.signals.end());
+  for (const W4RP::RuntimeSignal &sig : last)
+    CHECK(sig.everSet);
+  for (const char *id : CAPABILITIES) {
+    bool called = false;
+    for (const std::string &call : interpreted.calls)
+      called |= call.find(std::string(" ") + id + " ") != std::string::npos;
+    if (!called)
+      fprintf(stderr, "capability '%s' never called\n", id);
+    CHECK(called);
+  }
+
+  printf("%zu frames, %zu signals, %u rule triggers, %zu calls: %s\n",
+         log.size(), perFrame, interpreted.rulesTriggered,
+         interpreted.calls.size(), host::failures() ? "FAIL" : "match");
+  return host::failures() ? 1 : 0;
+}
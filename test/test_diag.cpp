@@ -0,0 +1,328 @@
+/**
+ * @file test_diag.cpp
+ * @brief HOST:test_diag - Diagnostic polling against a simulated ECU
+ *
+ * A MockCan peer plays the ECU for every poll of diag.wbp: single frames,
+ * first frame + flow control + consecutive frames past the sequence wrap,
+ * NRC 0x78 followed by a late answer, silence, a response longer than the
+ * ISO-TP buffer, a negative response, one that fills the buffer exactly,
+ * 29-bit IDs, and every fourth multi-frame response with a sequence gap.
+ * Each signal update must carry the value the ECU encoded, and the poller
+ * counters must account for every request.
+ *
+ * Usage: test_diag diag.wbp
+ */
+
+#include "Harness.h"
+#include "MockCan.h"
+#include <random>
+
+namespace {
+
+constexpr uint32_t RUN_MS = 20000;
+constexpr uint32_t DRAIN_MS = 6000; // Longer than P2* for the last answer
+constexpr uint32_t QUIET_MS = 500;  // No new requests, last one times out
+constexpr uint32_t REPLY_DELAY_MS = 5;
+constexpr uint32_t PENDING_DELAY_MS = 300; // Past P2 (150 ms), inside P2*
+constexpr uint32_t MIN_REQUEST_GAP_MS = 25; // DiagPoller default
+constexpr size_t SIGNAL_COUNT = 10;         // make_ruleset.py DIAG_SIGNALS
+
+constexpr uint32_t FUNCTIONAL_ID = 0x7DF;
+constexpr uint32_t PHYSICAL_ID = 0x7E0;
+constexpr uint32_t RESPONSE_ID = 0x7E8;
+constexpr uint32_t EXT_REQUEST_ID = 0x18DA10F1;
+constexpr uint32_t EXT_RESPONSE_ID = 0x18DAF110;
+
+W4RP::CanFrame makeFrame(uint32_t id, bool extended) {
+  W4RP::CanFrame frame = {};
+  frame.id = id;
+  frame.extended = extended;
+  frame.dlc = 8;
+  memset(frame.data, 0xAA, sizeof(frame.data));
+  return frame;
+}
+
+/**
+ * @class SimulatedEcu
+ * @brief Answers DiagPoller requests on a MockCan, one response at a time
+ */
+class SimulatedEcu {
+public:
+  explicit SimulatedEcu(host::MockCan &bus) : bus_(bus) {
+    bus_.setPeer([this](const W4RP::CanFrame &frame) { onFrame(frame); });
+  }
+
+  float expected[SIGNAL_COUNT] = {};   // Value of the last positive response
+  uint32_t delivered[SIGNAL_COUNT] = {}; // Positive responses per signal
+  std::vector<uint32_t> requestMs;
+  uint32_t positive = 0;
+  uint32_t negative = 0;
+  uint32_t silent = 0;
+  uint32_t overflowFlowControls = 0;
+  uint32_t corrupted = 0;
+  uint32_t badFrames = 0;
+  bool answering = true;
+
+private:
+  using Values = std::vector<std::pair<size_t, float>>;
+
+  host::MockCan &bus_;
+  std::mt19937 rng_{53};
+  uint32_t multiFrameCount_ = 0;
+
+  // Multi-frame response waiting for flow control
+  std::vector<uint8_t> rest_;
+  W4RP::CanFrame pendingHeader_;
+  uint32_t flowControlId_ = 0;
+  Values pendingValues_;
+  bool pendingCorrupt_ = false;
+  bool awaitingFlowControl_ = false;
+
+  void commit(const Values &values) {
+    for (const auto &v : values) {
+      expected[v.first] = v.second;
+      delivered[v.first]++;
+    }
+    positive++;
+  }
+
+  void onFrame(const W4RP::CanFrame &frame) {
+    switch (frame.data[0] >> 4) {
+    case 0x0:
+      onRequest(frame);
+      return;
+    case 0x3:
+      onFlowControl(frame);
+      return;
+    default:
+      badFrames++;
+    }
+  }
+
+  void onRequest(const W4RP::CanFrame &frame) {
+    bool ext = frame.extended;
+    if (ext ? frame.id != EXT_REQUEST_ID
+            : (frame.id != FUNCTIONAL_ID && frame.id != PHYSICAL_ID)) {
+      badFrames++;
+      return;
+    }
+    uint8_t service = frame.data[1];
+    bool uds = service == 0x22;
+    if (frame.data[0] != (uds ? 3 : 2)) {
+      badFrames++;
+      return;
+    }
+    uint16_t ident = uds ? (frame.data[2] << 8 | frame.data[3]) : frame.data[2];
+    requestMs.push_back(millis());
+
+    if (!answering) {
+      silent++;
+      return;
+    }
+
+    std::vector<uint8_t> payload = {(uint8_t)(service + 0x40)};
+    if (uds)
+      payload.push_back(ident >> 8);
+    payload.push_back(ident & 0xFF);
+    uint32_t at = millis() + REPLY_DELAY_MS;
+    uint32_t respId = ext ? EXT_RESPONSE_ID : RESPONSE_ID;
+
+    switch (ident) {
+    case 0x0C: { // rpm: u16 LE x 0.25
+      uint16_t raw = rng_() & 0xFFFF;
+      payload.push_back(raw & 0xFF);
+      payload.push_back(raw >> 8);
+      send(respId, ext, payload, at, {{0, raw * 0.25f}});
+      return;
+    }
+    case 0x0101: { // 120 bytes: 17 consecutive frames, sequence wraps
+      std::vector<uint8_t> data(120);
+      for (uint8_t &b : data)
+        b = rng_();
+      uint32_t odo = data[60] | data[61] << 8 | data[62] << 16;
+      data[63] = 0; // Keep the odometer exact in a float
+      payload.insert(payload.end(), data.begin(), data.end());
+      pendingCorrupt_ = ++multiFrameCount_ % 4 == 0;
+      send(respId, ext, payload, at,
+           {{1, data[0] * 0.5f}, {2, odo * 0.1f}, {3, (float)data[119]}});
+      return;
+    }
+    case 0x0202: { // Response pending, then the answer after P2
+      uint8_t raw = rng_();
+      send(respId, ext, {0x7F, service, 0x78}, at, {});
+      payload.push_back(raw);
+      send(respId, ext, payload, at + PENDING_DELAY_MS, {{4, raw - 40.0f}});
+      return;
+    }
+    case 0x0303:
+      silent++;
+      return;
+    case 0x0404: // 303 bytes, more than ISOTP_MAX_PAYLOAD
+      payload.resize(303, 0x55);
+      send(respId, ext, payload, at, {{6, 85.0f}});
+      return;
+    case 0x0505:
+      negative++;
+      send(respId, ext, {0x7F, service, 0x31}, at, {});
+      return;
+    case 0x0606: { // Exactly ISOTP_MAX_PAYLOAD bytes
+      payload.resize(ISOTP_MAX_PAYLOAD);
+      for (size_t i = 3; i < payload.size(); i++)
+        payload[i] = rng_();
+      send(respId, ext, payload, at, {{8, (float)payload.back()}});
+      return;
+    }
+    case 0x42: { // voltage: u16 LE x 0.001, 29-bit IDs
+      uint16_t raw = rng_() & 0xFFFF;
+      payload.push_back(raw & 0xFF);
+      payload.push_back(raw >> 8);
+      send(respId, ext, payload, at, {{9, raw * 0.001f}});
+      return;
+    }
+    default:
+      badFrames++;
+    }
+  }
+
+  /// @brief Single frame now, or first frame now and the rest on flow control
+  void send(uint32_t id, bool ext, const std::vector<uint8_t> &payload,
+            uint32_t at, const Values &values) {
+    W4RP::CanFrame frame = makeFrame(id, ext);
+    if (payload.size() <= 7) {
+      frame.data[0] = payload.size();
+      memcpy(frame.data + 1, payload.data(), payload.size());
+      bus_.inject(frame, at);
+      if (!values.empty())
+        commit(values);
+      return;
+    }
+
+    frame.data[0] = 0x10 | (payload.size() >> 8);
+    frame.data[1] = payload.size() & 0xFF;
+    memcpy(frame.data + 2, payload.data(), 6);
+    bus_.inject(frame, at);
+    pendingHeader_ = makeFrame(id, ext);
+    rest_.assign(payload.begin() + 6, payload.end());
+    pendingValues_ = values;
+    flowControlId_ = ext ? EXT_REQUEST_ID : PHYSICAL_ID;
+    awaitingFlowControl_ = true;
+  }
+
+  void onFlowControl(const W4RP::CanFrame &frame) {
+    if (!awaitingFlowControl_ || frame.id != flowControlId_) {
+      badFrames++;
+      return;
+    }
+    awaitingFlowControl_ = false;
+    if (frame.data[0] == 0x32) {
+      overflowFlowControls++;
+      return;
+    }
+    if (frame.data[0] != 0x30) {
+      badFrames++;
+      return;
+    }
+
+    // Block size 0, STmin 0: everything on the next millisecond
+    uint8_t seq = 1;
+    for (size_t off = 0, n = 0; off < rest_.size(); off += 7, n++) {
+      W4RP::CanFrame cf = pendingHeader_;
+      bool skip = pendingCorrupt_ && n == 2;
+      cf.data[0] = 0x20 | ((skip ? seq + 1 : seq) & 0x0F);
+      size_t len = std::min<size_t>(7, rest_.size() - off);
+      memcpy(cf.data + 1, rest_.data() + off, len);
+      bus_.inject(cf, millis() + 1);
+      seq = (seq + 1) & 0x0F;
+    }
+    if (pendingCorrupt_)
+      corrupted++;
+    else
+      commit(pendingValues_);
+    pendingCorrupt_ = false;
+  }
+};
+
+bool near(float a, float b) {
+  return fabsf(a - b) <= 1e-5f * std::max(1.0f, fabsf(b));
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s diag.wbp\n", argv[0]);
+    return 2;
+  }
+  std::vector<uint8_t> wbp;
+  if (!host::readFile(argv[1], wbp)) {
+    fprintf(stderr, "cannot read %s\n", argv[1]);
+    return 2;
+  }
+
+  W4RP::Engine engine;
+  host::setMillis(0);
+  CHECK(engine.loadRuleset(wbp.data(), wbp.size()));
+  CHECK(engine.getSignalCount() == SIGNAL_COUNT);
+  if (host::failures())
+    return 1;
+
+  host::MockCan bus;
+  bus.begin();
+  SimulatedEcu ecu(bus);
+
+  uint32_t updates[SIGNAL_COUNT] = {};
+  for (uint32_t now = 1; now <= RUN_MS + DRAIN_MS; now++) {
+    host::setMillis(now);
+    ecu.answering = now < RUN_MS; // Then only finish what is in flight
+    if (now == RUN_MS + DRAIN_MS - QUIET_MS)
+      engine.getDiagPoller().setMinRequestGap(UINT16_MAX);
+    engine.serviceDiagnostics(bus);
+    W4RP::CanFrame frame;
+    while (bus.receive(frame))
+      engine.processCanFrame(frame);
+
+    for (size_t i = 0; i < SIGNAL_COUNT; i++) {
+      const W4RP::RuntimeSignal &sig = engine.getSignals()[i];
+      if (!sig.everSet || sig.lastUpdateMs != now)
+        continue;
+      updates[i]++;
+      if (!near(sig.value, ecu.expected[i])) {
+        fprintf(stderr, "%u ms: signal %zu = %.6g, ECU sent %.6g\n", now, i,
+                sig.value, ecu.expected[i]);
+        CHECK(near(sig.value, ecu.expected[i]));
+      }
+    }
+  }
+
+  // Every answered response decoded once; nothing else decoded
+  for (size_t i = 0; i < SIGNAL_COUNT; i++)
+    CHECK(updates[i] == ecu.delivered[i]);
+  CHECK(updates[0] > 0 && updates[1] > 0 && updates[4] > 0);
+  CHECK(updates[8] > 0 && updates[9] > 0);
+  CHECK(updates[5] == 0 && updates[6] == 0 && updates[7] == 0);
+
+  // Every request ends as a response, NRC, timeout, overflow or bad sequence
+  const W4RP::DiagPollerStats &st = engine.getDiagPoller().getStats();
+  CHECK(st.requests == ecu.requestMs.size());
+  CHECK(st.responses == ecu.positive);
+  CHECK(st.negativeResponses == ecu.negative && ecu.negative > 0);
+  CHECK(st.timeouts == ecu.silent && ecu.silent > 0);
+  CHECK(st.overflows == ecu.overflowFlowControls && st.overflows > 0);
+  CHECK(ecu.corrupted > 0);
+  CHECK(st.requests == st.responses + st.negativeResponses + st.timeouts +
+                           st.overflows + ecu.corrupted);
+  CHECK(st.txFailures == 0);
+  CHECK(ecu.badFrames == 0);
+
+  // Bus-load limit between requests
+  uint32_t minGap = UINT32_MAX;
+  for (size_t i = 1; i < ecu.requestMs.size(); i++)
+    minGap = std::min(minGap, ecu.requestMs[i] - ecu.requestMs[i - 1]);
+  CHECK(minGap >= MIN_REQUEST_GAP_MS);
+
+  printf("%u requests: %u responses, %u negative, %u timeouts, %u overflows, "
+         "%u sequence errors; closest requests %u ms apart\n",
+         st.requests, st.responses, st.negativeResponses, st.timeouts,
+         st.overflows, ecu.corrupted, minGap);
+  return host::failures() ? 1 : 0;
+}
@@ -0,0 +1,372 @@
+#!/usr/bin/env python3
+"""wbp2cpp - Generate a W4RP::CompiledRuleset from a WBP rules binary.
+
+Usage: wbp2cpp.py rules.wbp -o fleet_rules.cpp [--name fleetRules]
+                  [--include W4RP.h]
+
+The output defines `W4RP::CompiledRuleset &<name>()`. Every CAN ID becomes
+one switch case that decodes its signals with fixed shifts and masks and
+re-evaluates the conditions reading them as inline comparisons.
+
+Supported: exact CAN IDs, any bit layout, EQ..OUTSIDE and signal-operand
+conditions, plus the SIGNAL_LOG, RULE_PRIORITY and ACTION_STEPS sections
+(handled by the Engine as usual). Anything else is rejected, so the ruleset
+keeps running interpreted.
+"""
+
+import argparse
+import math
+import os
+import struct
+import sys
+import zlib
+
+WBP_MAGIC_RULES = 0xC0DE5702
+WBP_VERSION = 0x02
+WBP_VERSION_V3 = 0x03
+WBP_FLAG_HAS_META = 0x01
+WBP_FLAG_HAS_EXT = 0x04
+WBP_SIG_FLAG_BIG_ENDIAN = 0x01
+WBP_SIG_FLAG_SIGNED = 0x02
+WBP_SIG_FLAG_J1939 = 0x04
+WBP_COND_FLAG_SIGNAL_OPERAND = 0x80
+
+# Sections the Engine handles outside decoding and conditions
+EXT_SUPPORTED = {0x04: "SIGNAL_LOG", 0x08: "RULE_PRIORITY",
+                 0x09: "ACTION_STEPS"}
+EXT_NAMES = {0x01: "SIGNAL_MASKS", 0x02: "SIGNAL_MUX", 0x03: "DIAG_POLLS",
+             0x05: "DERIVED", 0x06: "SIGNAL_TIMEOUTS",
+             0x07: "STATE_MACHINE"}
+
+OPS = ["EQ", "NE", "GT", "GE", "LT", "LE", "WITHIN", "OUTSIDE"]
+OP_OUTSIDE = 7
+MAX_CONDITIONS = 32  # WBP_MAX_CONDITIONS, parser rejects more
+
+HEADER = struct.Struct("<IBBHBBBBHHHHI")
+META_SIZE = 40
+SIGNAL = struct.Struct("<IHBBff")
+CONDITION = struct.Struct("<BBBBff")
+ACTION_SIZE = 8
+PARAM_SIZE = 4
+RULE_SIZE = 10
+EXT_HEADER = struct.Struct("<BBH")
+
+# WBP v3: section directory, 16-bit indices
+HEADER_V3 = struct.Struct("<IBBHIIHHHHII")
+SECTION_V3 = struct.Struct("<HHII")
+CONDITION_V3 = struct.Struct("<HHBBHff")
+SEC_SIGNALS = 0x41
+SEC_CONDITIONS = 0x42
+SEC_CORE = range(0x40, 0x47)  # META..STRINGS
+
+
+class UnsupportedError(Exception):
+    pass
+
+
+def parse_signal(i, fields):
+    can_id, start, length, sflags, factor, off = fields
+    if sflags & WBP_SIG_FLAG_J1939:
+        raise UnsupportedError("signal %d uses J1939 matching" % i)
+    return {"id": can_id, "start": start, "len": length,
+            "be": bool(sflags & WBP_SIG_FLAG_BIG_ENDIAN),
+            "signed": bool(sflags & WBP_SIG_FLAG_SIGNED),
+            "factor": factor, "offset": off}
+
+
+def parse_condition(i, sig, op, sig2, v1, v2, signal_count):
+    operand = bool(op & WBP_COND_FLAG_SIGNAL_OPERAND)
+    op &= ~WBP_COND_FLAG_SIGNAL_OPERAND
+    if sig >= signal_count or (operand and sig2 >= signal_count):
+        raise UnsupportedError("condition %d: invalid signal" % i)
+    if op > OP_OUTSIDE:
+        raise UnsupportedError("condition %d: operation %d is stateful"
+                               % (i, op))
+    return {"sig": sig, "op": op, "v1": v1, "v2": v2,
+            "sig2": sig2 if operand else None}
+
+
+def check_extension(ext_type):
+    if ext_type not in EXT_SUPPORTED:
+        name = EXT_NAMES.get(ext_type, "0x%02X" % ext_type)
+        raise UnsupportedError("section %s needs the interpreter" % name)
+
+
+def parse(data):
+    """Return (signals, conditions) from a WBP v2 or v3 rules binary."""
+    if len(data) > 4 and data[4] == WBP_VERSION_V3:
+        return parse_v3(data)
+    if len(data) < HEADER.size:
+        raise UnsupportedError("data too short for header")
+    (magic, version, flags, total_size, signal_count, condition_count,
+     action_count, rule_count, param_count, _meta_offset, string_offset,
+     _reserved, crc) = HEADER.unpack_from(data)
+
+    if magic != WBP_MAGIC_RULES:
+        raise UnsupportedError("invalid magic 0x%08X" % magic)
+    if version != WBP_VERSION:
+        raise UnsupportedError("unsupported version %d" % version)
+    if total_size > len(data) or total_size < HEADER.size:
+        raise UnsupportedError("invalid total size %d" % total_size)
+    if zlib.crc32(data[HEADER.size:total_size]) != crc:
+        raise UnsupportedError("CRC mismatch")
+
+    offset = HEADER.size + (META_SIZE if flags & WBP_FLAG_HAS_META else 0)
+
+    signals = []
+    for i in range(signal_count):
+        signals.append(parse_signal(i, SIGNAL.unpack_from(data, offset)))
+        offset += SIGNAL.size
+
+    conditions = []
+    for i in range(condition_count):
+        sig, op, _compare, sig2, v1, v2 = CONDITION.unpack_from(data, offset)
+        offset += CONDITION.size
+        conditions.append(parse_condition(i, sig, op, sig2, v1, v2,
+                                          signal_count))
+
+    offset += (action_count * ACTION_SIZE + param_count * PARAM_SIZE +
+               rule_count * RULE_SIZE)
+
+    if flags & WBP_FLAG_HAS_EXT:
+        while offset + EXT_HEADER.size <= string_offset:
+            ext_type, _, length = EXT_HEADER.unpack_from(data, offset)
+            offset += EXT_HEADER.size + length
+            check_extension(ext_type)
+
+    return signals, conditions
+
+
+def parse_v3(data):
+    if len(data) < HEADER_V3.size:
+        raise UnsupportedError("data too short for header")
+    (magic, _version, _flags, section_count, total_size, crc, signal_count,
+     condition_count, _actions, _rules, _params,
+     _reserved) = HEADER_V3.unpack_from(data)
+
+    if magic != WBP_MAGIC_RULES:
+        raise UnsupportedError("invalid magic 0x%08X" % magic)
+    if total_size > len(data) or total_size < HEADER_V3.size:
+        raise UnsupportedError("invalid total size %d" % total_size)
+    if zlib.crc32(data[HEADER_V3.size:total_size]) != crc:
+        raise UnsupportedError("CRC mismatch")
+
+    tables = {}
+    for s in range(section_count):
+        sec_type, _, offset, length = SECTION_V3.unpack_from(
+            data, HEADER_V3.size + s * SECTION_V3.size)
+        if offset + length > total_size:
+            raise UnsupportedError("section 0x%02X out of bounds" % sec_type)
+        if sec_type in SEC_CORE:
+            tables[sec_type] = (offset, length)
+        else:
+            check_extension(sec_type)
+
+    def table(sec_type, entry, count):
+        offset, length = tables.get(sec_type, (0, 0))
+        if length != count * entry.size:
+            raise UnsupportedError("section 0x%02X does not match its count"
+                                   % sec_type)
+        return [entry.unpack_from(data, offset + i * entry.size)
+                for i in range(count)]
+
+    signals = [parse_signal(i, fields) for i, fields in
+               enumerate(table(SEC_SIGNALS, SIGNAL, signal_count))]
+    conditions = []
+    for i, (sig, sig2, op, _compare, _, v1, v2) in enumerate(
+            table(SEC_CONDITIONS, CONDITION_V3, condition_count)):
+        conditions.append(parse_condition(i, sig, op, sig2, v1, v2,
+                                          signal_count))
+    return signals, conditions
+
+
+def flt(value):
+    """C++ float literal that round-trips the 32-bit value."""
+    if math.isnan(value):
+        return "NAN"
+    if math.isinf(value):
+        return "INFINITY" if value > 0 else "-INFINITY"
+    text = "%.9g" % value
+    if "e" not in text and "." not in text:
+        text += ".0"
+    return text + "f"
+
+
+def decode_expr(sig):
+    """Specialized equivalent of Engine extractBits() + scaling."""
+    start, length = sig["start"], sig["len"]
+    if length == 0 or length > 64:
+        raw = None
+    else:
+        # Both byte orders read a contiguous run of bits: Intel upwards from
+        # startBit, Motorola downwards from it (MSB first)
+        lo = start - length + 1 if sig["be"] else start
+        hi = lo + length - 1
+        clipped = lo < 0 or hi > 63
+        lo, hi = max(lo, 0), min(hi, 63)
+        raw = None if lo > hi else (lo, hi, clipped)
+
+    if raw is None:
+        return flt(sig["offset"]), "constant"
+
+    lo, hi, clipped = raw
+    first, last = lo // 8, hi // 8
+    width = hi - lo + 1
+    wide = (last - first + 1) > 4 or width > 32
+    utype = "uint64_t" if wide else "uint32_t"
+
+    parts = []
+    for k in range(first, last + 1):
+        shift = 8 * (k - first)
+        parts.append("(%s)d[%d]" % (utype, k) if shift == 0 else
+                     "(%s)d[%d] << %d" % (utype, k, shift))
+    expr = parts[0] if len(parts) == 1 else "(" + " | ".join(parts) + ")"
+    if lo % 8:
+        expr = "(%s >> %d)" % (expr, lo % 8)
+    if width < 8 * (last - first + 1) - lo % 8:
+        expr = "(%s & 0x%X%s)" % (expr, (1 << width) - 1,
+                                  "ULL" if wide else "u")
+
+    # Engine sign-extends at bitLength; clipped fields never set that bit
+    if sig["signed"] and not clipped:
+        if width in (8, 16, 32, 64) and lo % 8 == 0:
+            expr = "(int%d_t)%s" % (width, expr)
+        else:
+            stype = "int64_t" if wide else "int32_t"
+            bits = 64 if wide else 32
+            expr = "((%s)(%s << %d) >> %d)" % (stype, expr, bits - width,
+                                               bits - width)
+
+    value = "(float)" + expr
+    if sig["factor"] != 1.0 or sig["offset"] != 0.0:
+        value += " * " + flt(sig["factor"])
+        if sig["offset"] < 0.0:
+            value += " - " + flt(-sig["offset"])
+        elif sig["offset"] > 0.0:
+            value += " + " + flt(sig["offset"])
+    order = "BE" if sig["be"] else "LE"
+    kind = "s" if sig["signed"] else "u"
+    return value, "start %d len %d %s %s" % (start, length, order, kind)
+
+
+def condition_expr(cond):
+    """Inline form of Engine::evaluateCondition() for EQ..OUTSIDE."""
+    val = "s[%d].value" % cond["sig"]
+    op = OPS[cond["op"]]
+    guard = ""
+    if cond["sig2"] is not None:
+        ref = "s[%d].value" % cond["sig2"]
+        if cond["v1"] != 0.0:
+            ref = "(%s + %s)" % (ref, flt(cond["v1"]))
+        guard = "s[%d].everSet && s[%d].everSet && " % (cond["sig"],
+                                                        cond["sig2"])
+    else:
+        ref = flt(cond["v1"])
+
+    if op == "EQ":
+        test = "fabsf(%s - %s) < 0.0001f" % (val, ref)
+    elif op == "NE":
+        test = "fabsf(%s - %s) >= 0.0001f" % (val, ref)
+    elif op == "WITHIN":
+        test = "%s >= %s && %s <= %s" % (val, flt(cond["v1"]), val,
+                                         flt(cond["v2"]))
+    elif op == "OUTSIDE":
+        test = "(%s < %s || %s > %s)" % (val, flt(cond["v1"]), val,
+                                         flt(cond["v2"]))
+    else:
+        sym = {"GT": ">", "GE": ">=", "LT": "<", "LE": "<="}[op]
+        test = "%s %s %s" % (val, sym, ref)
+    return guard + test
+
+
+def generate(data, source, name, include="W4RP.h"):
+    signals, conditions = parse(data)
+    crc = zlib.crc32(data)
+    if len(conditions) > MAX_CONDITIONS:
+        raise UnsupportedError("%d conditions exceed limit of %d"
+                               % (len(conditions), MAX_CONDITIONS))
+
+    by_id = {}
+    for idx, sig in enumerate(signals):
+        by_id.setdefault(sig["id"], []).append(idx)
+
+    cls = name[:1].upper() + name[1:] + "Backend"
+    out = []
+    w = out.append
+    w("// Generated by tools/wbp2cpp.py from %s - do not edit" % source)
+    w("// %d signals, %d conditions, %d CAN IDs" %
+      (len(signals), len(conditions), len(by_id)))
+    w("#include <%s>" % include)
+    w("#include <cmath>")
+    w("")
+    w("namespace {")
+    w("")
+    w("class %s final : public W4RP::CompiledRuleset {" % cls)
+    w("public:")
+    w("  uint32_t sourceCRC() const override { return 0x%08Xu; }" % crc)
+    w("")
+    w("  bool processFrame(uint32_t id, const uint8_t *d, "
+      "W4RP::RuntimeSignal *s,")
+    w("                    uint32_t &r, uint32_t nowMs) override {")
+    w("    switch (id) {")
+
+    for can_id in sorted(by_id):
+        members = by_id[can_id]
+        w("    case 0x%Xu: {" % can_id)
+        for idx in members:
+            value, comment = decode_expr(signals[idx])
+            w("      store(s[%d], %s, nowMs); // %s" % (idx, value, comment))
+
+        # Conditions reading any signal of this frame, either operand
+        touched = set(members)
+        for c, cond in enumerate(conditions):
+            if cond["sig"] in touched or cond["sig2"] in touched:
+                w("      set(r, 0x%Xu, %s);" % (1 << c, condition_expr(cond)))
+        w("      return true;")
+        w("    }")
+
+    w("    default:")
+    w("      return false;")
+    w("    }")
+    w("  }")
+    w("};")
+    w("")
+    w("} // namespace")
+    w("")
+    w("W4RP::CompiledRuleset &%s() {" % name)
+    w("  static %s backend;" % cls)
+    w("  return backend;")
+    w("}")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="WBP rules binary")
+    parser.add_argument("-o", "--output", help="C++ file (default stdout)")
+    parser.add_argument("--name", default="compiledRuleset",
+                        help="accessor function name")
+    parser.add_argument("--include", default="W4RP.h",
+                        help="header declaring W4RP::CompiledRuleset")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+
+    try:
+        code = generate(data, os.path.basename(args.input), args.name,
+                        args.include)
+    except UnsupportedError as e:
+        sys.exit("wbp2cpp: %s" % e)
+    except struct.error:
+        sys.exit("wbp2cpp: truncated WBP binary")
+
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(code)
+    else:
+        sys.stdout.write(code)
+
+
+if __name__ == "__main__":
+    main()